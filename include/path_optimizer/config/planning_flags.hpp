@@ -39,14 +39,44 @@ DECLARE_string(smoothing_method);
 
 DECLARE_string(tension_solver);
 
+DECLARE_string(angle_diff_solver);
+
+DECLARE_int32(angle_diff_sqp_max_iter);
+
+DECLARE_string(race_smoothing_methods);
+
+DECLARE_double(race_deadline_ms);
+
+DECLARE_string(race_policy);
+
+DECLARE_int32(race_thread_num);
+
+DECLARE_bool(enable_incremental_smoothing);
+
+DECLARE_double(incremental_smoothing_overlap);
+
+DECLARE_double(incremental_smoothing_max_start_offset);
+
 DECLARE_bool(enable_searching);
 
+DECLARE_string(search_method);
+
 DECLARE_double(search_lateral_range);
 
 DECLARE_double(search_longitudial_spacing);
 
 DECLARE_double(search_lateral_spacing);
 
+DECLARE_bool(enable_coarse_to_fine_search);
+
+DECLARE_double(search_coarse_longitudinal_spacing);
+
+DECLARE_double(search_coarse_lateral_spacing);
+
+DECLARE_double(search_fine_band);
+
+DECLARE_double(search_coarse_cost_margin);
+
 DECLARE_double(frenet_angle_diff_weight);
 
 DECLARE_double(frenet_angle_diff_diff_weight);
@@ -83,6 +113,18 @@ DECLARE_double(KP_deviation_weight);
 
 DECLARE_double(KP_slack_weight);
 
+DECLARE_double(candidate_lateral_weight);
+
+DECLARE_int32(candidate_thread_num);
+
+DECLARE_int32(result_cache_capacity);
+
+DECLARE_double(result_cache_position_resolution);
+
+DECLARE_double(result_cache_angle_resolution);
+
+DECLARE_double(result_cache_curvature_resolution);
+
 DECLARE_double(expected_safety_margin);
 
 DECLARE_bool(constraint_end_heading);
@@ -95,8 +137,16 @@ DECLARE_double(output_spacing);
 
 DECLARE_bool(enable_computation_time_output);
 
+DECLARE_string(planning_stats_file);
+
 DECLARE_bool(enable_collision_check);
 
+DECLARE_bool(enable_continuous_collision_check);
+
+DECLARE_int32(continuous_collision_check_max_depth);
+
+DECLARE_double(continuous_collision_check_min_length);
+
 DECLARE_double(search_obstacle_cost);
 
 DECLARE_double(search_deviation_cost);
@@ -104,4 +154,16 @@ DECLARE_double(search_deviation_cost);
 DECLARE_double(epsilon);
 
 DECLARE_bool(enable_dynamic_segmentation);
+
+DECLARE_double(reference_line_resolution);
+
+DECLARE_double(clearance_raster_ds);
+
+DECLARE_double(clearance_raster_dl);
+
+DECLARE_double(budget_smoothing_share);
+
+DECLARE_double(budget_qp_share);
+
+DECLARE_double(qp_early_stop_max_primal_residual);
 #endif //PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_CONFIG_PLANNING_FLAGS_HPP_
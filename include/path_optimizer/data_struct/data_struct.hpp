@@ -4,6 +4,7 @@
 
 #ifndef PATH_OPTIMIZER_INCLUDE_DATA_STRUCT_DATA_STRUCT_HPP_
 #define PATH_OPTIMIZER_INCLUDE_DATA_STRUCT_DATA_STRUCT_HPP_
+#include <array>
 #include <vector>
 #include <memory>
 #include <cfloat>
@@ -77,6 +78,11 @@ struct CoveringCircleBounds {
             ub = bounds[0];
             lb = bounds[1];
         }
+        SingleCircleBounds &operator=(const std::array<double, 2> &bounds) {
+            ub = bounds[0];
+            lb = bounds[1];
+            return *this;
+        }
         void set(const std::vector<double> &bounds, const State &center) {
             ub = bounds[0];
             lb = bounds[1];
@@ -90,41 +96,5 @@ struct CoveringCircleBounds {
     } c0, c1, c2, c3;
 };
 
-// Point for A* search.
-struct APoint {
-    double x{};
-    double y{};
-    double s{};
-    double l{};
-    double g{};
-    double h{};
-    double dir{};
-    // Layer denotes the index of the longitudinal layer that the point lies on.
-    int layer{-1};
-    int offset_idx{};
-    double rough_upper_bound, rough_lower_bound;
-    bool is_in_open_set{false};
-    APoint *parent{nullptr};
-    inline double f() {
-        return g + h;
-    }
-};
-
-// Point for DP.
-struct DpPoint {
-    double x_, y_, heading_, s_, l_, cost_ = DBL_MAX, dir_, dis_to_obs_;
-    int layer_index_, lateral_index_;
-    double rough_upper_bound, rough_lower_bound;
-    const DpPoint *parent_ = nullptr;
-    bool is_feasible_ = true;
-};
-
-class PointComparator {
- public:
-    bool operator()(APoint *a, APoint *b) {
-        return a->f() > b->f();
-    }
-};
-
 }
 #endif //PATH_OPTIMIZER_INCLUDE_DATA_STRUCT_DATA_STRUCT_HPP_
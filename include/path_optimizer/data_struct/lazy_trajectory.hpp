@@ -0,0 +1,54 @@
+#ifndef PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_DATA_STRUCT_LAZY_TRAJECTORY_HPP_
+#define PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_DATA_STRUCT_LAZY_TRAJECTORY_HPP_
+#include <vector>
+#include "path_optimizer/data_struct/trajectory.hpp"
+#include "path_optimizer/tools/spline.h"
+#include "path_optimizer/tools/tools.hpp"
+
+namespace PathOptimizationNS {
+
+class CollisionChecker;
+
+// Optimized path as splines of x and y over s, evaluated only where asked. It's what the
+// densified output of PathOptimizer::solve samples every FLAGS_output_spacing, without the
+// sampling and without the collision check, which is left to checkCollision. evaluate, sample
+// and checkCollision reuse buffers of the object, so one object isn't for concurrent use.
+class LazyTrajectory {
+ public:
+    LazyTrajectory() = default;
+    // Fit through the states, which need increasing s. Refitting keeps the spline buffers.
+    void fit(const Trajectory &states);
+    void clear();
+    bool empty() const { return length_ <= 0; }
+    double getLength() const { return length_; }
+    double getX(double s) const;
+    double getY(double s) const;
+    double getHeading(double s) const;
+    double getCurvature(double s) const;
+    // x, y, heading, curvature and s.
+    State getState(double s) const;
+    // Evaluate at sorted s in one pass, states is cleared first.
+    void evaluate(const std::vector<double> &s_list, Trajectory *states);
+    // Evaluate every spacing from s_begin up to min(s_end, length).
+    void sample(double s_begin, double s_end, double spacing, Trajectory *states);
+    // Check states every spacing over [s_begin, min(s_end, length)], and the motion between them
+    // with FLAGS_enable_continuous_collision_check, so a long path can be checked in chunks
+    // as far as it's needed. If not collision free and collision_s isn't null, it's set to the s
+    // of the first colliding state.
+    bool checkCollision(CollisionChecker *checker,
+                        double s_begin,
+                        double s_end,
+                        double spacing,
+                        double *collision_s = nullptr);
+
+ private:
+    tk::spline x_s_, y_s_;
+    double length_{};
+    // Buffers of evaluate, sample and checkCollision, kept so repeated calls don't allocate.
+    std::vector<double> s_list_, x_list_, y_list_, heading_list_, k_list_;
+    SplineDerivatives derivatives_;
+    Trajectory states_;
+};
+}
+
+#endif //PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_DATA_STRUCT_LAZY_TRAJECTORY_HPP_
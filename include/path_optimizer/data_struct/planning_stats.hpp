@@ -0,0 +1,122 @@
+#ifndef PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_DATA_STRUCT_PLANNING_STATS_HPP_
+#define PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_DATA_STRUCT_PLANNING_STATS_HPP_
+#include <array>
+#include <chrono>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include "path_optimizer/tools/allocation_tracker.hpp"
+#include "path_optimizer/tools/instrumentation.hpp"
+
+namespace PathOptimizationNS {
+
+// Metrics of one PathOptimizer::solve or solveWithoutSmoothing call. Times are monotonic wall
+// times in ms, so they stay meaningful when stages run on several threads.
+struct PlanningStats {
+    enum Stage {
+        // Everything in reference smoothing except search and post-smoothing.
+        kSmoothing,
+        kSearch,
+        kPostSmoothing,
+        kSegmentation,
+        kBounds,
+        kQpSetup,
+        kQpSolve,
+        kOutput,
+        kCollisionCheck,
+        // Result cache keys, lookups and insertions.
+        kCache,
+        kStageNum
+    };
+    static const char *stageName(Stage stage);
+    enum CacheResult {
+        kCacheDisabled,
+        kCacheMiss,
+        // The smoothing was skipped.
+        kCacheReferenceHit,
+        // The cached final path was returned.
+        kCachePathHit
+    };
+    static const char *cacheResultName(CacheResult result);
+
+    void clear() { *this = PlanningStats(); }
+    // A single JSON object without line breaks.
+    std::string toJson() const;
+    // Append toJson() and a line break to a file. Safe to call from several threads.
+    bool appendJsonLine(const std::string &file_name) const;
+
+    bool success{false};
+    // Failed because the cancellation token of the optimizer was cancelled.
+    bool cancelled{false};
+    // The latency budget of the optimizer, or the share of it given to smoothing, ran out.
+    bool deadline_exceeded{false};
+    // The path comes from an unconverged OSQP iterate, taken when the QP ran out of its share of
+    // the latency budget. It passed the same collision check as a converged one.
+    bool qp_early_stopped{false};
+    double total_ms{};
+    // Accumulated if a stage runs more than once, 0 for stages that didn't run.
+    std::array<double, kStageNum> stage_ms{};
+    // Number of reference states the QP is built on.
+    std::size_t horizon{};
+    // -1 if the QP wasn't solved.
+    int osqp_iterations{-1};
+    std::string osqp_status;
+    CacheResult cache_result{kCacheDisabled};
+    // Totals of the optimizer so far, this call included, to get hit rates from.
+    uint64_t cache_lookups{};
+    uint64_t cache_reference_hits{};
+    uint64_t cache_path_hits{};
+    // operator new calls and bytes made on the planning thread in each stage, nested stages
+    // excluded. Only filled with allocation tracking, see allocation_tracker.hpp.
+    std::array<uint64_t, kStageNum> stage_allocations{};
+    std::array<uint64_t, kStageNum> stage_allocated_bytes{};
+};
+
+// Adds the wall time from construction to stop() or destruction to a stage if stats is not null.
+// With instrumentation, the stage is recorded as a trace span in any case. With allocation
+// tracking, allocations of the calling thread are tagged with the stage until stop(), so timers
+// must be stopped in reverse order of construction.
+class StageTimer {
+ public:
+    StageTimer(PlanningStats *stats, PlanningStats::Stage stage) :
+        stats_(stats), stage_(stage), start_(std::chrono::steady_clock::now()) {
+#ifdef PATH_OPTIMIZER_ENABLE_ALLOCATION_TRACKING
+        previous_tag_ = allocation_tracker::setTag(stage_);
+        start_allocations_ = allocation_tracker::getThreadCount(stage_);
+#endif
+    }
+    ~StageTimer() { stop(); }
+    StageTimer(const StageTimer &timer) = delete;
+    StageTimer &operator=(const StageTimer &timer) = delete;
+    void stop() {
+        if (stopped_) return;
+        stopped_ = true;
+        const auto end = std::chrono::steady_clock::now();
+#ifdef PATH_OPTIMIZER_ENABLE_INSTRUMENTATION
+        instrumentation::addTraceEvent(PlanningStats::stageName(stage_), start_, end);
+#endif
+        if (stats_) stats_->stage_ms[stage_] += std::chrono::duration<double, std::milli>(end - start_).count();
+#ifdef PATH_OPTIMIZER_ENABLE_ALLOCATION_TRACKING
+        const auto allocations = allocation_tracker::getThreadCount(stage_);
+        allocation_tracker::setTag(previous_tag_);
+        if (stats_) {
+            stats_->stage_allocations[stage_] += allocations.calls - start_allocations_.calls;
+            stats_->stage_allocated_bytes[stage_] += allocations.bytes - start_allocations_.bytes;
+        }
+#endif
+    }
+
+ private:
+    PlanningStats *stats_;
+    bool stopped_{false};
+    const PlanningStats::Stage stage_;
+    const std::chrono::steady_clock::time_point start_;
+#ifdef PATH_OPTIMIZER_ENABLE_ALLOCATION_TRACKING
+    int previous_tag_;
+    allocation_tracker::AllocationCount start_allocations_;
+#endif
+};
+static_assert(PlanningStats::kStageNum <= allocation_tracker::kTagNum, "Stages are used as allocation tags.");
+}
+
+#endif //PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_DATA_STRUCT_PLANNING_STATS_HPP_
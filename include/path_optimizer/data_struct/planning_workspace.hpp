@@ -0,0 +1,40 @@
+#ifndef PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_DATA_STRUCT_PLANNING_WORKSPACE_HPP_
+#define PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_DATA_STRUCT_PLANNING_WORKSPACE_HPP_
+#include <memory>
+#include <string>
+#include <vector>
+#include "path_optimizer/data_struct/data_struct.hpp"
+#include "path_optimizer/data_struct/trajectory.hpp"
+#include "path_optimizer/data_struct/vehicle_state_frenet.hpp"
+#include "path_optimizer/reference_path_smoother/reference_path_smoother.hpp"
+#include "path_optimizer/solver/solver.hpp"
+#include "path_optimizer/tools/spline.h"
+#include "path_optimizer/tools/tools.hpp"
+
+namespace PathOptimizationNS {
+
+// Per-solve buffers of a PathOptimizer, kept across its solve() calls. Users overwrite them without
+// shrinking, so once they have grown to the largest problem seen, later solves don't allocate
+// for them. The reference path and the search lattices keep their own buffers the same way.
+struct PlanningWorkspace {
+    // Reference smoother, bound to reference_points, and the method it was made for. Made again
+    // only when the method changes.
+    std::unique_ptr<ReferencePathSmoother> smoother;
+    std::string smoother_method;
+    std::vector<State> reference_points;
+    // QP solver and the method it was made for, reset() for each solve. Made again only when the
+    // method changes. It's bound to the optimizer's vehicle state, or in a candidate's workspace
+    // to vehicle_state.
+    std::unique_ptr<OsqpSolver> solver;
+    std::string solver_method;
+    VehicleState vehicle_state;
+    // QP result, and its splines in outputPath.
+    Trajectory optimized_path;
+    tk::spline result_x_s, result_y_s;
+    // Densified output in outputPath.
+    std::vector<double> output_s, output_x, output_y, output_heading, output_k;
+    SplineDerivatives output_derivatives;
+};
+}
+
+#endif //PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_DATA_STRUCT_PLANNING_WORKSPACE_HPP_
@@ -0,0 +1,49 @@
+#ifndef PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_DATA_STRUCT_REFERENCE_LINE_HPP_
+#define PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_DATA_STRUCT_REFERENCE_LINE_HPP_
+#include <vector>
+#include <cstddef>
+
+namespace PathOptimizationNS {
+class State;
+namespace tk {
+class spline;
+}
+
+// Smoothed reference path sampled once on a uniform s grid. Queries locate the grid cell
+// directly instead of searching the spline knots, so every lookup is O(1).
+// Position is interpolated by cubic Hermite (using the stored derivatives), heading and
+// curvature linearly. Queries outside [0, length] are extrapolated linearly.
+class ReferenceLine {
+ public:
+    ReferenceLine() = default;
+    // Sample x_s and y_s on [0, max_s] with the given resolution.
+    void build(const tk::spline &x_s, const tk::spline &y_s, double max_s, double resolution);
+    void clear();
+    bool empty() const { return x_.empty(); }
+    std::size_t size() const { return x_.size(); }
+    double getLength() const { return max_s_; }
+    double getResolution() const { return resolution_; }
+    double getX(double s) const;
+    double getY(double s) const;
+    double getHeading(double s) const;
+    double getCurvature(double s) const;
+    // x, y, heading, curvature and s.
+    State getState(double s) const;
+    // Unit vector pointing to the left of the path.
+    void getNormal(double s, double *nx, double *ny) const;
+    // First and second derivatives w.r.t. s, used by projection.
+    void getDerivatives(double s, double *dx, double *dy, double *ddx, double *ddy) const;
+
+ private:
+    // Find the cell containing s and the normalized position t in it. Returns false if s is
+    // out of range, in which case index is the nearest end and t is the signed distance past it.
+    bool locate(double s, std::size_t *index, double *t) const;
+    double resolution_{};
+    double max_s_{};
+    std::vector<double> x_, y_, dx_, dy_, heading_, k_;
+    // Scratch buffers of build(), kept to spare the allocations when the line is rebuilt.
+    std::vector<double> s_list_, ddx_, ddy_;
+};
+}
+
+#endif //PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_DATA_STRUCT_REFERENCE_LINE_HPP_
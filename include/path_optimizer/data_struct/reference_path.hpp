@@ -13,25 +13,42 @@ class Map;
 class Config;
 class State;
 class CoveringCircleBounds;
+class CancellationToken;
 namespace tk {
 class spline;
 }
 class ReferencePathImpl;
+class ReferenceLine;
+class ClearanceRaster;
+class ProjectionIndex;
+class Trajectory;
 
 class ReferencePath {
  public:
     ReferencePath();
     const tk::spline &getXS() const;
     const tk::spline &getYS() const;
+    // The splines themselves, to keep them after the path is cleared without copying them.
+    std::shared_ptr<const tk::spline> getSharedXS() const;
+    std::shared_ptr<const tk::spline> getSharedYS() const;
     double getXS(double s) const;
     double getYS(double s) const;
+    const ReferenceLine &getReferenceLine() const;
+    // Clearance raster along the reference line over [s_begin, s_end] x [-max_l, max_l], kept
+    // until the spline or the map changes or it's asked for with other extents.
+    const ClearanceRaster &getClearanceRaster(const Map &map, double s_begin, double s_end, double max_l);
+    // Closest point and Frenet queries on the reference line, built when the spline is set.
+    const ProjectionIndex &getProjectionIndex() const;
+    // Prefer the rvalue and shared_ptr versions, they don't copy the splines.
     void setSpline(const tk::spline &x_s, const tk::spline &y_s, double max_s);
+    void setSpline(tk::spline &&x_s, tk::spline &&y_s, double max_s);
+    void setSpline(std::shared_ptr<const tk::spline> x_s, std::shared_ptr<const tk::spline> y_s, double max_s);
     void setOriginalSpline(const tk::spline &x_s, const tk::spline &y_s, double max_s);
     void clear();
     std::size_t getSize() const;
     double getLength() const;
     void setLength(double s);
-    const std::vector<State> &getReferenceStates() const;
+    const Trajectory &getReferenceStates() const;
     const std::vector<CoveringCircleBounds> &getBounds() const;
     const std::vector<double> &getMaxKList() const;
     const std::vector<double> &getMaxKpList() const;
@@ -39,8 +56,9 @@ class ReferencePath {
     // Set reference_states_ directly, only used in solveWithoutSmoothing.
     void setReference(const std::vector<State> &reference);
     void setReference(const std::vector<State> &&reference);
-    // Calculate upper and lower bounds for each covering circle.
-    void updateBounds(const Map &map);
+    // Calculate upper and lower bounds for each covering circle. The reference states are cut
+    // where the path is blocked, or where the token got cancelled.
+    void updateBounds(const Map &map, const CancellationToken *cancellation_token = nullptr);
     // If the reference_states_ have speed and acceleration information, call this func to calculate
     // curvature and curvature rate bounds.
     void updateLimits();
@@ -4,14 +4,21 @@
 
 #ifndef PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_DATA_STRUCT_REFERENCE_PATH_IMPL_HPP_
 #define PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_DATA_STRUCT_REFERENCE_PATH_IMPL_HPP_
+#include <array>
 #include <vector>
 #include <tuple>
+#include <memory>
+#include "path_optimizer/data_struct/reference_line.hpp"
+#include "path_optimizer/data_struct/trajectory.hpp"
+#include "path_optimizer/tools/clearance_raster.hpp"
+#include "path_optimizer/tools/projection_index.hpp"
 
 namespace PathOptimizationNS {
 class Map;
 class Config;
 class State;
 class CoveringCircleBounds;
+class CancellationToken;
 namespace tk {
 class spline;
 }
@@ -25,8 +32,20 @@ class ReferencePathImpl {
 
     const tk::spline &getXS() const;
     const tk::spline &getYS() const;
-    // Set smoothed reference path.
+    std::shared_ptr<const tk::spline> getSharedXS() const { return x_s_; }
+    std::shared_ptr<const tk::spline> getSharedYS() const { return y_s_; }
+    // Smoothed reference path sampled on a uniform s grid, rebuilt in setSpline.
+    const ReferenceLine &getReferenceLine() const;
+    // Built on first use along reference_line_, rebuilt when the map changes, dropped when the
+    // spline changes.
+    const ClearanceRaster &getClearanceRaster(const Map &map, double s_begin, double s_end, double max_l);
+    // Built over reference_line_ in setSpline, so concurrent const readers don't race on it.
+    const ProjectionIndex &getProjectionIndex() const;
+    // Set smoothed reference path. The splines are immutable once set, so they can be shared
+    // instead of copied; pass them by rvalue or shared_ptr to avoid copying the coefficients.
     void setSpline(const tk::spline &x_s, const tk::spline &y_s, double max_s);
+    void setSpline(tk::spline &&x_s, tk::spline &&y_s, double max_s);
+    void setSpline(std::shared_ptr<const tk::spline> x_s, std::shared_ptr<const tk::spline> y_s, double max_s);
     // Set search result. It's used to calculate boundaries.
     void setOriginalSpline(const tk::spline &x_s, const tk::spline &y_s, double max_s);
     const tk::spline &getOriginalXS() const;
@@ -36,7 +55,7 @@ class ReferencePathImpl {
     std::size_t getSize() const;
     double getLength() const;
     void setLength(double s);
-    const std::vector<State> &getReferenceStates() const;
+    const Trajectory &getReferenceStates() const;
     const std::vector<CoveringCircleBounds> &getBounds() const;
     const std::vector<double> &getMaxKList() const;
     const std::vector<double> &getMaxKpList() const;
@@ -45,8 +64,9 @@ class ReferencePathImpl {
     void setReference(const std::vector<State> &reference);
     void setReference(const std::vector<State> &&reference);
     // Calculate upper and lower bounds for each covering circle.
-    void updateBounds(const Map &map);
-    void updateBoundsImproved(const Map &map);
+    // Stop early, as at a blocked state, once the token is cancelled.
+    void updateBounds(const Map &map, const CancellationToken *cancellation_token = nullptr);
+    void updateBoundsImproved(const Map &map, const CancellationToken *cancellation_token = nullptr);
     // If the reference_states_ have speed and acceleration information, call this func to calculate
     // curvature and curvature rate bounds.
     void updateLimits();
@@ -54,20 +74,31 @@ class ReferencePathImpl {
     bool buildReferenceFromSpline(double delta_s_smaller, double delta_s_larger);
 
  private:
-    std::vector<double> getClearanceWithDirectionStrict(const PathOptimizationNS::State &state,
-                                                        const PathOptimizationNS::Map &map);
+    // Free lateral interval around state as {left, right}, distance_at(l) gives the obstacle
+    // distance at l meters to its left. Takes the callable by type, so it isn't copied to the heap
+    // for every circle.
+    template<typename DistanceAt>
+    std::array<double, 2> getClearanceWithDirectionStrict(const PathOptimizationNS::State &state,
+                                                          const DistanceAt &distance_at);
+    // Approximate circle center on the reference, len meters ahead of original_state.
     State getApproxState(const State &original_state, const State &actual_state, double len) const;
     bool use_spline_{true};
     // Reference path spline representation.
-    tk::spline *x_s_;
-    tk::spline *y_s_;
+    std::shared_ptr<const tk::spline> x_s_;
+    std::shared_ptr<const tk::spline> y_s_;
     double max_s_{};
-    tk::spline *original_x_s_;
-    tk::spline *original_y_s_;
+    ReferenceLine reference_line_;
+    ClearanceRaster clearance_raster_;
+    ProjectionIndex projection_index_;
+    std::shared_ptr<const tk::spline> original_x_s_;
+    std::shared_ptr<const tk::spline> original_y_s_;
     double original_max_s_{};
+    // Sampled original spline and its index, built on the first projection onto it.
+    ReferenceLine original_line_;
+    ProjectionIndex original_projection_index_;
     bool is_original_spline_set{false};
     // Divided smoothed path info.
-    std::vector<State> reference_states_;
+    Trajectory reference_states_;
     std::vector<CoveringCircleBounds> bounds_;
     std::vector<double> max_k_list_;
     std::vector<double> max_kp_list_;
@@ -0,0 +1,99 @@
+#ifndef PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_DATA_STRUCT_SEARCH_LATTICE_HPP_
+#define PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_DATA_STRUCT_SEARCH_LATTICE_HPP_
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <cfloat>
+
+namespace PathOptimizationNS {
+
+// Lateral samples on longitudinal layers along a reference line, used by the graph searches in
+// reference smoothing. Stored as a structure of arrays because the inner search loops only read a
+// few fields per node. Nodes of a layer are contiguous and sorted by l, node positions are computed
+// from the layer's reference point on demand. clear() keeps the capacity, so a reused lattice
+// doesn't allocate.
+struct SearchLattice {
+    enum Flag : uint8_t {
+        kFeasible = 1,
+        kClosed = 2,
+        // Feasibility has been checked, for searches that check nodes lazily.
+        kEvaluated = 4
+    };
+
+    void clear() {
+        layer_s.clear();
+        layer_x.clear();
+        layer_y.clear();
+        layer_heading.clear();
+        layer_cos.clear();
+        layer_sin.clear();
+        layer_begin.clear();
+        l.clear();
+        cost.clear();
+        dir.clear();
+        dis_to_obs.clear();
+        layer.clear();
+        parent.clear();
+        flags.clear();
+    }
+
+    // Start a new layer at the reference point (x, y, heading) with arc length s.
+    int addLayer(double s, double x, double y, double heading) {
+        layer_s.emplace_back(s);
+        layer_x.emplace_back(x);
+        layer_y.emplace_back(y);
+        layer_heading.emplace_back(heading);
+        layer_cos.emplace_back(cos(heading));
+        layer_sin.emplace_back(sin(heading));
+        layer_begin.emplace_back(nodeNum());
+        return layerNum() - 1;
+    }
+
+    // Append a node with lateral offset l to the last layer. It's feasible and not reached yet.
+    int addNode(double node_l) {
+        l.emplace_back(node_l);
+        cost.emplace_back(DBL_MAX);
+        dir.emplace_back(layer_heading.back());
+        dis_to_obs.emplace_back(0);
+        layer.emplace_back(layerNum() - 1);
+        parent.emplace_back(-1);
+        flags.emplace_back(kFeasible);
+        return nodeNum() - 1;
+    }
+
+    int layerNum() const { return static_cast<int>(layer_s.size()); }
+    int nodeNum() const { return static_cast<int>(l.size()); }
+    int layerBegin(int layer_index) const { return layer_begin[layer_index]; }
+    int layerEnd(int layer_index) const {
+        return layer_index + 1 < layerNum() ? layer_begin[layer_index + 1] : nodeNum();
+    }
+    double x(int node) const { return layer_x[layer[node]] - l[node] * layer_sin[layer[node]]; }
+    double y(int node) const { return layer_y[layer[node]] + l[node] * layer_cos[layer[node]]; }
+    double s(int node) const { return layer_s[layer[node]]; }
+    bool hasFlag(int node, Flag flag) const { return flags[node] & flag; }
+    void setFlag(int node, Flag flag, bool value) {
+        flags[node] = value ? flags[node] | flag : flags[node] & ~flag;
+    }
+    // Bounds of l over the run of feasible nodes containing the given one.
+    void getFeasibleRun(int node, double *lower_l, double *upper_l) const {
+        const int begin = layerBegin(layer[node]), end = layerEnd(layer[node]);
+        int lower = node, upper = node;
+        if (hasFlag(node, kFeasible)) {
+            while (lower > begin && hasFlag(lower - 1, kFeasible)) --lower;
+            while (upper + 1 < end && hasFlag(upper + 1, kFeasible)) ++upper;
+        }
+        *lower_l = l[lower];
+        *upper_l = l[upper];
+    }
+
+    // Per layer.
+    std::vector<double> layer_s, layer_x, layer_y, layer_heading, layer_cos, layer_sin;
+    std::vector<int> layer_begin;
+    // Per node. cost is the DP cost or the A* g, dir the direction of the edge from the parent.
+    std::vector<double> l, cost, dir, dis_to_obs;
+    std::vector<int> layer, parent;
+    std::vector<uint8_t> flags;
+};
+}
+
+#endif //PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_DATA_STRUCT_SEARCH_LATTICE_HPP_
@@ -0,0 +1,76 @@
+#ifndef PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_DATA_STRUCT_TRAJECTORY_HPP_
+#define PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_DATA_STRUCT_TRAJECTORY_HPP_
+#include <vector>
+#include <cstddef>
+#include "path_optimizer/data_struct/data_struct.hpp"
+
+namespace PathOptimizationNS {
+
+// A sequence of states stored as columns, so loops that read a few fields touch only those and
+// columns can be handed to batch routines directly. Speed and acceleration are optional: their
+// columns are only filled once a state with a non-zero v or a is added, and read as 0 otherwise.
+// clear() keeps the capacity.
+class Trajectory {
+ public:
+    // Read-only view of one state, cheap to pass by value.
+    class StateView {
+     public:
+        StateView(const Trajectory &trajectory, std::size_t index) : trajectory_(&trajectory), index_(index) {}
+        double x() const { return trajectory_->x(index_); }
+        double y() const { return trajectory_->y(index_); }
+        double heading() const { return trajectory_->heading(index_); }
+        double k() const { return trajectory_->k(index_); }
+        double s() const { return trajectory_->s(index_); }
+        double v() const { return trajectory_->v(index_); }
+        double a() const { return trajectory_->a(index_); }
+        operator State() const { return trajectory_->getState(index_); }
+
+     private:
+        const Trajectory *trajectory_;
+        std::size_t index_;
+    };
+
+    Trajectory() = default;
+    explicit Trajectory(const std::vector<State> &states);
+    void assign(const std::vector<State> &states);
+    // Append to states, which is not cleared.
+    void appendTo(std::vector<State> *states) const;
+
+    std::size_t size() const { return x_.size(); }
+    bool empty() const { return x_.empty(); }
+    bool hasSpeed() const { return has_speed_; }
+    void clear();
+    void reserve(std::size_t size);
+    // Drop the states from size on.
+    void truncate(std::size_t size);
+    void emplace_back(double x, double y, double heading, double k, double s);
+    void emplace_back(const State &state);
+
+    double x(std::size_t i) const { return x_[i]; }
+    double y(std::size_t i) const { return y_[i]; }
+    double heading(std::size_t i) const { return heading_[i]; }
+    double k(std::size_t i) const { return k_[i]; }
+    double s(std::size_t i) const { return s_[i]; }
+    double v(std::size_t i) const { return has_speed_ ? v_[i] : 0; }
+    double a(std::size_t i) const { return has_speed_ ? a_[i] : 0; }
+    void setS(std::size_t i, double s) { s_[i] = s; }
+    State getState(std::size_t i) const;
+    StateView operator[](std::size_t i) const { return StateView(*this, i); }
+    StateView front() const { return StateView(*this, 0); }
+    StateView back() const { return StateView(*this, size() - 1); }
+
+    const std::vector<double> &getXList() const { return x_; }
+    const std::vector<double> &getYList() const { return y_; }
+    const std::vector<double> &getHeadingList() const { return heading_; }
+    const std::vector<double> &getKList() const { return k_; }
+    const std::vector<double> &getSList() const { return s_; }
+
+ private:
+    std::vector<double> x_, y_, heading_, k_, s_;
+    // Empty unless has_speed_.
+    std::vector<double> v_, a_;
+    bool has_speed_{false};
+};
+}
+
+#endif //PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_DATA_STRUCT_TRAJECTORY_HPP_
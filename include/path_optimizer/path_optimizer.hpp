@@ -9,17 +9,41 @@
 #include <vector>
 #include <memory>
 #include <tuple>
+#include <chrono>
+#include <functional>
 #include <glog/logging.h>
+#include <Eigen/Core>
 #include "grid_map_core/grid_map_core.hpp"
 #include "path_optimizer/config/planning_flags.hpp"
+#include "path_optimizer/data_struct/data_struct.hpp"
+#include "path_optimizer/tools/deadline.hpp"
 
 namespace PathOptimizationNS {
 
 class ReferencePath;
-class State;
 class Map;
 class CollisionChecker;
 class VehicleState;
+class IncrementalSmoother;
+class ReferencePathSmoother;
+struct PlanningStats;
+struct PlanningWorkspace;
+class LazyTrajectory;
+class ResultCache;
+class CancellationToken;
+class OsqpSolver;
+class ResizableThreadPool;
+
+// One of the paths solveCandidates() plans on the same smoothed reference and bounds.
+struct PathCandidate {
+    // Goal of this candidate instead of the optimizer's. Only its heading is used, as the
+    // end constraint of the QP; the shared reference still ends next to the optimizer's goal.
+    bool override_end_state{false};
+    State end_state;
+    // Preferred lateral offset from the reference, positive to the left, weighted by
+    // FLAGS_candidate_lateral_weight. 0 with a zero weight leaves the cost as it is.
+    double lateral_offset{0};
+};
 
 class PathOptimizer {
 public:
@@ -31,26 +55,133 @@ public:
     PathOptimizer(const PathOptimizer &optimizer) = delete;
     PathOptimizer &operator=(const PathOptimizer &optimizer) = delete;
 
-    // Call this to get the optimized path.
-    bool solve(const std::vector<State> &reference_points, std::vector<State> *final_path);
-    bool solveWithoutSmoothing(const std::vector<State> &reference_points, std::vector<State> *final_path);
+    // Plan for another map, start or goal with the buffers of previous solves kept. The map must
+    // outlive the optimizer, as with the constructor. Call setMap again after changing the map in
+    // place, so cached results of the old content aren't used.
+    void setMap(const grid_map::GridMap &map);
+    void setStartState(const State &start_state);
+    void setEndState(const State &end_state);
+    // Following solves check the token between stages and in the long loops of smoothing, search,
+    // bounds and collision check, and give up once it's cancelled, with stats->cancelled set. The
+    // token must outlive the solves, nullptr stops checking.
+    void setCancellationToken(const CancellationToken *token) { cancellation_token_ = token; }
+    // Give each following solve budget_ms from its start, none if it's not positive. Smoothing may
+    // take FLAGS_budget_smoothing_share of it, which also bounds the IPOPT max_cpu_time, and the
+    // QP FLAGS_budget_qp_share of the time left then, as OSQP time_limit and max_iter. A QP
+    // stopped by its share gives its last iterate, which is output if it passes the collision
+    // check, with stats->qp_early_stopped set. Any other stage running out fails the solve with
+    // stats->deadline_exceeded set. Output isn't interrupted by the budget, only by the token.
+    void setLatencyBudget(double budget_ms) { latency_budget_ms_ = budget_ms; }
+
+    // Call this to get the optimized path. If stats is not null, it's filled with the timing of
+    // each stage and the QP result, whether the call succeeds or not.
+    // With FLAGS_result_cache_capacity, the path of an unchanged input is returned as it was
+    // last time, and an unchanged reference and start skip the smoothing, see ResultCache. Both
+    // overloads and solveCandidates use the cached references. Results of smoothing under a latency
+    // budget or with RACE aren't kept, they depend on timing.
+    bool solve(const std::vector<State> &reference_points,
+               std::vector<State> *final_path,
+               PlanningStats *stats = nullptr);
+    // Same, but the result is returned as splines evaluated on demand. Nothing is sampled or
+    // collision checked, see LazyTrajectory::checkCollision.
+    bool solve(const std::vector<State> &reference_points,
+               LazyTrajectory *trajectory,
+               PlanningStats *stats = nullptr);
+    // Smooth and bound the reference once, then solve a QP for each candidate, in parallel on
+    // FLAGS_candidate_thread_num threads and warm started from the first one. paths gets one
+    // densified path per candidate, empty if that one failed. Returns whether any succeeded.
+    // stats gets the shared stages and the first candidate; the wait for the others is
+    // counted as QP solving.
+    bool solveCandidates(const std::vector<State> &reference_points,
+                         const std::vector<PathCandidate> &candidates,
+                         std::vector<std::vector<State>> *paths,
+                         PlanningStats *stats = nullptr);
+    bool solveWithoutSmoothing(const std::vector<State> &reference_points,
+                               std::vector<State> *final_path,
+                               PlanningStats *stats = nullptr);
 
     // Only for visualization purpose.
     std::vector<std::tuple<State, double, double>> display_abnormal_bounds() const;
     const ReferencePath &getReferencePath() const;
 
 private:
+    // Set up stats, run plan with them, then finish them and log the result as name.
+    bool runWithStats(const std::string &name,
+                      const std::function<bool(PlanningStats *)> &plan,
+                      PlanningStats *stats);
+    // Key the result cache with the input of this call.
+    void setCacheInput(const std::vector<State> &reference_points, PlanningStats *stats);
+    // Smooth, or take the cached smoothed reference, then segment and bound it.
+    bool smoothReference(const std::vector<State> &reference_points, PlanningStats *stats);
+    bool smooth(const std::vector<State> &reference_points, PlanningStats *stats);
+    // Whether smoothing gives the same reference for the same input. Under a latency budget or with
+    // RACE it depends on timing, so its results aren't cached.
+    bool isSmoothingRepeatable() const;
+    // Both leave the QP result in the workspace.
+    bool smoothAndOptimize(const std::vector<State> &reference_points, PlanningStats *stats);
+    bool optimizeWithoutSmoothing(const std::vector<State> &reference_points, PlanningStats *stats);
+    // By the token or the latency budget.
+    bool isCancelled() const;
+    // By the token only.
+    bool isCancelledByCaller() const;
+    // Bound the solver by FLAGS_budget_qp_share of the time left, if there's a budget.
+    void setQpBudget(OsqpSolver *solver) const;
+    // The workspace's smoother for FLAGS_smoothing_method, bound to its copy of reference_points.
+    // Null if there's no such smoother.
+    ReferencePathSmoother *getSmoother(const std::vector<State> &reference_points,
+                                       PlanningWorkspace *workspace) const;
+    // The workspace's solver for FLAGS_optimization_method, reset for the current reference path.
+    // A new one is bound to vehicle_state. Null if there's no such solver.
+    OsqpSolver *getSolver(const VehicleState &vehicle_state, PlanningWorkspace *workspace) const;
+    // Total time, horizon, screen and file output.
+    void finishStats(const std::chrono::steady_clock::time_point &start_time, PlanningStats *stats) const;
+
     // Core function.
-    bool optimizePath(std::vector<State> *final_path);
+    bool optimizePath(PlanningStats *stats);
+    // Solve all candidates on the current reference.
+    bool optimizeCandidates(const std::vector<PathCandidate> &candidates,
+                            std::vector<std::vector<State>> *paths,
+                            PlanningStats *stats);
+    // Solve and densify one candidate in workspace. If solution isn't null, it gets the QP solution.
+    bool solveCandidate(const PathCandidate &candidate,
+                        const Eigen::VectorXd &warm_start,
+                        PlanningWorkspace *workspace,
+                        std::vector<State> *path,
+                        Eigen::VectorXd *solution,
+                        PlanningStats *stats) const;
+    // Interpolate and check the QP result in workspace, timed as the output stage.
+    bool densifyPath(PlanningWorkspace *workspace, std::vector<State> *final_path, PlanningStats *stats) const;
+    bool outputPath(PlanningWorkspace *workspace, std::vector<State> *final_path, PlanningStats *stats) const;
+    // Fit the QP result without sampling it.
+    bool fitTrajectory(LazyTrajectory *trajectory, PlanningStats *stats) const;
 
     // Divide smoothed path into segments.
-    bool segmentSmoothedPath();
+    bool segmentSmoothedPath(PlanningStats *stats);
 
-    const Map *grid_map_;
+    Map *grid_map_;
     CollisionChecker *collision_checker_;
     ReferencePath *reference_path_;
     VehicleState *vehicle_state_;
+    // Keeps the last smoothing result across solve() calls.
+    IncrementalSmoother *incremental_smoother_;
+    // Workers of the RACE smoothing method, started by the first race.
+    ResizableThreadPool *race_thread_pool_;
+    // Buffers reused across solve() calls.
+    PlanningWorkspace *workspace_;
+    ResultCache *result_cache_;
+    // One per candidate of solveCandidates(), reused the same way.
+    std::vector<std::unique_ptr<PlanningWorkspace>> candidate_workspaces_;
+    // Workers of solveCandidates(), started by its first call and sized by FLAGS_candidate_thread_num.
+    ResizableThreadPool *candidate_thread_pool_;
     size_t size_{};
+    const CancellationToken *cancellation_token_{nullptr};
+    double latency_budget_ms_{0};
+    // Of the running solve.
+    Deadline deadline_;
+    // Checked during a solve: cancellation_token_, or a token with the deadline and it as parent.
+    const CancellationToken *solve_token_{nullptr};
+    // Measured by the last QP solved to the end, 0 until then.
+    double qp_ms_per_iteration_{0};
 
 };
 }
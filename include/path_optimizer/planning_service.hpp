@@ -0,0 +1,86 @@
+#ifndef PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_PLANNING_SERVICE_HPP_
+#define PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_PLANNING_SERVICE_HPP_
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <cstdint>
+#include "grid_map_core/grid_map_core.hpp"
+#include "path_optimizer/data_struct/data_struct.hpp"
+#include "path_optimizer/data_struct/planning_stats.hpp"
+
+namespace PathOptimizationNS {
+
+class PathOptimizer;
+class CancellationToken;
+
+struct PlanningRequest {
+    std::vector<State> reference_points;
+    State start_state;
+    State end_state;
+    // Kept alive while the request is planned. A map must not change once submitted, submit a
+    // new one instead. The first request needs one, later ones may leave it null to keep the last.
+    std::shared_ptr<const grid_map::GridMap> map;
+    // Per-request PathOptimizer::setLatencyBudget, none if it's not positive. A request running
+    // out of it still gets a result, with stats.deadline_exceeded set.
+    double latency_budget_ms{0};
+};
+
+struct PlanningResult {
+    // As returned by PlanningService::submit.
+    uint64_t request_id{};
+    bool success{false};
+    std::vector<State> path;
+    PlanningStats stats;
+};
+
+// Runs PathOptimizer::solve on a worker thread of its own, with one optimizer kept across
+// requests. Only the newest request is kept: submitting replaces the pending one and cancels the
+// one being planned, which gives up at its next checkpoint (see
+// PathOptimizer::setCancellationToken), so the new one starts right away. The callback gets the
+// result of each request that was planned to the end, on the worker thread. Cancelled and
+// replaced requests get none.
+class PlanningService {
+ public:
+    typedef std::function<void(const PlanningResult &)> Callback;
+    explicit PlanningService(Callback callback);
+    // Cancel the current request and join the worker.
+    ~PlanningService();
+    PlanningService(const PlanningService &service) = delete;
+    PlanningService &operator=(const PlanningService &service) = delete;
+
+    // Returns the id of the request, increasing from 1.
+    uint64_t submit(PlanningRequest request);
+    // Drop the pending request and cancel the current one.
+    void cancel();
+    // Block until nothing is pending or being planned.
+    void waitUntilIdle();
+
+ private:
+    void run();
+    // Plan on the worker, false without any map.
+    bool plan(const PlanningRequest &request, const CancellationToken &token, PlanningResult *result);
+
+    const Callback callback_;
+    std::mutex mutex_;
+    // Signals a new request or stopping to the worker.
+    std::condition_variable request_condition_;
+    std::condition_variable idle_condition_;
+    PlanningRequest pending_request_;
+    uint64_t pending_id_{0};
+    bool has_pending_{false};
+    // Token of the request being planned, nullptr if the worker is idle.
+    CancellationToken *running_token_{nullptr};
+    uint64_t next_id_{1};
+    bool stop_{false};
+    // Only used by the worker, the map outlives the optimizer.
+    std::shared_ptr<const grid_map::GridMap> map_;
+    std::unique_ptr<PathOptimizer> optimizer_;
+    // Started last, once the members above are set.
+    std::thread worker_;
+};
+}
+
+#endif //PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_PLANNING_SERVICE_HPP_
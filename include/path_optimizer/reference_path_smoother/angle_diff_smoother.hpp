@@ -5,38 +5,13 @@
 #ifndef PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_REFERENCE_PATH_SMOOTHER_ANGLE_DIFF_SMOOTHER_HPP_
 #define PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_REFERENCE_PATH_SMOOTHER_ANGLE_DIFF_SMOOTHER_HPP_
 #include <vector>
-#include <cppad/cppad.hpp>
-#include <cppad/ipopt/solve.hpp>
 #include <cfloat>
 #include <tinyspline_ros/tinysplinecpp.h>
 #include "path_optimizer/data_struct/data_struct.hpp"
 #include "path_optimizer/reference_path_smoother/reference_path_smoother.hpp"
+#include "path_optimizer/reference_path_smoother/frenet_smoothing_nlp.hpp"
 namespace PathOptimizationNS {
 
-using CppAD::AD;
-class FgEvalFrenetSmooth {
- public:
-    FgEvalFrenetSmooth(const std::vector<double> &seg_x_list,
-                       const std::vector<double> &seg_y_list,
-                       const std::vector<double> &seg_angle_list,
-                       const std::vector<double> &seg_s_list,
-                       const int &N,
-                       const std::vector<double> &cost_func);
-    typedef CPPAD_TESTVECTOR(AD <double>) ADvector;
-    void operator()(ADvector &fg, const ADvector &vars);
-
- private:
-    size_t N;
-    const std::vector<double> &seg_s_list_;
-    const std::vector<double> &seg_x_list_;
-    const std::vector<double> &seg_y_list_;
-    const std::vector<double> &seg_angle_list_;
-    double cost_func_curvature_weight_{};
-    double cost_func_curvature_rate_weight_{};
-    double cost_func_bound_weight_{};
-    double cost_func_s_weight_{};
-};
-
 class AngleDiffSmoother final : public ReferencePathSmoother {
  public:
     AngleDiffSmoother() = delete;
@@ -47,7 +22,23 @@ class AngleDiffSmoother final : public ReferencePathSmoother {
 
  private:
     bool smooth(PathOptimizationNS::ReferencePath *reference_path) override;
+    bool ipoptSmooth(const Ipopt::SmartPtr<AngleDiffSmoothingNlp> &nlp, std::vector<double> *offsets) const;
+    // solveAngleDiffSqp under the token's deadline.
+    bool osqpSmooth(const AngleDiffSmoothingNlp &nlp,
+                    const std::vector<double> &lower_bound,
+                    const std::vector<double> &upper_bound,
+                    std::vector<double> *offsets) const;
 };
 
+// Minimize the cost of nlp within the bounds by trust region SQP: each iteration solves a QP built
+// from the Gauss-Newton model of the cost on OSQP, which stops at time_limit seconds if it's
+// finite. Gives up once token, which may be nullptr, is cancelled.
+bool solveAngleDiffSqp(const AngleDiffSmoothingNlp &nlp,
+                       const std::vector<double> &lower_bound,
+                       const std::vector<double> &upper_bound,
+                       double time_limit,
+                       const CancellationToken *token,
+                       std::vector<double> *offsets);
+
 }
 #endif //PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_REFERENCE_PATH_SMOOTHER_ANGLE_DIFF_SMOOTHER_HPP_
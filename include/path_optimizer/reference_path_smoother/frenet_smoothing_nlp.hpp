@@ -0,0 +1,151 @@
+#ifndef PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_REFERENCE_PATH_SMOOTHER_FRENET_SMOOTHING_NLP_HPP_
+#define PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_REFERENCE_PATH_SMOOTHER_FRENET_SMOOTHING_NLP_HPP_
+#include <vector>
+#include <mutex>
+#include <coin/IpTNLP.hpp>
+#include <coin/IpIpoptApplication.hpp>
+
+namespace PathOptimizationNS {
+class CancellationToken;
+
+// IPOPT problem over the lateral offsets d_i of the segmented raw reference, point i moves to
+// (x_i, y_i) + d_i * n_i where n_i is the left normal. There are no constraints other than the
+// variable bounds. Every cost term touches at most four consecutive offsets, so the Hessian is
+// banded and only its lower band (diagonals 0 to 3) is handed to IPOPT. Derivatives are
+// hand-coded, so no AD tape is recorded.
+class FrenetOffsetNlp : public Ipopt::TNLP {
+ public:
+    FrenetOffsetNlp(const std::vector<double> &x_list,
+                    const std::vector<double> &y_list,
+                    const std::vector<double> &angle_list,
+                    const std::vector<double> &lower_bound,
+                    const std::vector<double> &upper_bound);
+    ~FrenetOffsetNlp() override = default;
+
+    bool get_nlp_info(Ipopt::Index &n, Ipopt::Index &m, Ipopt::Index &nnz_jac_g,
+                      Ipopt::Index &nnz_h_lag, IndexStyleEnum &index_style) override;
+    bool get_bounds_info(Ipopt::Index n, Ipopt::Number *x_l, Ipopt::Number *x_u,
+                         Ipopt::Index m, Ipopt::Number *g_l, Ipopt::Number *g_u) override;
+    bool get_starting_point(Ipopt::Index n, bool init_x, Ipopt::Number *x,
+                            bool init_z, Ipopt::Number *z_L, Ipopt::Number *z_U,
+                            Ipopt::Index m, bool init_lambda, Ipopt::Number *lambda) override;
+    bool eval_g(Ipopt::Index n, const Ipopt::Number *x, bool new_x, Ipopt::Index m, Ipopt::Number *g) override;
+    bool eval_jac_g(Ipopt::Index n, const Ipopt::Number *x, bool new_x, Ipopt::Index m, Ipopt::Index nele_jac,
+                    Ipopt::Index *iRow, Ipopt::Index *jCol, Ipopt::Number *values) override;
+    bool eval_h(Ipopt::Index n, const Ipopt::Number *x, bool new_x, Ipopt::Number obj_factor,
+                Ipopt::Index m, const Ipopt::Number *lambda, bool new_lambda, Ipopt::Index nele_hess,
+                Ipopt::Index *iRow, Ipopt::Index *jCol, Ipopt::Number *values) override;
+    void finalize_solution(Ipopt::SolverReturn status, Ipopt::Index n, const Ipopt::Number *x,
+                           const Ipopt::Number *z_L, const Ipopt::Number *z_U, Ipopt::Index m,
+                           const Ipopt::Number *g, const Ipopt::Number *lambda, Ipopt::Number obj_value,
+                           const Ipopt::IpoptData *ip_data, Ipopt::IpoptCalculatedQuantities *ip_cq) override;
+    // Stops IPOPT (USER_REQUESTED_STOP) once the token is cancelled.
+    bool intermediate_callback(Ipopt::AlgorithmMode mode, Ipopt::Index iter, Ipopt::Number obj_value,
+                               Ipopt::Number inf_pr, Ipopt::Number inf_du, Ipopt::Number mu, Ipopt::Number d_norm,
+                               Ipopt::Number regularization_size, Ipopt::Number alpha_du, Ipopt::Number alpha_pr,
+                               Ipopt::Index ls_trials, const Ipopt::IpoptData *ip_data,
+                               Ipopt::IpoptCalculatedQuantities *ip_cq) override;
+    void setCancellationToken(const CancellationToken *token) { cancellation_token_ = token; }
+
+    Ipopt::SolverReturn getStatus() const { return status_; }
+    const std::vector<double> &getSolution() const { return solution_; }
+    // Number of stored diagonals of the Hessian band.
+    static constexpr int kBandWidth = 4;
+
+ protected:
+    // Accumulate scale * Hessian of the cost into band, entry (i, i - k) is band[i * kBandWidth + k].
+    virtual void addHessianBand(const Ipopt::Number *d, double scale, std::vector<double> *band) const = 0;
+    // Accumulate weight * r^2 to the cost, gradient and Hessian band, where r is a function of
+    // the offsets [begin, begin + count) with gradient r_grad and Hessian r_hess (row major,
+    // count * count, may be nullptr if r is linear). Any of the outputs may be nullptr.
+    static void addSquaredTerm(double weight, double r, const double *r_grad, const double *r_hess,
+                               int begin, int count,
+                               double *cost, double *grad, std::vector<double> *band, double scale);
+    const std::size_t size_;
+    const std::vector<double> &x_list_;
+    const std::vector<double> &y_list_;
+    // Unit normals.
+    std::vector<double> nx_, ny_;
+
+ private:
+    const std::vector<double> &lower_bound_;
+    const std::vector<double> &upper_bound_;
+    std::vector<double> band_;
+    Ipopt::SolverReturn status_{Ipopt::UNASSIGNED};
+    std::vector<double> solution_;
+    const CancellationToken *cancellation_token_{nullptr};
+};
+
+// Cost of FgEvalReferenceSmoothing: deviation, squared second difference and squared third
+// difference of the moved points. It's quadratic in d, so the Hessian is built once.
+class TensionSmoothingNlp final : public FrenetOffsetNlp {
+ public:
+    TensionSmoothingNlp(const std::vector<double> &x_list,
+                        const std::vector<double> &y_list,
+                        const std::vector<double> &angle_list,
+                        const std::vector<double> &lower_bound,
+                        const std::vector<double> &upper_bound);
+    bool eval_f(Ipopt::Index n, const Ipopt::Number *x, bool new_x, Ipopt::Number &obj_value) override;
+    bool eval_grad_f(Ipopt::Index n, const Ipopt::Number *x, bool new_x, Ipopt::Number *grad_f) override;
+
+ private:
+    void addHessianBand(const Ipopt::Number *d, double scale, std::vector<double> *band) const override;
+    void evalCost(const Ipopt::Number *d, double *cost, double *grad) const;
+    // Residual sum_k coeff[k] * P[begin + k], P being the moved points.
+    struct LinearTerm {
+        double weight;
+        int begin;
+        int count;
+        double coeff[kBandWidth];
+        double base_x, base_y;
+    };
+    std::vector<LinearTerm> terms_;
+    std::vector<double> constant_band_;
+};
+
+// Cost of the angle diff smoother: squared angle between consecutive segments, squared change
+// of that angle and deviation. The angle is atan2(cross, dot) of the two segments, which is
+// smooth as long as the path doesn't turn back on itself.
+class AngleDiffSmoothingNlp final : public FrenetOffsetNlp {
+ public:
+    AngleDiffSmoothingNlp(const std::vector<double> &x_list,
+                          const std::vector<double> &y_list,
+                          const std::vector<double> &angle_list,
+                          const std::vector<double> &lower_bound,
+                          const std::vector<double> &upper_bound,
+                          double angle_diff_weight,
+                          double angle_diff_diff_weight,
+                          double deviation_weight);
+    bool eval_f(Ipopt::Index n, const Ipopt::Number *x, bool new_x, Ipopt::Number &obj_value) override;
+    bool eval_grad_f(Ipopt::Index n, const Ipopt::Number *x, bool new_x, Ipopt::Number *grad_f) override;
+    // Accumulate the cost, gradient and Gauss-Newton Hessian band (second derivatives of the
+    // angles dropped) at d, used by the SQP smoother. Any of the outputs may be nullptr.
+    void evalGaussNewton(const double *d, double *cost, double *grad, std::vector<double> *band) const;
+
+ private:
+    void addHessianBand(const Ipopt::Number *d, double scale, std::vector<double> *band) const override;
+    void evalCost(const Ipopt::Number *d, double *cost, double *grad, std::vector<double> *band, double scale,
+                  bool gauss_newton) const;
+    const double angle_diff_weight_;
+    const double angle_diff_diff_weight_;
+    const double deviation_weight_;
+};
+
+// IPOPT's default linear solver (MUMPS) and CppAD's tapes are not thread safe. Hold this while
+// solving with either when smoothers may run concurrently.
+std::timed_mutex &getIpoptMutex();
+
+// Lock the IPOPT mutex, or give up once token is cancelled, so a smoother waiting for another
+// one's solve can still be stopped. Returns whether lock holds it.
+bool lockIpoptMutex(std::unique_lock<std::timed_mutex> *lock, const CancellationToken *token);
+
+// Run IPOPT quietly on nlp, holding the IPOPT mutex. The caller keeps its own pointer to read the solution afterwards,
+// so nlp should be created by new and owned by the SmartPtr. Returns User_Requested_Stop without
+// solving if token is cancelled while waiting for the mutex.
+Ipopt::ApplicationReturnStatus solveFrenetOffsetNlp(const Ipopt::SmartPtr<Ipopt::TNLP> &nlp,
+                                                    double max_cpu_time,
+                                                    bool hessian_constant,
+                                                    const CancellationToken *token);
+
+}
+#endif //PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_REFERENCE_PATH_SMOOTHER_FRENET_SMOOTHING_NLP_HPP_
@@ -0,0 +1,66 @@
+#ifndef PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_REFERENCE_PATH_SMOOTHER_INCREMENTAL_SMOOTHER_HPP_
+#define PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_REFERENCE_PATH_SMOOTHER_INCREMENTAL_SMOOTHER_HPP_
+#include <vector>
+#include <string>
+#include "path_optimizer/data_struct/data_struct.hpp"
+#include "path_optimizer/data_struct/reference_path.hpp"
+
+namespace PathOptimizationNS {
+
+class Map;
+struct PlanningStats;
+class CancellationToken;
+class ResizableThreadPool;
+
+// Reference smoothing across calls with a moving vehicle and a growing route. The last input and
+// result are kept. If the next input is the last one with passed points dropped from the front
+// and/or new points changed or added at the back, and the start point is close to the kept path,
+// the kept path is reused from the start point's projection on: as it is if the input is
+// unchanged, otherwise up to FLAGS_incremental_smoothing_overlap before the first changed point,
+// followed by the rest smoothed again from the kept path's state there (see stitch()).
+// Otherwise the whole input is smoothed.
+class IncrementalSmoother {
+ public:
+    // method is any value of FLAGS_smoothing_method.
+    bool solve(const std::string &method,
+               const std::vector<State> &input_points,
+               const State &start_state,
+               const Map &grid_map,
+               ReferencePath *reference_path);
+    // Forget the kept result, the next call smooths the whole input.
+    void clear();
+    // Passed to the smoothers of the following calls.
+    void setPlanningStats(PlanningStats *stats) { planning_stats_ = stats; }
+    void setCancellationToken(const CancellationToken *token) { cancellation_token_ = token; }
+    // Workers of the RACE method, see SmootherRace::setThreadPool.
+    void setRaceThreadPool(ResizableThreadPool *thread_pool) { race_thread_pool_ = thread_pool; }
+
+    // kept_path from begin_s to seam_s, followed by window_path, which starts at kept_path's
+    // position and heading at seam_s. Over the first meters of window_path the two are blended
+    // with a quintic smoothstep, whose first and second derivatives vanish at both ends of the
+    // blend, so position, heading and curvature are continuous across the seam. Catching up with
+    // window_path overshoots the curvature by about 1.2 times the curvature difference of the two
+    // paths within the blend, so the result is refused (false) if its curvature leaves the range
+    // of the two paths' around the seam by more than a small margin. The result starts at s = 0.
+    static bool stitch(const ReferencePath &kept_path, double begin_s, double seam_s,
+                       const ReferencePath &window_path, ReferencePath *reference_path);
+
+ private:
+    // Try to reuse the kept result, returns false if it can't be reused.
+    bool solveIncrementally(const std::string &method,
+                            const std::vector<State> &input_points,
+                            const State &start_state,
+                            const Map &grid_map,
+                            ReferencePath *reference_path) const;
+    void keep(const std::vector<State> &input_points, const ReferencePath &reference_path);
+    std::vector<State> previous_points_;
+    // Shares the splines with the result it was made from, they are never modified.
+    ReferencePath previous_path_;
+    bool has_previous_{false};
+    PlanningStats *planning_stats_{nullptr};
+    const CancellationToken *cancellation_token_{nullptr};
+    ResizableThreadPool *race_thread_pool_{nullptr};
+};
+}
+
+#endif //PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_REFERENCE_PATH_SMOOTHER_INCREMENTAL_SMOOTHER_HPP_
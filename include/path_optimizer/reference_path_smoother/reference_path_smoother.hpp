@@ -17,11 +17,21 @@
 #include <path_optimizer/tools/spline.h>
 #include <bits/unordered_set.h>
 #include "../data_struct/data_struct.hpp"
+#include "../data_struct/search_lattice.hpp"
+#include "../tools/indexed_heap.hpp"
+
+namespace OsqpEigen {
+class Solver;
+}
 
 namespace PathOptimizationNS {
 
 class Map;
 class ReferencePath;
+class CancellationToken;
+struct PlanningStats;
+class ReferenceLine;
+class ClearanceRaster;
 // This class uses searching method to improve the quality of the input points (if needed), and
 // then uses a smoother to obtain a smoothed reference path.
 class ReferencePathSmoother {
@@ -40,8 +50,17 @@ class ReferencePathSmoother {
 
     bool solve(PathOptimizationNS::ReferencePath *reference_path);
     std::vector<std::vector<double>> display() const;
+    // solve() gives up at its next checkpoint once the token is cancelled.
+    void setCancellationToken(const CancellationToken *token) { cancellation_token_ = token; }
+    // solve() adds the search and post-smoothing times to stats.
+    void setPlanningStats(PlanningStats *stats) { planning_stats_ = stats; }
 
  protected:
+    bool isCancelled() const;
+    // Time limit in seconds for a solver: max_cpu_time, or less if the token's deadline comes sooner.
+    double getMaxCpuTime(double max_cpu_time) const;
+    // Stop OSQP at the token's deadline, if there is one. Needs OSQP built with profiling.
+    void limitSolveTime(OsqpEigen::Solver *solver) const;
     bool segmentRawReference(std::vector<double> *x_list,
                              std::vector<double> *y_list,
                              std::vector<double> *s_list,
@@ -51,6 +70,8 @@ class ReferencePathSmoother {
     const Map &grid_map_;
     // Data to be passed into solvers.
     std::vector<double> x_list_, y_list_, s_list_;
+    const CancellationToken *cancellation_token_{nullptr};
+    PlanningStats *planning_stats_{nullptr};
 
  private:
     virtual bool smooth(PathOptimizationNS::ReferencePath *reference_path) = 0;
@@ -63,19 +84,43 @@ class ReferencePathSmoother {
     // search.
     bool graphSearch(ReferencePath *reference);
     bool graphSearchDp(ReferencePath *reference);
-    void calculateCostAt(std::vector<std::vector<DpPoint>> &samples, int layer_index, int lateral_index) const;
-    inline bool checkExistenceInClosedSet(const APoint &point) const;
-    inline double getG(const APoint &point, const APoint &parent) const;
-    inline double getH(const APoint &p) const;
+    // Sample DP nodes on the layers within their lateral ranges. On the first layer only the node
+    // at the vehicle is feasible.
+    void sampleDpLattice(const ReferenceLine &ref_line,
+                         const ClearanceRaster &raster,
+                         const std::vector<double> &layers_s,
+                         const std::vector<std::pair<double, double>> &lateral_ranges,
+                         double lateral_spacing,
+                         double vehicle_l,
+                         SearchLattice *lattice) const;
+    // Returns the best node on the farthest layer reached, -1 if none.
+    int solveDpLattice(double lateral_spacing, SearchLattice *lattice) const;
+    // Relax all nodes of a layer from the previous one.
+    void calculateLayerCost(SearchLattice *lattice, int layer_index, double lateral_spacing) const;
+    // Cost of the best path from each node to a node on last_layer, without the node's own cost,
+    // and the direction of its first edge. DBL_MAX if there's none or the node isn't reached.
+    void calculateCostToGo(const SearchLattice &lattice,
+                           int last_layer,
+                           std::vector<double> *cost_to_go,
+                           std::vector<double> *out_dir) const;
+    // Coarse DP over the whole lateral range, then narrow the ranges of layers_s_list_ to a band
+    // around the coarse paths close to the best one in cost. Returns false and keeps the ranges
+    // if the coarse search fails.
+    bool narrowLateralRanges(const ReferenceLine &ref_line,
+                             const ClearanceRaster &raster,
+                             double vehicle_l,
+                             std::vector<std::pair<double, double>> *lateral_ranges);
+    inline double getG(const SearchLattice &lattice, int node, int parent) const;
+    inline double getH(double s) const;
     const std::vector<State> &input_points_;
-    // Sampled points in searching process.
-    std::vector<std::vector<APoint>> sampled_points_;
     double target_s_{};
-    std::priority_queue<APoint *, std::vector<APoint *>, PointComparator> open_set_;
-    std::unordered_set<const APoint *> closed_set_;
     std::vector<double> layers_s_list_;
     std::vector<std::pair<double, double>> layers_bounds_;
     double vehicle_l_wrt_smoothed_ref_;
+    // Search buffers, kept across solves to spare the allocations.
+    SearchLattice lattice_, coarse_lattice_;
+    IndexedHeap open_set_;
+    std::vector<double> cost_to_go_, out_dir_;
 
 };
 }
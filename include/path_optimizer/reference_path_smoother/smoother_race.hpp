@@ -0,0 +1,48 @@
+#ifndef PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_REFERENCE_PATH_SMOOTHER_SMOOTHER_RACE_HPP_
+#define PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_REFERENCE_PATH_SMOOTHER_SMOOTHER_RACE_HPP_
+#include <vector>
+#include <string>
+
+namespace PathOptimizationNS {
+
+class Map;
+class State;
+class ReferencePath;
+class CancellationToken;
+class ResizableThreadPool;
+
+// "RACE" smoothing method: runs the smoothers listed in FLAGS_race_smoothing_methods concurrently
+// under a shared deadline (FLAGS_race_deadline_ms). With the FIRST policy the first successful
+// result wins, with BEST the smoothest (least integral of k^2) among those finished in time.
+// The losers are cancelled, and solve() returns once they have stopped because they read the
+// caller's input. They stop at their next search step, IPOPT iteration or wait for the IPOPT mutex,
+// and OSQP is limited to the deadline, so this takes about one iteration rather than a whole solve.
+// TENSION2 with tension_solver IPOPT can't be stopped within its CppAD solve, which ends at the
+// deadline at the latest. IPOPT solves take turns, so racing more than one smoother that uses
+// IPOPT gains nothing over running them in sequence.
+class SmootherRace {
+ public:
+    SmootherRace() = delete;
+    SmootherRace(const std::vector<State> &input_points,
+                 const State &start_state,
+                 const Map &grid_map);
+    bool solve(ReferencePath *reference_path);
+    // Method of the chosen result, empty if all failed.
+    const std::string &getWinner() const { return winner_; }
+    // Cancelling it ends the race early, as the deadline does.
+    void setCancellationToken(const CancellationToken *token) { cancellation_token_ = token; }
+    // Run the smoothers on thread_pool's workers, sized by FLAGS_race_thread_num, so that
+    // repeated races don't start threads. Without one, solve() starts and joins its own.
+    void setThreadPool(ResizableThreadPool *thread_pool) { thread_pool_ = thread_pool; }
+
+ private:
+    const std::vector<State> &input_points_;
+    const State &start_state_;
+    const Map &grid_map_;
+    std::string winner_;
+    const CancellationToken *cancellation_token_{nullptr};
+    ResizableThreadPool *thread_pool_{nullptr};
+};
+}
+
+#endif //PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_REFERENCE_PATH_SMOOTHER_SMOOTHER_RACE_HPP_
@@ -16,6 +16,8 @@ class Config;
 class ReferencePath;
 class VehicleState;
 class State;
+class Trajectory;
+struct PlanningStats;
 
 class OsqpSolver {
 
@@ -33,7 +35,28 @@ class OsqpSolver {
                                               const VehicleState &vehicle_state,
                                               const size_t &horizon);
 
-    virtual bool solve(std::vector<State> *optimized_path);
+    // Prepare for another solve with horizon states on the reference path, which may have changed
+    // since the last one. The OSQP problem is rebuilt, the QP buffers and the values given to the
+    // setters below are kept.
+    void reset(size_t horizon);
+    // Adds the setup and solve times and the OSQP result to stats if it's not null.
+    virtual bool solve(Trajectory *optimized_path, PlanningStats *stats = nullptr);
+    // Pull the lateral offsets from the reference towards offset (positive to the left) with weight,
+    // on top of the deviation cost. Call before solve().
+    void setLateralPreference(double offset, double weight);
+    // Start OSQP from the primal solution of a problem of the same size, e.g. another candidate's.
+    void setWarmStart(const Eigen::VectorXd &primal_variable);
+    // Primal solution of the last successful solve.
+    const Eigen::VectorXd &getSolution() const { return solution_; }
+    // Stop OSQP after time_limit_ms or max_iteration if it's positive, and take the iterate it
+    // stopped at instead of failing. The caller has to check the result, e.g. for collision.
+    void setTimeBudget(double time_limit_ms, int max_iteration);
+    // The last solve stopped at the budget before converging.
+    bool isEarlyStopped() const { return early_stopped_; }
+    // Whether the iterate OSQP stopped at with status may be used: the budget stopped it rather than
+    // infeasibility, the iterate is finite and it violates the constraints by at most
+    // FLAGS_qp_early_stop_max_primal_residual.
+    static bool isUsableEarlyStop(int status, double primal_residual, const Eigen::VectorXd &iterate);
 
  private:
     // Set Matrices for osqp solver.
@@ -43,15 +66,29 @@ class OsqpSolver {
                                      Eigen::VectorXd *lower_bound,
                                      Eigen::VectorXd *upper_bound) const = 0;
     virtual void getOptimizedPath(const Eigen::VectorXd &optimization_result,
-                                  std::vector<State> *optimized_path) const = 0;
+                                  Trajectory *optimized_path) const = 0;
+    // Index of the lateral offset of the ith state among the variables.
+    virtual size_t offsetIndex(size_t i) const = 0;
+    void updateReferenceInterval();
 
  protected:
-    const size_t horizon_{};
+    // Set num_of_variables_, num_of_constraints_ and the sizes of the subclass from horizon_ and
+    // reference_interval_. Called by the subclass' constructor and by reset().
+    virtual void setProblemSize() = 0;
+    size_t horizon_{};
     const ReferencePath &reference_path_;
     const VehicleState &vehicle_state_;
     OsqpEigen::Solver solver_;
     double reference_interval_;
     int num_of_variables_, num_of_constraints_;
+    double lateral_preference_{}, lateral_preference_weight_{};
+    Eigen::VectorXd warm_start_, solution_;
+    // QP problem, kept to reuse the memory.
+    Eigen::SparseMatrix<double> hessian_, linear_matrix_;
+    Eigen::VectorXd gradient_, lower_bound_, upper_bound_;
+    double time_limit_ms_{0};
+    int max_iteration_{0};
+    bool early_stopped_{false};
 
 };
 
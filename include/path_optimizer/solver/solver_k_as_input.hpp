@@ -32,7 +32,9 @@ class SolverKAsInput : public OsqpSolver {
                              Eigen::VectorXd *lower_bound,
                              Eigen::VectorXd *upper_bound) const override;
     void getOptimizedPath(const Eigen::VectorXd &optimization_result,
-                          std::vector<State> *optimized_path) const override;
+                          Trajectory *optimized_path) const override;
+    void setProblemSize() override;
+    size_t offsetIndex(size_t i) const override { return 2 * i + 1; }
 };
 } // namespace
 #endif //PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_SOLVER_K_AS_INPUT_HPP_
@@ -19,7 +19,7 @@ class SolverKpAsInput : public OsqpSolver {
 
     ~SolverKpAsInput() override = default;
 
-//  bool solve(std::vector<State> *optimized_path) override ;
+//  bool solve(Trajectory *optimized_path) override ;
 
  private:
 
@@ -29,12 +29,14 @@ class SolverKpAsInput : public OsqpSolver {
                              Eigen::VectorXd *lower_bound,
                              Eigen::VectorXd *upper_bound) const override;
     void getOptimizedPath(const Eigen::VectorXd &optimization_result,
-                          std::vector<PathOptimizationNS::State> *optimized_path) const override;
-    const int keep_control_steps_{};
-    const size_t control_horizon_{};
-    const size_t state_size_{};
-    const size_t control_size_{};
-    const size_t slack_size_{};
+                          Trajectory *optimized_path) const override;
+    void setProblemSize() override;
+    size_t offsetIndex(size_t i) const override { return 3 * i; }
+    int keep_control_steps_{};
+    size_t control_horizon_{};
+    size_t state_size_{};
+    size_t control_size_{};
+    size_t slack_size_{};
 };
 }
 
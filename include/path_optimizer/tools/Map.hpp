@@ -8,6 +8,7 @@
 #include <iostream>
 #include <cassert>
 #include <stdexcept>
+#include <cstdint>
 #include "Eigen/Core"
 #include <grid_map_core/grid_map_core.hpp>
 
@@ -17,11 +18,17 @@ class Map {
  public:
     Map() = delete;
     explicit Map(const grid_map::GridMap &grid_map);
+    // Point to another grid map, which must outlive this object as well.
+    // Bumps the version, also when called with the same grid map after changing it in place.
+    void setGridMap(const grid_map::GridMap &grid_map);
+    // Changes whenever the grid map is set, so results computed on it can be told apart.
+    uint64_t getVersion() const { return version_; }
     double getObstacleDistance(const Eigen::Vector2d &pos) const;
     bool isInside(const Eigen::Vector2d &pos) const;
 
  private:
-    const grid_map::GridMap &maps;
+    const grid_map::GridMap *maps;
+    uint64_t version_{0};
 };
 }
 
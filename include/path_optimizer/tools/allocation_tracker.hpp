@@ -0,0 +1,34 @@
+#ifndef PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_TOOLS_ALLOCATION_TRACKER_HPP_
+#define PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_TOOLS_ALLOCATION_TRACKER_HPP_
+#include <cstdint>
+
+// Heap allocation accounting, built with the PATH_OPTIMIZER_ENABLE_ALLOCATION_TRACKING CMake
+// option, which replaces the global operator new and delete. Each thread counts its allocations
+// under its current tag; StageTimer tags allocations with its stage and reports them into
+// PlanningStats, nested stages excluded. Only operator new is seen: Eigen, OSQP and IPOPT
+// allocate with malloc directly and aren't counted.
+
+namespace PathOptimizationNS {
+namespace allocation_tracker {
+
+// Tags are in [0, kTagNum).
+const int kTagNum = 16;
+const int kNoTag = -1;
+
+struct AllocationCount {
+    uint64_t calls{};
+    uint64_t bytes{};
+};
+
+#ifdef PATH_OPTIMIZER_ENABLE_ALLOCATION_TRACKING
+// Set the tag of the calling thread's allocations, returns the previous one.
+int setTag(int tag);
+// Allocations of the calling thread under a tag (or kNoTag) since the thread started.
+AllocationCount getThreadCount(int tag);
+// Allocations of all threads since the process started.
+AllocationCount getTotalCount();
+#endif
+}
+}
+
+#endif //PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_TOOLS_ALLOCATION_TRACKER_HPP_
@@ -0,0 +1,38 @@
+#ifndef PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_TOOLS_B_SPLINE_HPP_
+#define PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_TOOLS_B_SPLINE_HPP_
+#include <vector>
+#include <cstddef>
+
+namespace PathOptimizationNS {
+class State;
+
+// Planar clamped B-spline on t in [0, 1] with uniformly spaced interior knots, the same curve
+// as tinyspline's default TS_CLAMPED spline. Points are evaluated by de Boor's algorithm on
+// stack buffers, so sampling doesn't allocate except for the output vectors.
+class ClampedBSpline {
+ public:
+    static constexpr int kMaxDegree = 5;
+    // The degree is reduced to control_points.size() - 1 if there are too few points.
+    ClampedBSpline(const std::vector<State> &control_points, int degree);
+    int getDegree() const { return degree_; }
+    // Position and first derivative w.r.t. t. Any of the outputs may be nullptr.
+    void evaluate(double t, double *x, double *y, double *dx, double *dy) const;
+    // Walk the curve once, stepping t by ds / |C'(t)| so that neighbouring samples are about
+    // ds apart. The end point is always included, s is the accumulated chord length.
+    void sampleByArcLength(double ds,
+                           std::vector<double> *x_list,
+                           std::vector<double> *y_list,
+                           std::vector<double> *s_list) const;
+
+ private:
+    // Knot span containing t, i.e. knots_[span] <= t < knots_[span + 1], searching forward
+    // from hint.
+    std::size_t findSpan(double t, std::size_t hint) const;
+    void evaluateInSpan(std::size_t span, double t, double *x, double *y, double *dx, double *dy) const;
+    int degree_;
+    std::vector<double> knots_;
+    std::vector<double> ctrl_x_, ctrl_y_;
+};
+}
+
+#endif //PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_TOOLS_B_SPLINE_HPP_
@@ -0,0 +1,37 @@
+#ifndef PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_TOOLS_CANCELLATION_TOKEN_HPP_
+#define PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_TOOLS_CANCELLATION_TOKEN_HPP_
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+namespace PathOptimizationNS {
+
+// Cooperative cancellation. The owner calls cancel() (or lets the deadline pass), running work
+// polls isCancelled() at its checkpoints and gives up. Nothing is interrupted forcibly. A token
+// with a parent is also cancelled with it, so a stage can get a tighter deadline than the whole.
+class CancellationToken {
+ public:
+    using Clock = std::chrono::steady_clock;
+    explicit CancellationToken(Clock::time_point deadline = Clock::time_point::max(),
+                               const CancellationToken *parent = nullptr) :
+        deadline_(deadline), parent_(parent) {}
+    CancellationToken(const CancellationToken &) = delete;
+    CancellationToken &operator=(const CancellationToken &) = delete;
+    void cancel() { cancelled_.store(true, std::memory_order_relaxed); }
+    bool isCancelled() const {
+        return cancelled_.load(std::memory_order_relaxed) || Clock::now() >= deadline_
+            || (parent_ && parent_->isCancelled());
+    }
+    // The earliest of its own and its parents' deadlines.
+    Clock::time_point getDeadline() const {
+        return parent_ ? std::min(deadline_, parent_->getDeadline()) : deadline_;
+    }
+
+ private:
+    std::atomic<bool> cancelled_{false};
+    const Clock::time_point deadline_;
+    const CancellationToken *parent_;
+};
+}
+
+#endif //PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_TOOLS_CANCELLATION_TOKEN_HPP_
@@ -0,0 +1,54 @@
+#ifndef PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_TOOLS_CLEARANCE_RASTER_HPP_
+#define PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_TOOLS_CLEARANCE_RASTER_HPP_
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace PathOptimizationNS {
+
+class Map;
+class ReferenceLine;
+
+// Obstacle distance on an (s, l) grid along a reference line, read by the graph searches: the
+// search nodes and the rough bounds of the searched path lie on its cells. Rows are stations with
+// cached position and normal, columns are lateral offsets. A cell is sampled from the map the
+// first time it's read and kept, so the searches only pay for the band they explore, and the
+// rough bounds reuse the cells the nodes sampled. Reads fill the cache, so a raster must not be
+// shared between threads.
+class ClearanceRaster {
+ public:
+    // Rows at s_begin, s_begin + ds, ... and s_end, columns at l = -max_l + j * dl.
+    void build(const ReferenceLine &reference_line,
+               const Map &map,
+               double s_begin,
+               double s_end,
+               double max_l,
+               double ds,
+               double dl);
+    void clear();
+    bool empty() const { return row_s_.empty(); }
+    // Whether it was built with these arguments, on the map's current version.
+    bool matches(const Map &map, double s_begin, double s_end, double max_l, double ds, double dl) const;
+
+    // Row nearest to s, clamped into the raster.
+    int getRow(double s) const;
+    std::size_t getRowNum() const { return row_s_.size(); }
+    double getRowS(int row) const { return row_s_[row]; }
+    // Obstacle distance at the cell nearest to offset l on a row, 0 outside the map like
+    // Map::getObstacleDistance. Offsets beyond max_l are sampled directly and not kept.
+    double getDistance(int row, double l) const;
+
+ private:
+    double sample(int row, double l) const;
+    double getCell(int row, int column) const;
+    const Map *map_{nullptr};
+    uint64_t map_version_{};
+    double s_begin_{}, s_end_{}, max_l_{}, ds_{}, dl_{};
+    int column_num_{};
+    std::vector<double> row_s_, row_x_, row_y_, row_cos_, row_sin_;
+    // NaN until sampled.
+    mutable std::vector<float> cells_;
+};
+}
+
+#endif //PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_TOOLS_CLEARANCE_RASTER_HPP_
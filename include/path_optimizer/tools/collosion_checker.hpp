@@ -17,14 +17,32 @@ class CollisionChecker {
 public:
     CollisionChecker() = delete;
     CollisionChecker(const grid_map::GridMap &in_gm);
+    void setMap(const grid_map::GridMap &in_gm);
 
     bool isSingleStateCollisionFreeImproved(const State &current);
 
     bool isSingleStateCollisionFree(const State &current);
 
+    // Check the motion between two consecutive states, including the target state. The motion may be
+    // any curve turning by less than pi whose curvature stays within the states' curvatures and the
+    // curvature of the arc joining them, e.g. a spline segment between output states. The volume
+    // swept by the vehicle is bounded conservatively using the distance field, so thin obstacles
+    // between sparse samples can't be missed.
+    bool isMotionCollisionFree(const State &from, const State &to);
 
 private:
-    const Map map_;
+    // Whether a circle of radius r is collision free with its center anywhere in the part of the
+    // ellipse with foci from and to and major axis length that lies between u0 and u1 along the
+    // axis, measured from the middle of the foci. The part is halved until it's proven free or
+    // the depth limit is reached.
+    bool isEllipseCollisionFree(const grid_map::Position &from,
+                                const grid_map::Position &to,
+                                double length,
+                                double u0,
+                                double u1,
+                                double r,
+                                int depth);
+    Map map_;
     CarGeometry car_;
 };
 
@@ -0,0 +1,44 @@
+#ifndef PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_TOOLS_DEADLINE_HPP_
+#define PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_TOOLS_DEADLINE_HPP_
+#include <chrono>
+#include <limits>
+#include <algorithm>
+
+namespace PathOptimizationNS {
+
+// Point in time a computation should be done by, or none. Stages of a computation under a
+// latency budget take a share of the time left, so a stage finishing early leaves more to the
+// following ones.
+class Deadline {
+ public:
+    typedef std::chrono::steady_clock Clock;
+    Deadline() : time_(Clock::time_point::max()) {}
+    explicit Deadline(Clock::time_point time) : time_(time) {}
+    // budget_ms from now, none if it's not positive.
+    static Deadline fromBudget(double budget_ms) {
+        if (budget_ms <= 0) return Deadline();
+        return Deadline(Clock::now() + std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double, std::milli>(budget_ms)));
+    }
+    bool isSet() const { return time_ != Clock::time_point::max(); }
+    Clock::time_point getTime() const { return time_; }
+    bool isExpired() const { return isSet() && Clock::now() >= time_; }
+    // Negative once expired, infinity if not set.
+    double getRemainingMs() const {
+        if (!isSet()) return std::numeric_limits<double>::infinity();
+        return std::chrono::duration<double, std::milli>(time_ - Clock::now()).count();
+    }
+    // The fraction of the time left from now, none if this is none.
+    Deadline share(double fraction) const {
+        if (!isSet()) return Deadline();
+        const auto now = Clock::now();
+        if (now >= time_) return *this;
+        return Deadline(now + std::chrono::duration_cast<Clock::duration>((time_ - now) * std::min(fraction, 1.0)));
+    }
+
+ private:
+    Clock::time_point time_;
+};
+}
+
+#endif //PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_TOOLS_DEADLINE_HPP_
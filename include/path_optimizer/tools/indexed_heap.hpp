@@ -0,0 +1,81 @@
+#ifndef PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_TOOLS_INDEXED_HEAP_HPP_
+#define PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_TOOLS_INDEXED_HEAP_HPP_
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+namespace PathOptimizationNS {
+
+// Binary min-heap of integer ids with double keys and decrease-key. The position of each id is
+// kept in a table indexed by id, so ids should be dense, e.g. lattice node indices. Equal keys
+// are ordered by id. clear() keeps the capacity.
+class IndexedHeap {
+ public:
+    void clear() {
+        heap_.clear();
+        position_.clear();
+    }
+    bool empty() const { return heap_.empty(); }
+    std::size_t size() const { return heap_.size(); }
+    bool contains(int id) const {
+        return static_cast<std::size_t>(id) < position_.size() && position_[id] >= 0;
+    }
+    int top() const { return heap_.front().second; }
+    double topKey() const { return heap_.front().first; }
+
+    // id must not be in the heap.
+    void push(int id, double key) {
+        if (static_cast<std::size_t>(id) >= position_.size()) position_.resize(id + 1, -1);
+        heap_.emplace_back(key, id);
+        position_[id] = static_cast<int>(heap_.size()) - 1;
+        siftUp(heap_.size() - 1);
+    }
+    // Lower the key of an id in the heap. A key that isn't lower is ignored.
+    void decreaseKey(int id, double key) {
+        const auto i = static_cast<std::size_t>(position_[id]);
+        if (!(key < heap_[i].first)) return;
+        heap_[i].first = key;
+        siftUp(i);
+    }
+    void pop() {
+        position_[heap_.front().second] = -1;
+        if (heap_.size() > 1) {
+            heap_.front() = heap_.back();
+            position_[heap_.front().second] = 0;
+        }
+        heap_.pop_back();
+        if (!heap_.empty()) siftDown(0);
+    }
+
+ private:
+    void siftUp(std::size_t i) {
+        while (i > 0) {
+            const std::size_t parent = (i - 1) / 2;
+            if (!(heap_[i] < heap_[parent])) break;
+            swapEntries(i, parent);
+            i = parent;
+        }
+    }
+    void siftDown(std::size_t i) {
+        while (true) {
+            const std::size_t left = 2 * i + 1, right = left + 1;
+            std::size_t smallest = i;
+            if (left < heap_.size() && heap_[left] < heap_[smallest]) smallest = left;
+            if (right < heap_.size() && heap_[right] < heap_[smallest]) smallest = right;
+            if (smallest == i) break;
+            swapEntries(i, smallest);
+            i = smallest;
+        }
+    }
+    void swapEntries(std::size_t i, std::size_t j) {
+        std::swap(heap_[i], heap_[j]);
+        position_[heap_[i].second] = static_cast<int>(i);
+        position_[heap_[j].second] = static_cast<int>(j);
+    }
+    // (key, id) pairs.
+    std::vector<std::pair<double, int>> heap_;
+    std::vector<int> position_;
+};
+}
+
+#endif //PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_TOOLS_INDEXED_HEAP_HPP_
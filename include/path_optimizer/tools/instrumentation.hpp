@@ -0,0 +1,94 @@
+#ifndef PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_TOOLS_INSTRUMENTATION_HPP_
+#define PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_TOOLS_INSTRUMENTATION_HPP_
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Hot path counters and trace spans for profiling, built with the PATH_OPTIMIZER_ENABLE_INSTRUMENTATION
+// CMake option. Without it the macros expand to nothing, so instrumented sites cost nothing, and
+// the functions below return empty results.
+//   PATH_OPTIMIZER_COUNT(kObstacleDistance);           // one event at a hot site
+//   PATH_OPTIMIZER_COUNT_N(kSearchEdge, edge_num);     // n events, n isn't evaluated if disabled
+//   PATH_OPTIMIZER_TRACE_SPAN("name");                 // span until the end of the scope
+// StageTimer records a span for each planning stage as well.
+
+namespace PathOptimizationNS {
+namespace instrumentation {
+
+enum Counter {
+    // Map::getObstacleDistance calls.
+    kObstacleDistance,
+    // tk::spline evaluations, each point of a batch evaluation counts.
+    kSplineEvaluation,
+    // Edges tried by the DP and A* graph searches.
+    kSearchEdge,
+    // Circles checked by the collision checker, including swept circles.
+    kCollisionCircle,
+    kCounterNum
+};
+const char *counterName(Counter counter);
+using Counters = std::array<uint64_t, kCounterNum>;
+
+// Sums over all threads that ever counted, including finished ones.
+Counters getCounters();
+void resetCounters();
+// Write the recorded spans and the counters of each thread as Chrome trace JSON, viewable in
+// chrome://tracing or Perfetto.
+bool writeChromeTrace(const std::string &file_name);
+void clearTrace();
+
+#ifdef PATH_OPTIMIZER_ENABLE_INSTRUMENTATION
+// Per thread data. The owning thread counts and resetCounters() zeroes from any thread, so counting
+// is a relaxed atomic add, which a concurrent reset can't lose.
+struct ThreadRecord {
+    ThreadRecord();
+    int thread_index;
+    std::atomic<uint64_t> counters[kCounterNum];
+};
+// Create the record of the calling thread. Records are owned by a global registry and outlive
+// their threads.
+ThreadRecord *registerThread();
+inline ThreadRecord &threadRecord() {
+    static thread_local ThreadRecord *record = registerThread();
+    return *record;
+}
+inline void count(Counter counter, uint64_t n) {
+    threadRecord().counters[counter].fetch_add(n, std::memory_order_relaxed);
+}
+// name must outlive the trace, e.g. a string literal.
+void addTraceEvent(const char *name,
+                   const std::chrono::steady_clock::time_point &begin,
+                   const std::chrono::steady_clock::time_point &end);
+class TraceSpan {
+ public:
+    explicit TraceSpan(const char *name) : name_(name), begin_(std::chrono::steady_clock::now()) {}
+    ~TraceSpan() { addTraceEvent(name_, begin_, std::chrono::steady_clock::now()); }
+    TraceSpan(const TraceSpan &span) = delete;
+    TraceSpan &operator=(const TraceSpan &span) = delete;
+
+ private:
+    const char *name_;
+    const std::chrono::steady_clock::time_point begin_;
+};
+#endif
+}
+}
+
+#ifdef PATH_OPTIMIZER_ENABLE_INSTRUMENTATION
+#define PATH_OPTIMIZER_COUNT(counter) \
+    ::PathOptimizationNS::instrumentation::count(::PathOptimizationNS::instrumentation::counter, 1)
+#define PATH_OPTIMIZER_COUNT_N(counter, n) \
+    ::PathOptimizationNS::instrumentation::count(::PathOptimizationNS::instrumentation::counter, (n))
+#define PATH_OPTIMIZER_CONCAT_IMPL(a, b) a##b
+#define PATH_OPTIMIZER_CONCAT(a, b) PATH_OPTIMIZER_CONCAT_IMPL(a, b)
+#define PATH_OPTIMIZER_TRACE_SPAN(name) \
+    ::PathOptimizationNS::instrumentation::TraceSpan PATH_OPTIMIZER_CONCAT(trace_span_, __LINE__)(name)
+#else
+#define PATH_OPTIMIZER_COUNT(counter) ((void) 0)
+#define PATH_OPTIMIZER_COUNT_N(counter, n) ((void) 0)
+#define PATH_OPTIMIZER_TRACE_SPAN(name) ((void) 0)
+#endif
+
+#endif //PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_TOOLS_INSTRUMENTATION_HPP_
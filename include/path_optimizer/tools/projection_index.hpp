@@ -0,0 +1,55 @@
+#ifndef PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_TOOLS_PROJECTION_INDEX_HPP_
+#define PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_TOOLS_PROJECTION_INDEX_HPP_
+#include <vector>
+
+namespace PathOptimizationNS {
+
+class State;
+class ReferenceLine;
+
+// Closest point queries on a reference line. The line is cut into short chords which are
+// hashed into a uniform grid, so a query only checks the chords in the cells around it, ring by
+// ring, until no closer chord can exist. The closest chord is then refined by Newton's method on
+// the line. A hint s, e.g. the result of the previous query when walking
+// along a path, seeds the search and usually ends it in the first ring.
+// The line must outlive the index and stay unchanged.
+class ProjectionIndex {
+ public:
+    // Chords between samples sample_spacing apart, cells of cell_size.
+    void build(const ReferenceLine &reference_line, double sample_spacing = 0.5, double cell_size = 2.0);
+    void clear();
+    bool empty() const { return sample_s_.empty(); }
+
+    // Closest point on the line, with x, y, heading, curvature and s. s is in [0, length].
+    // A negative hint_s means no hint.
+    State getProjection(double x, double y, double hint_s = -1) const;
+    // Frenet coordinates of a point, l is positive on the left.
+    void cartesianToFrenet(double x, double y, double *s, double *l, double hint_s = -1) const;
+    // Batch versions. Points are expected to be ordered along the line, each query is hinted by
+    // the previous result.
+    void cartesianToFrenet(const std::vector<double> &x_list,
+                           const std::vector<double> &y_list,
+                           std::vector<double> *s_list,
+                           std::vector<double> *l_list) const;
+    void frenetToCartesian(const std::vector<double> &s_list,
+                           const std::vector<double> &l_list,
+                           std::vector<double> *x_list,
+                           std::vector<double> *y_list) const;
+
+ private:
+    // Cells overlapped by the bounding box of a chord.
+    void getChordCells(int chord, std::vector<int> *cells) const;
+    // Squared distance from (x, y) to a chord and the s of the closest point on it.
+    double chordDistance(int chord, double x, double y, double *s) const;
+    // Newton refinement of a chord result, falls back to s if it ends farther away.
+    double refine(double x, double y, double s) const;
+    const ReferenceLine *reference_line_{nullptr};
+    std::vector<double> sample_s_, sample_x_, sample_y_;
+    double min_x_{}, min_y_{}, cell_size_{};
+    int column_num_{}, row_num_{};
+    // Chords of cell i are cell_chords_[cell_begin_[i]] to cell_chords_[cell_begin_[i + 1] - 1].
+    std::vector<int> cell_begin_, cell_chords_;
+};
+}
+
+#endif //PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_TOOLS_PROJECTION_INDEX_HPP_
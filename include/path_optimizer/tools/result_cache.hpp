@@ -0,0 +1,111 @@
+#ifndef PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_TOOLS_RESULT_CACHE_HPP_
+#define PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_TOOLS_RESULT_CACHE_HPP_
+#include <array>
+#include <list>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <unordered_map>
+#include "path_optimizer/data_struct/data_struct.hpp"
+
+namespace PathOptimizationNS {
+
+class ReferencePath;
+namespace tk {
+class spline;
+}
+
+// Fixed capacity map dropping the least recently used entry when it's full.
+template<typename Key, typename Value, typename Hash>
+class LruCache {
+ public:
+    // nullptr if key isn't cached. Valid until the next put() or clear().
+    const Value *get(const Key &key) {
+        const auto it = index_.find(key);
+        if (it == index_.end()) return nullptr;
+        entries_.splice(entries_.begin(), entries_, it->second);
+        return &it->second->second;
+    }
+    void put(const Key &key, Value value, std::size_t capacity) {
+        const auto it = index_.find(key);
+        if (it != index_.end()) {
+            entries_.erase(it->second);
+            index_.erase(it);
+        }
+        while (!entries_.empty() && entries_.size() >= capacity) {
+            index_.erase(entries_.back().first);
+            entries_.pop_back();
+        }
+        if (capacity == 0) return;
+        entries_.emplace_front(key, std::move(value));
+        index_[key] = entries_.begin();
+    }
+    void clear() {
+        entries_.clear();
+        index_.clear();
+    }
+    std::size_t size() const { return entries_.size(); }
+
+ private:
+    typedef std::list<std::pair<Key, Value>> List;
+    // Most recently used first.
+    List entries_;
+    std::unordered_map<Key, typename List::iterator, Hash> index_;
+};
+
+// Smoothed references and final paths of a PathOptimizer, addressed by the planning input: a hash
+// of the reference points, the start and goal quantized by FLAGS_result_cache_position_resolution,
+// FLAGS_result_cache_angle_resolution and FLAGS_result_cache_curvature_resolution, a hash of the
+// flags the results depend on and the map version.
+// A reference is kept without the goal, which only cuts it later, so a new goal on the same
+// reference still skips the smoothing. Each kind keeps up to FLAGS_result_cache_capacity entries,
+// none if it's 0. The reference points are compared by their 64 bit hash only.
+class ResultCache {
+ public:
+    struct Key {
+        uint64_t reference_hash{};
+        uint64_t config_hash{};
+        uint64_t map_version{};
+        // Quantized x, y, heading and curvature.
+        std::array<int64_t, 4> start{};
+        // Quantized x, y and heading, 0 for references.
+        std::array<int64_t, 3> goal{};
+        bool operator==(const Key &key) const;
+    };
+    struct KeyHash {
+        std::size_t operator()(const Key &key) const;
+    };
+
+    bool enabled() const;
+    // Key the following calls with this input.
+    void setInput(const std::vector<State> &reference_points,
+                  const State &start_state,
+                  const State &end_state,
+                  uint64_t map_version);
+    // Set reference_path to the kept smoothed reference of the input, without its reference states.
+    bool findReference(ReferencePath *reference_path);
+    // Keep the smoothed reference of the input, before it's cut at the goal.
+    void putReference(const ReferencePath &reference_path);
+    bool findPath(std::vector<State> *path);
+    void putPath(const std::vector<State> &path);
+    void clear();
+    // Counted since construction, lookups once per setInput() with the cache enabled.
+    uint64_t getLookups() const { return lookups_; }
+    uint64_t getReferenceHits() const { return reference_hits_; }
+    uint64_t getPathHits() const { return path_hits_; }
+
+ private:
+    struct CachedReference {
+        std::shared_ptr<const tk::spline> x_s, y_s;
+        double length{};
+    };
+    bool has_input_{false};
+    Key reference_key_, path_key_;
+    LruCache<Key, CachedReference, KeyHash> references_;
+    LruCache<Key, std::vector<State>, KeyHash> paths_;
+    uint64_t lookups_{0}, reference_hits_{0}, path_hits_{0};
+};
+}
+
+#endif //PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_TOOLS_RESULT_CACHE_HPP_
@@ -42,37 +42,6 @@
 namespace PathOptimizationNS {
 namespace tk {
 
-// band matrix solver
-class band_matrix {
-private:
-    std::vector<std::vector<double> > m_upper;  // upper band
-    std::vector<std::vector<double> > m_lower;  // lower band
-public:
-    band_matrix() {};                             // constructor
-    band_matrix(int dim, int n_u, int n_l);       // constructor
-    ~band_matrix() {};                            // destructor
-    void resize(int dim, int n_u, int n_l);      // init with dim,n_u,n_l
-    int dim() const;                             // matrix dimension
-    int num_upper() const {
-        return m_upper.size() - 1;
-    }
-    int num_lower() const {
-        return m_lower.size() - 1;
-    }
-    // access operator
-    double &operator()(int i, int j);            // write
-    double operator()(int i, int j) const;      // read
-    // we can store an additional diogonal (in m_lower)
-    double &saved_diag(int i);
-    double saved_diag(int i) const;
-    void lu_decompose();
-    std::vector<double> r_solve(const std::vector<double> &b) const;
-    std::vector<double> l_solve(const std::vector<double> &b) const;
-    std::vector<double> lu_solve(const std::vector<double> &b,
-                                 bool is_lu_decomposed = false);
-
-};
-
 // spline interpolation
 class spline {
 public:
@@ -82,10 +51,11 @@ public:
     };
 
 private:
-    std::vector<double> m_x, m_y;            // x,y coordinates of points
-    // interpolation parameters
+    // x,y coordinates of points and the interpolation parameters, stored
+    // in one flat buffer of 5 * m_n values: [x | y | a | b | c]
     // f(x) = a*(x-x_i)^3 + b*(x-x_i)^2 + c*(x-x_i) + y_i
-    std::vector<double> m_a, m_b, m_c;        // spline coefficients
+    std::vector<double> m_coef;
+    size_t m_n;
     double m_b0, m_c0;                     // for left extrapol
     bd_type m_left, m_right;
     double m_left_value, m_right_value;
@@ -93,20 +63,51 @@ private:
 
 public:
     // set default boundary condition to be zero curvature at both ends
-    spline() : m_left(second_deriv), m_right(second_deriv),
+    spline() : m_n(0), m_b0(0.0), m_c0(0.0),
+               m_left(second_deriv), m_right(second_deriv),
                m_left_value(0.0), m_right_value(0.0),
                m_force_linear_extrapolation(false) {
         ;
     }
 
+    // number of points
+    size_t size() const {
+        return m_n;
+    }
+
     // optional, but if called it has to come be before set_points()
     void set_boundary(bd_type left, double left_value,
                       bd_type right, double right_value,
                       bool force_linear_extrapolation = false);
     void set_points(const std::vector<double> &x,
                     const std::vector<double> &y, bool cubic_spline = true);
+    // drop the part left of x0 and shift x by -x0, the remaining curve is
+    // unchanged. x0 must be within [x_0, x_{n-1}).
+    void trim_left(double x0);
     double operator()(double x) const;
     double deriv(int order, double x) const;
+    // value, 1st and 2nd derivative at x with a single interval search.
+    // d1 and d2 may be nullptr.
+    void evaluate(double x, double *value, double *d1, double *d2) const;
+    // batch version of evaluate(), x must be sorted in ascending order.
+    // the knot interval is tracked by a cursor, so no search is needed.
+    void evaluate(const std::vector<double> &x, std::vector<double> *value,
+                  std::vector<double> *d1, std::vector<double> *d2) const;
+
+private:
+    // index of the closest point m_x[idx] < x, idx=0 even if x<m_x[0]
+    size_t find_interval(double x) const;
+    void evaluate_at(size_t idx, double x, double *value, double *d1, double *d2) const;
+    double *px() { return m_coef.data(); }
+    double *py() { return m_coef.data() + m_n; }
+    double *pa() { return m_coef.data() + 2 * m_n; }
+    double *pb() { return m_coef.data() + 3 * m_n; }
+    double *pc() { return m_coef.data() + 4 * m_n; }
+    const double *px() const { return m_coef.data(); }
+    const double *py() const { return m_coef.data() + m_n; }
+    const double *pa() const { return m_coef.data() + 2 * m_n; }
+    const double *pb() const { return m_coef.data() + 3 * m_n; }
+    const double *pc() const { return m_coef.data() + 4 * m_n; }
 };
 
 } // namespace tk
@@ -0,0 +1,65 @@
+#ifndef PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_TOOLS_THREAD_POOL_HPP_
+#define PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_TOOLS_THREAD_POOL_HPP_
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <type_traits>
+
+namespace PathOptimizationNS {
+
+// Fixed number of worker threads running submitted tasks in FIFO order. The destructor finishes
+// the queued tasks and joins the workers.
+class ThreadPool {
+ public:
+    explicit ThreadPool(std::size_t thread_num);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    std::size_t size() const { return workers_.size(); }
+    // Run task on a worker, the future holds its result.
+    template<class F>
+    std::future<typename std::result_of<F()>::type> submit(F &&task);
+
+ private:
+    void run();
+    std::vector<std::thread> workers_;
+    std::queue<std::function<void()>> tasks_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    bool stop_{false};
+};
+
+// A shared ThreadPool, replaced by a new one when it's asked for another size, e.g. after a flag
+// changed. Callers keep the returned pool until their tasks are done, the old pool is joined by
+// the last of them.
+class ResizableThreadPool {
+ public:
+    std::shared_ptr<ThreadPool> get(std::size_t thread_num);
+
+ private:
+    std::mutex mutex_;
+    std::shared_ptr<ThreadPool> pool_;
+};
+
+template<class F>
+std::future<typename std::result_of<F()>::type> ThreadPool::submit(F &&task) {
+    using Result = typename std::result_of<F()>::type;
+    // std::function needs a copyable callable, so the packaged task is shared.
+    auto packaged_task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+    auto future = packaged_task->get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.emplace([packaged_task] { (*packaged_task)(); });
+    }
+    condition_.notify_one();
+    return future;
+}
+}
+
+#endif //PATH_OPTIMIZER_INCLUDE_PATH_OPTIMIZER_TOOLS_THREAD_POOL_HPP_
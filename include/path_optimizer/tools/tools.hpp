@@ -53,6 +53,23 @@ double getHeading(const tk::spline &xs, const tk::spline &ys, double s);
 // Calculate curvature for spline.
 double getCurvature(const tk::spline &xs, const tk::spline &ys, double tmp_s);
 
+// Derivative buffers of evaluateSplines. Callers evaluating repeatedly keep one to spare the
+// allocations.
+struct SplineDerivatives {
+    std::vector<double> x_d1, y_d1, x_d2, y_d2;
+};
+
+// Evaluate position, heading and curvature for spline at sorted s in one pass.
+// heading_list and k_list may be nullptr. If derivatives is nullptr, local buffers are used.
+void evaluateSplines(const tk::spline &xs,
+                     const tk::spline &ys,
+                     const std::vector<double> &s_list,
+                     std::vector<double> *x_list,
+                     std::vector<double> *y_list,
+                     std::vector<double> *heading_list,
+                     std::vector<double> *k_list,
+                     SplineDerivatives *derivatives = nullptr);
+
 // Calculate distance between two points.
 double distance(const State &p1, const State &p2);
 
@@ -60,13 +77,6 @@ double distance(const State &p1, const State &p2);
 State local2Global(const State &reference, const State &target);
 State global2Local(const State &reference, const State &target);
 
-State findClosestPoint(const tk::spline &xs,
-                       const tk::spline &ys,
-                       double x,
-                       double y,
-                       double max_s,
-                       double start_s = 0);
-
 }
 
 #endif //PATH_OPTIMIZER_INCLUDE_TOOLS_TOOLS_HPP_
@@ -48,20 +48,63 @@ DEFINE_double(max_curvature_rate, 0.1, "max derivative of curvature");
 DEFINE_string(smoothing_method, "TENSION2", "rReference smoothing method");
 bool ValidateSmoothingnMethod(const char *flagname, const std::string &value)
 {
-    return value == "ANGLE_DIFF" || value == "TENSION" || value == "TENSION2";
+    return value == "ANGLE_DIFF" || value == "TENSION" || value == "TENSION2" || value == "RACE";
 }
 bool isSmoothingMethodValid = google::RegisterFlagValidator(&FLAGS_smoothing_method, ValidateSmoothingnMethod);
 
 DEFINE_string(tension_solver, "OSQP", "solver used in tension smoothing method");
 
+DEFINE_string(angle_diff_solver, "IPOPT", "solver used in angle diff smoothing method, IPOPT or OSQP");
+
+DEFINE_int32(angle_diff_sqp_max_iter, 10, "max SQP iterations of the angle diff smoother with OSQP");
+
+DEFINE_string(race_smoothing_methods, "TENSION2,ANGLE_DIFF,TENSION",
+              "smoothers run concurrently in RACE smoothing method, comma separated. IPOPT isn't thread safe, "
+              "so the ones solving with it (ANGLE_DIFF with angle_diff_solver IPOPT, TENSION and TENSION2 with "
+              "tension_solver IPOPT) take turns, list at most one of them");
+
+DEFINE_double(race_deadline_ms, 200, "deadline of RACE smoothing method");
+
+DEFINE_string(race_policy, "FIRST", "result picked in RACE smoothing method, FIRST or BEST (least integral of k^2)");
+bool ValidateRacePolicy(const char *flagname, const std::string &value)
+{
+    return value == "FIRST" || value == "BEST";
+}
+bool isRacePolicyValid = google::RegisterFlagValidator(&FLAGS_race_policy, ValidateRacePolicy);
+
+DEFINE_int32(race_thread_num, 3, "worker threads of RACE smoothing method");
+
+DEFINE_bool(enable_incremental_smoothing, false, "keep the smoothed prefix and only re-smooth the changed tail when the input is extended");
+
+DEFINE_double(incremental_smoothing_overlap, 20.0, "length of the kept smoothed path re-smoothed before the changed part");
+
+DEFINE_double(incremental_smoothing_max_start_offset, 0.5, "max distance from the start point to the kept smoothed path for it to be reused");
+
 DEFINE_bool(enable_searching, true, "search before optimization");
 
+DEFINE_string(search_method, "DP", "graph search run on the smoothed reference, DP or A_STAR");
+bool ValidateSearchMethod(const char *flagname, const std::string &value)
+{
+    return value == "DP" || value == "A_STAR";
+}
+bool isSearchMethodValid = google::RegisterFlagValidator(&FLAGS_search_method, ValidateSearchMethod);
+
 DEFINE_double(search_lateral_range, 10.0, "max offset when searching");
 
 DEFINE_double(search_longitudial_spacing, 1.5, "longitudinal spacing when searching");
 
 DEFINE_double(search_lateral_spacing, 0.6, "lateral spacing when searching");
 
+DEFINE_bool(enable_coarse_to_fine_search, false, "run the DP search on a coarse lattice first and then only near its path");
+
+DEFINE_double(search_coarse_longitudinal_spacing, 3.0, "longitudinal spacing of the coarse search");
+
+DEFINE_double(search_coarse_lateral_spacing, 1.8, "lateral spacing of the coarse search, should be a multiple of search_lateral_spacing");
+
+DEFINE_double(search_fine_band, 2.4, "half width of the lateral band around the coarse paths in the fine search");
+
+DEFINE_double(search_coarse_cost_margin, 0.3, "coarse paths costing at most this fraction more than the best one are searched finely");
+
 // TODO: change names!
 DEFINE_double(frenet_angle_diff_weight, 1500, "frenet smoothing angle difference weight");
 
@@ -113,6 +156,18 @@ DEFINE_double(KP_deviation_weight, 0, "deviation weight of solver KP and KPC");
 
 DEFINE_double(KP_slack_weight, 3, "punish distance to obstacles");
 
+DEFINE_double(candidate_lateral_weight, 1, "weight of the lateral offset preference of path candidates");
+
+DEFINE_int32(candidate_thread_num, 3, "worker threads solving path candidates");
+
+DEFINE_int32(result_cache_capacity, 0, "smoothed references and final paths kept for unchanged inputs, 0 disables the cache");
+
+DEFINE_double(result_cache_position_resolution, 0.01, "start and goal positions closer than this share cached results");
+
+DEFINE_double(result_cache_angle_resolution, 0.001, "start and goal headings closer than this share cached results");
+
+DEFINE_double(result_cache_curvature_resolution, 0.0001, "start curvatures closer than this share cached results");
+
 DEFINE_double(expected_safety_margin, 1.3, "soft constraint on the distance to obstacles");
 
 // TODO: make this work.
@@ -130,9 +185,29 @@ DEFINE_double(output_spacing, 0.3, "output interval");
 
 DEFINE_bool(enable_computation_time_output, true, "output details on screen");
 
+DEFINE_string(planning_stats_file, "", "append the stats of each solve to this file as JSON lines, disabled if empty");
+
 DEFINE_bool(enable_collision_check, true, "perform collision check before output");
 
+DEFINE_bool(enable_continuous_collision_check, false, "check the swept volume between output states as well, the output spacing is unchanged");
+
+DEFINE_int32(continuous_collision_check_max_depth, 16, "times the region swept by a motion is halved before it's reported as collision");
+
+DEFINE_double(continuous_collision_check_min_length, 0.05, "parts of the region swept by a motion shorter than this are reported as collision instead of halved");
+
 DEFINE_double(epsilon, 1e-6, "use this when comparing double");
 
 DEFINE_bool(enable_dynamic_segmentation, true, "dense segmentation when the curvature is large.");
-/////
\ No newline at end of file
+
+DEFINE_double(reference_line_resolution, 0.1, "s interval of the sampled smoothed reference line");
+
+DEFINE_double(clearance_raster_ds, 0.25, "s interval of the clearance raster, search_longitudial_spacing should be a multiple of it");
+
+DEFINE_double(clearance_raster_dl, 0.1, "l interval of the clearance raster, search_lateral_spacing should be a multiple of it");
+
+DEFINE_double(budget_smoothing_share, 0.6, "share of the time left that reference smoothing may take under a latency budget");
+
+DEFINE_double(budget_qp_share, 0.7, "share of the time left that the QP may take under a latency budget, the rest is kept for output");
+
+DEFINE_double(qp_early_stop_max_primal_residual, 0.01, "max constraint violation of the iterate a QP stopped at by the latency budget for it to be used");
+/////
@@ -0,0 +1,105 @@
+#include <cmath>
+#include <algorithm>
+#include <glog/logging.h>
+#include "path_optimizer/data_struct/lazy_trajectory.hpp"
+#include "path_optimizer/data_struct/trajectory.hpp"
+#include "path_optimizer/data_struct/data_struct.hpp"
+#include "path_optimizer/tools/collosion_checker.hpp"
+#include "path_optimizer/tools/tools.hpp"
+#include "path_optimizer/config/planning_flags.hpp"
+
+namespace PathOptimizationNS {
+
+namespace {
+double curvature(double dx, double dy, double ddx, double ddy) {
+    return (dx * ddy - dy * ddx) / pow(dx * dx + dy * dy, 1.5);
+}
+}
+
+void LazyTrajectory::fit(const Trajectory &states) {
+    CHECK_GT(states.size(), 2);
+    x_s_.set_points(states.getSList(), states.getXList());
+    y_s_.set_points(states.getSList(), states.getYList());
+    length_ = states.back().s();
+}
+
+void LazyTrajectory::clear() {
+    length_ = 0;
+}
+
+double LazyTrajectory::getX(double s) const {
+    return x_s_(s);
+}
+
+double LazyTrajectory::getY(double s) const {
+    return y_s_(s);
+}
+
+double LazyTrajectory::getHeading(double s) const {
+    double x, dx, y, dy;
+    x_s_.evaluate(s, &x, &dx, nullptr);
+    y_s_.evaluate(s, &y, &dy, nullptr);
+    return atan2(dy, dx);
+}
+
+double LazyTrajectory::getCurvature(double s) const {
+    double x, dx, ddx, y, dy, ddy;
+    x_s_.evaluate(s, &x, &dx, &ddx);
+    y_s_.evaluate(s, &y, &dy, &ddy);
+    return curvature(dx, dy, ddx, ddy);
+}
+
+State LazyTrajectory::getState(double s) const {
+    double x, dx, ddx, y, dy, ddy;
+    x_s_.evaluate(s, &x, &dx, &ddx);
+    y_s_.evaluate(s, &y, &dy, &ddy);
+    return State(x, y, atan2(dy, dx), curvature(dx, dy, ddx, ddy), s);
+}
+
+void LazyTrajectory::evaluate(const std::vector<double> &s_list, Trajectory *states) {
+    CHECK_NOTNULL(states);
+    states->clear();
+    if (s_list.empty()) return;
+    evaluateSplines(x_s_, y_s_, s_list, &x_list_, &y_list_, &heading_list_, &k_list_, &derivatives_);
+    states->reserve(s_list.size());
+    for (size_t i = 0; i != s_list.size(); ++i) {
+        states->emplace_back(x_list_[i], y_list_[i], heading_list_[i], k_list_[i], s_list[i]);
+    }
+}
+
+void LazyTrajectory::sample(double s_begin, double s_end, double spacing, Trajectory *states) {
+    CHECK_GT(spacing, 0);
+    s_list_.clear();
+    s_end = std::min(s_end, length_);
+    for (int i = 0; s_begin + i * spacing <= s_end; ++i) {
+        s_list_.emplace_back(s_begin + i * spacing);
+    }
+    evaluate(s_list_, states);
+}
+
+bool LazyTrajectory::checkCollision(CollisionChecker *checker,
+                                    double s_begin,
+                                    double s_end,
+                                    double spacing,
+                                    double *collision_s) {
+    CHECK_NOTNULL(checker);
+    sample(s_begin, s_end, spacing, &states_);
+    // End on s_end as well, so consecutive chunks leave no motion unchecked.
+    s_end = std::min(s_end, length_);
+    if (!states_.empty() && s_end - states_.back().s() > 1e-6) states_.emplace_back(getState(s_end));
+    State prev;
+    for (size_t i = 0; i != states_.size(); ++i) {
+        const State current = states_.getState(i);
+        const bool is_free = FLAGS_enable_continuous_collision_check && i != 0 ?
+                             checker->isMotionCollisionFree(prev, current) :
+                             checker->isSingleStateCollisionFreeImproved(current);
+        if (!is_free) {
+            if (collision_s) *collision_s = current.s;
+            return false;
+        }
+        prev = current;
+    }
+    return true;
+}
+
+}
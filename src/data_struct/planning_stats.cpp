@@ -0,0 +1,90 @@
+#include <fstream>
+#include <sstream>
+#include <mutex>
+#include <glog/logging.h>
+#include "path_optimizer/data_struct/planning_stats.hpp"
+
+namespace PathOptimizationNS {
+
+const char *PlanningStats::stageName(Stage stage) {
+    switch (stage) {
+        case kSmoothing: return "smoothing";
+        case kSearch: return "search";
+        case kPostSmoothing: return "post_smoothing";
+        case kSegmentation: return "segmentation";
+        case kBounds: return "bounds";
+        case kQpSetup: return "qp_setup";
+        case kQpSolve: return "qp_solve";
+        case kOutput: return "output";
+        case kCollisionCheck: return "collision_check";
+        case kCache: return "cache";
+        default: return "unknown";
+    }
+}
+
+const char *PlanningStats::cacheResultName(CacheResult result) {
+    switch (result) {
+        case kCacheDisabled: return "disabled";
+        case kCacheMiss: return "miss";
+        case kCacheReferenceHit: return "reference_hit";
+        case kCachePathHit: return "path_hit";
+        default: return "unknown";
+    }
+}
+
+std::string PlanningStats::toJson() const {
+    std::ostringstream out;
+    out << "{\"success\":" << (success ? "true" : "false")
+        << ",\"cancelled\":" << (cancelled ? "true" : "false")
+        << ",\"deadline_exceeded\":" << (deadline_exceeded ? "true" : "false")
+        << ",\"qp_early_stopped\":" << (qp_early_stopped ? "true" : "false")
+        << ",\"total_ms\":" << total_ms
+        << ",\"horizon\":" << horizon
+        << ",\"osqp_iterations\":" << osqp_iterations
+        << ",\"osqp_status\":\"";
+    // OSQP status strings are plain text, only quotes and backslashes need escaping.
+    for (const auto c : osqp_status) {
+        if (c == '"' || c == '\\') out << '\\';
+        out << c;
+    }
+    out << "\",\"cache_result\":\"" << cacheResultName(cache_result)
+        << "\",\"cache_lookups\":" << cache_lookups
+        << ",\"cache_reference_hits\":" << cache_reference_hits
+        << ",\"cache_path_hits\":" << cache_path_hits
+        << ",\"stage_ms\":{";
+    for (int i = 0; i != kStageNum; ++i) {
+        if (i != 0) out << ',';
+        out << '"' << stageName(static_cast<Stage>(i)) << "\":" << stage_ms[i];
+    }
+    out << '}';
+#ifdef PATH_OPTIMIZER_ENABLE_ALLOCATION_TRACKING
+    out << ",\"stage_allocations\":{";
+    for (int i = 0; i != kStageNum; ++i) {
+        if (i != 0) out << ',';
+        out << '"' << stageName(static_cast<Stage>(i)) << "\":" << stage_allocations[i];
+    }
+    out << "},\"stage_allocated_bytes\":{";
+    for (int i = 0; i != kStageNum; ++i) {
+        if (i != 0) out << ',';
+        out << '"' << stageName(static_cast<Stage>(i)) << "\":" << stage_allocated_bytes[i];
+    }
+    out << '}';
+#endif
+    out << '}';
+    return out.str();
+}
+
+bool PlanningStats::appendJsonLine(const std::string &file_name) const {
+    static std::mutex file_mutex;
+    const auto line = toJson();
+    std::lock_guard<std::mutex> lock(file_mutex);
+    std::ofstream file(file_name, std::ios::app);
+    if (!file) {
+        LOG(WARNING) << "Failed to open " << file_name << " for planning stats.";
+        return false;
+    }
+    file << line << '\n';
+    return static_cast<bool>(file);
+}
+
+}
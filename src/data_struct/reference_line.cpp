@@ -0,0 +1,130 @@
+#include <cmath>
+#include <algorithm>
+#include <glog/logging.h>
+#include "path_optimizer/data_struct/reference_line.hpp"
+#include "path_optimizer/data_struct/data_struct.hpp"
+#include "path_optimizer/tools/spline.h"
+#include "path_optimizer/tools/tools.hpp"
+
+namespace PathOptimizationNS {
+
+void ReferenceLine::build(const tk::spline &x_s, const tk::spline &y_s, double max_s, double resolution) {
+    CHECK_GT(resolution, 0);
+    clear();
+    if (max_s <= 0) return;
+    // Shrink the resolution slightly so that the last sample lies exactly on max_s.
+    const auto cell_num = static_cast<std::size_t>(std::ceil(max_s / resolution));
+    const std::size_t point_num = std::max<std::size_t>(cell_num, 1) + 1;
+    resolution_ = max_s / (point_num - 1);
+    max_s_ = max_s;
+    s_list_.resize(point_num);
+    for (std::size_t i = 0; i != point_num; ++i) {
+        s_list_[i] = i * resolution_;
+    }
+    // One pass over the knots for each spline.
+    x_s.evaluate(s_list_, &x_, &dx_, &ddx_);
+    y_s.evaluate(s_list_, &y_, &dy_, &ddy_);
+    heading_.resize(point_num);
+    k_.resize(point_num);
+    for (std::size_t i = 0; i != point_num; ++i) {
+        heading_[i] = atan2(dy_[i], dx_[i]);
+        k_[i] = (dx_[i] * ddy_[i] - dy_[i] * ddx_[i]) / pow(dx_[i] * dx_[i] + dy_[i] * dy_[i], 1.5);
+    }
+}
+
+void ReferenceLine::clear() {
+    resolution_ = 0;
+    max_s_ = 0;
+    x_.clear();
+    y_.clear();
+    dx_.clear();
+    dy_.clear();
+    heading_.clear();
+    k_.clear();
+}
+
+bool ReferenceLine::locate(double s, std::size_t *index, double *t) const {
+    CHECK(!empty()) << "Reference line is not built!";
+    if (s < 0 || x_.size() == 1) {
+        *index = 0;
+        *t = s;
+        return false;
+    }
+    if (s > max_s_) {
+        *index = x_.size() - 1;
+        *t = s - max_s_;
+        return false;
+    }
+    const double u = s / resolution_;
+    *index = std::min(static_cast<std::size_t>(u), x_.size() - 2);
+    *t = u - *index;
+    return true;
+}
+
+double ReferenceLine::getX(double s) const {
+    std::size_t i;
+    double t;
+    if (!locate(s, &i, &t)) return x_[i] + t * dx_[i];
+    const double t2 = t * t, t3 = t2 * t;
+    return (2 * t3 - 3 * t2 + 1) * x_[i] + (t3 - 2 * t2 + t) * resolution_ * dx_[i]
+        + (-2 * t3 + 3 * t2) * x_[i + 1] + (t3 - t2) * resolution_ * dx_[i + 1];
+}
+
+double ReferenceLine::getY(double s) const {
+    std::size_t i;
+    double t;
+    if (!locate(s, &i, &t)) return y_[i] + t * dy_[i];
+    const double t2 = t * t, t3 = t2 * t;
+    return (2 * t3 - 3 * t2 + 1) * y_[i] + (t3 - 2 * t2 + t) * resolution_ * dy_[i]
+        + (-2 * t3 + 3 * t2) * y_[i + 1] + (t3 - t2) * resolution_ * dy_[i + 1];
+}
+
+double ReferenceLine::getHeading(double s) const {
+    std::size_t i;
+    double t;
+    if (!locate(s, &i, &t)) return heading_[i];
+    return constraintAngle(heading_[i] + t * constraintAngle(heading_[i + 1] - heading_[i]));
+}
+
+double ReferenceLine::getCurvature(double s) const {
+    std::size_t i;
+    double t;
+    if (!locate(s, &i, &t)) return k_[i];
+    return k_[i] + t * (k_[i + 1] - k_[i]);
+}
+
+State ReferenceLine::getState(double s) const {
+    return State{getX(s), getY(s), getHeading(s), getCurvature(s), s};
+}
+
+void ReferenceLine::getNormal(double s, double *nx, double *ny) const {
+    double dx, dy, ddx, ddy;
+    getDerivatives(s, &dx, &dy, &ddx, &ddy);
+    const double norm = std::max(sqrt(dx * dx + dy * dy), 1e-9);
+    *nx = -dy / norm;
+    *ny = dx / norm;
+}
+
+void ReferenceLine::getDerivatives(double s, double *dx, double *dy, double *ddx, double *ddy) const {
+    std::size_t i;
+    double t;
+    if (!locate(s, &i, &t)) {
+        *dx = dx_[i];
+        *dy = dy_[i];
+    } else {
+        // Derivatives of the Hermite basis, divided by the cell length.
+        const double t2 = t * t;
+        const double h00 = (6 * t2 - 6 * t) / resolution_;
+        const double h10 = 3 * t2 - 4 * t + 1;
+        const double h01 = -h00;
+        const double h11 = 3 * t2 - 2 * t;
+        *dx = h00 * x_[i] + h10 * dx_[i] + h01 * x_[i + 1] + h11 * dx_[i + 1];
+        *dy = h00 * y_[i] + h10 * dy_[i] + h01 * y_[i + 1] + h11 * dy_[i + 1];
+    }
+    // The path is (nearly) parameterized by arc length, so the second derivative is k times the normal.
+    const double k = getCurvature(s);
+    *ddx = -k * *dy;
+    *ddy = k * *dx;
+}
+
+}
@@ -22,6 +22,14 @@ const tk::spline &ReferencePath::getYS() const {
     return reference_path_impl_->getYS();
 }
 
+std::shared_ptr<const tk::spline> ReferencePath::getSharedXS() const {
+    return reference_path_impl_->getSharedXS();
+}
+
+std::shared_ptr<const tk::spline> ReferencePath::getSharedYS() const {
+    return reference_path_impl_->getSharedYS();
+}
+
 double ReferencePath::getXS(double s) const {
     return reference_path_impl_->getXS()(s);
 }
@@ -30,6 +38,18 @@ double ReferencePath::getYS(double s) const {
     return reference_path_impl_->getYS()(s);
 }
 
+const ReferenceLine &ReferencePath::getReferenceLine() const {
+    return reference_path_impl_->getReferenceLine();
+}
+
+const ClearanceRaster &ReferencePath::getClearanceRaster(const Map &map, double s_begin, double s_end, double max_l) {
+    return reference_path_impl_->getClearanceRaster(map, s_begin, s_end, max_l);
+}
+
+const ProjectionIndex &ReferencePath::getProjectionIndex() const {
+    return reference_path_impl_->getProjectionIndex();
+}
+
 void ReferencePath::clear() {
     reference_path_impl_->clear();
 }
@@ -46,7 +66,7 @@ void ReferencePath::setLength(double s) {
     reference_path_impl_->setLength(s);
 }
 
-const std::vector<State> &ReferencePath::getReferenceStates() const {
+const Trajectory &ReferencePath::getReferenceStates() const {
     return reference_path_impl_->getReferenceStates();
 }
 
@@ -74,8 +94,8 @@ void ReferencePath::setReference(const std::vector<PathOptimizationNS::State> &&
     reference_path_impl_->setReference(reference);
 }
 
-void ReferencePath::updateBounds(const Map &map) {
-    reference_path_impl_->updateBoundsImproved(map);
+void ReferencePath::updateBounds(const Map &map, const CancellationToken *cancellation_token) {
+    reference_path_impl_->updateBoundsImproved(map, cancellation_token);
 }
 
 void ReferencePath::updateLimits() {
@@ -92,6 +112,16 @@ void ReferencePath::setSpline(const PathOptimizationNS::tk::spline &x_s,
     reference_path_impl_->setSpline(x_s, y_s, max_s);
 }
 
+void ReferencePath::setSpline(tk::spline &&x_s, tk::spline &&y_s, double max_s) {
+    reference_path_impl_->setSpline(std::move(x_s), std::move(y_s), max_s);
+}
+
+void ReferencePath::setSpline(std::shared_ptr<const tk::spline> x_s,
+                              std::shared_ptr<const tk::spline> y_s,
+                              double max_s) {
+    reference_path_impl_->setSpline(std::move(x_s), std::move(y_s), max_s);
+}
+
 void ReferencePath::setOriginalSpline(const PathOptimizationNS::tk::spline &x_s,
                                       const PathOptimizationNS::tk::spline &y_s,
                                       double max_s) {
@@ -2,29 +2,42 @@
 // Created by ljn on 20-3-23.
 //
 #include <cfloat>
+#include <algorithm>
 #include <glog/logging.h>
 #include "path_optimizer/data_struct/reference_path_impl.hpp"
 #include <path_optimizer/tools/Map.hpp>
 #include "path_optimizer/tools/tools.hpp"
 #include "path_optimizer/tools/spline.h"
+#include "path_optimizer/tools/cancellation_token.hpp"
 #include "path_optimizer/data_struct/data_struct.hpp"
 #include "path_optimizer/config/planning_flags.hpp"
 
 namespace PathOptimizationNS {
 
-ReferencePathImpl::ReferencePathImpl() :
-    x_s_(new tk::spline),
-    y_s_(new tk::spline),
-    original_x_s_(new tk::spline),
-    original_y_s_(new tk::spline) {}
-
-ReferencePathImpl::~ReferencePathImpl() {
-    delete x_s_;
-    delete y_s_;
-    delete original_x_s_;
-    delete original_y_s_;
+namespace {
+// Obstacle distance at an offset to the left of a state, sampled from the map directly.
+class CartesianDistance {
+ public:
+    CartesianDistance(const Map &map, const State &state) :
+        map_(map), x_(state.x), y_(state.y), nx_(cos(state.z + M_PI_2)), ny_(sin(state.z + M_PI_2)) {}
+    double operator()(double offset) const {
+        return map_.getObstacleDistance(grid_map::Position(x_ + offset * nx_, y_ + offset * ny_));
+    }
+
+ private:
+    const Map &map_;
+    const double x_, y_, nx_, ny_;
+};
 }
 
+ReferencePathImpl::ReferencePathImpl() :
+    x_s_(std::make_shared<tk::spline>()),
+    y_s_(std::make_shared<tk::spline>()),
+    original_x_s_(x_s_),
+    original_y_s_(y_s_) {}
+
+ReferencePathImpl::~ReferencePathImpl() = default;
+
 const tk::spline &ReferencePathImpl::getXS() const {
     return *x_s_;
 }
@@ -33,21 +46,58 @@ const tk::spline &ReferencePathImpl::getYS() const {
     return *y_s_;
 }
 
+const ReferenceLine &ReferencePathImpl::getReferenceLine() const {
+    return reference_line_;
+}
+
+const ClearanceRaster &ReferencePathImpl::getClearanceRaster(const Map &map,
+                                                             double s_begin,
+                                                             double s_end,
+                                                             double max_l) {
+    if (!clearance_raster_.matches(map, s_begin, s_end, max_l, FLAGS_clearance_raster_ds, FLAGS_clearance_raster_dl)) {
+        clearance_raster_.build(reference_line_, map, s_begin, s_end, max_l,
+                                FLAGS_clearance_raster_ds, FLAGS_clearance_raster_dl);
+    }
+    return clearance_raster_;
+}
+
+const ProjectionIndex &ReferencePathImpl::getProjectionIndex() const {
+    return projection_index_;
+}
+
 void ReferencePathImpl::setSpline(const tk::spline &x_s,
                                   const tk::spline &y_s,
                                   double max_s) {
-    *x_s_ = x_s;
-    *y_s_ = y_s;
+    setSpline(std::make_shared<const tk::spline>(x_s), std::make_shared<const tk::spline>(y_s), max_s);
+}
+
+void ReferencePathImpl::setSpline(tk::spline &&x_s, tk::spline &&y_s, double max_s) {
+    setSpline(std::make_shared<const tk::spline>(std::move(x_s)),
+              std::make_shared<const tk::spline>(std::move(y_s)),
+              max_s);
+}
+
+void ReferencePathImpl::setSpline(std::shared_ptr<const tk::spline> x_s,
+                                  std::shared_ptr<const tk::spline> y_s,
+                                  double max_s) {
+    CHECK(x_s && y_s);
+    x_s_ = std::move(x_s);
+    y_s_ = std::move(y_s);
     max_s_ = max_s;
+    reference_line_.build(*x_s_, *y_s_, max_s_, FLAGS_reference_line_resolution);
+    clearance_raster_.clear();
+    projection_index_.build(reference_line_);
     use_spline_ = true;
 }
 
 void ReferencePathImpl::setOriginalSpline(const PathOptimizationNS::tk::spline &x_s,
                                           const PathOptimizationNS::tk::spline &y_s,
                                           double max_s) {
-    *original_x_s_ = x_s;
-    *original_y_s_ = y_s;
+    original_x_s_ = std::make_shared<const tk::spline>(x_s);
+    original_y_s_ = std::make_shared<const tk::spline>(y_s);
     original_max_s_ = max_s;
+    original_line_.clear();
+    original_projection_index_.clear();
     is_original_spline_set = true;
 }
 
@@ -61,22 +111,26 @@ const tk::spline &ReferencePathImpl::getOriginalYS() const {
 
 void ReferencePathImpl::setReference(const std::vector<State> &reference) {
     DLOG(INFO) << "left reference version";
-    reference_states_ = reference;
+    reference_states_.assign(reference);
     use_spline_ = false;
 }
 
 void ReferencePathImpl::setReference(const std::vector<PathOptimizationNS::State> &&reference) {
     DLOG(INFO) << "right reference version";
-    reference_states_ = reference;
+    reference_states_.assign(reference);
     use_spline_ = false;
 }
 
 void ReferencePathImpl::clear() {
     max_s_ = 0;
+    reference_line_.clear();
+    clearance_raster_.clear();
+    projection_index_.clear();
     reference_states_.clear();
     bounds_.clear();
     max_k_list_.clear();
     max_kp_list_.clear();
+    display_set_.clear();
 }
 
 std::size_t ReferencePathImpl::getSize() const {
@@ -86,7 +140,7 @@ std::size_t ReferencePathImpl::getSize() const {
 bool ReferencePathImpl::trimStates() {
     if (bounds_.empty() || reference_states_.empty() || bounds_.size() >= reference_states_.size())
         return false;
-    reference_states_.resize(bounds_.size());
+    reference_states_.truncate(bounds_.size());
     return true;
 }
 
@@ -98,7 +152,7 @@ void ReferencePathImpl::setLength(double s) {
     max_s_ = s;
 }
 
-const std::vector<State> &ReferencePathImpl::getReferenceStates() const {
+const Trajectory &ReferencePathImpl::getReferenceStates() const {
     return reference_states_;
 }
 
@@ -120,8 +174,8 @@ std::vector<std::tuple<State, double, double>> ReferencePathImpl::display_abnorm
 
 State ReferencePathImpl::getApproxState(const State &original_state, const State &actual_state, double len) const {
     // Point on refrence.
-    double x = (*x_s_)(original_state.s + len);
-    double y = (*y_s_)(original_state.s + len);
+    double x = reference_line_.getX(original_state.s + len);
+    double y = reference_line_.getY(original_state.s + len);
     //
     State v1, v2;
     v1.x = actual_state.x - original_state.x;
@@ -139,13 +193,21 @@ State ReferencePathImpl::getApproxState(const State &original_state, const State
     return ret;
 }
 
-void ReferencePathImpl::updateBoundsImproved(const PathOptimizationNS::Map &map) {
+void ReferencePathImpl::updateBoundsImproved(const PathOptimizationNS::Map &map,
+                                             const CancellationToken *cancellation_token) {
     if (reference_states_.empty()) {
         LOG(WARNING) << "Empty reference, updateBounds fail!";
         return;
     }
+    // Reference states given directly have no reference line to approximate the circles on.
+    if (reference_line_.empty()) {
+        updateBounds(map, cancellation_token);
+        return;
+    }
     bounds_.clear();
-    for (const auto &state : reference_states_) {
+    for (std::size_t index = 0; index != reference_states_.size(); ++index) {
+        if (cancellation_token && cancellation_token->isCancelled()) break;
+        const State state = reference_states_.getState(index);
         // Circle centers.
         State
             c0(state.x + FLAGS_d1 * cos(state.z),
@@ -165,19 +227,19 @@ void ReferencePathImpl::updateBoundsImproved(const PathOptimizationNS::Map &map)
         auto c22 = getApproxState(state, c2, FLAGS_d3);
         auto c33 = getApproxState(state, c3, FLAGS_d4);
         // Calculate boundaries.
-        auto clearance_0 = getClearanceWithDirectionStrict(c00, map);
+        auto clearance_0 = getClearanceWithDirectionStrict(c00, CartesianDistance(map, c00));
         auto offset_0 = global2Local(c0, c00).y;
         clearance_0[0] += offset_0; clearance_0[1] += offset_0;
 
-        auto clearance_1 = getClearanceWithDirectionStrict(c11, map);
+        auto clearance_1 = getClearanceWithDirectionStrict(c11, CartesianDistance(map, c11));
         auto offset_1 = global2Local(c1, c11).y;
         clearance_1[0] += offset_1; clearance_1[1] += offset_1;
 
-        auto clearance_2 = getClearanceWithDirectionStrict(c22, map);
+        auto clearance_2 = getClearanceWithDirectionStrict(c22, CartesianDistance(map, c22));
         auto offset_2 = global2Local(c2, c22).y;
         clearance_2[0] += offset_2; clearance_2[1] += offset_2;
 
-        auto clearance_3 = getClearanceWithDirectionStrict(c33, map);
+        auto clearance_3 = getClearanceWithDirectionStrict(c33, CartesianDistance(map, c33));
         auto offset_3 = global2Local(c3, c33).y;
         clearance_3[0] += offset_3; clearance_3[1] += offset_3;
 
@@ -196,7 +258,7 @@ void ReferencePathImpl::updateBoundsImproved(const PathOptimizationNS::Map &map)
         bounds_.emplace_back(covering_circle_bounds);
     }
     if (reference_states_.size() != bounds_.size()) {
-        reference_states_.resize(bounds_.size());
+        reference_states_.truncate(bounds_.size());
     }
 }
 
@@ -222,8 +284,8 @@ void ReferencePathImpl::updateLimits() {
     }
     for (size_t i = 0; i != reference_states_.size(); ++i) {
         // Friction circle limit.
-        double ref_v = reference_states_.at(i).v;
-        double ref_ax = reference_states_.at(i).a;
+        double ref_v = reference_states_.v(i);
+        double ref_ax = reference_states_.a(i);
         double ay_allowed = sqrt(pow(FLAGS_mu * 9.8, 2) - pow(ref_ax, 2));
         if (ref_v > 0.0001) max_k_list_.emplace_back(ay_allowed / pow(ref_v, 2));
         else max_k_list_.emplace_back(DBL_MAX);
@@ -234,13 +296,15 @@ void ReferencePathImpl::updateLimits() {
     LOG(INFO) << "K and KP constraints are updated according to v and a.";
 }
 
-void ReferencePathImpl::updateBounds(const Map &map) {
+void ReferencePathImpl::updateBounds(const Map &map, const CancellationToken *cancellation_token) {
     if (reference_states_.empty()) {
         LOG(WARNING) << "Empty reference, updateBounds fail!";
         return;
     }
     bounds_.clear();
-    for (const auto &state : reference_states_) {
+    for (std::size_t index = 0; index != reference_states_.size(); ++index) {
+        if (cancellation_token && cancellation_token->isCancelled()) break;
+        const State state = reference_states_.getState(index);
         // Circle centers.
         State
             c0(state.x + FLAGS_d1 * cos(state.z),
@@ -256,10 +320,10 @@ void ReferencePathImpl::updateBounds(const Map &map) {
                state.y + FLAGS_d4 * sin(state.z),
                state.z);
         // Calculate boundaries.
-        auto clearance_0 = getClearanceWithDirectionStrict(c0, map);
-        auto clearance_1 = getClearanceWithDirectionStrict(c1, map);
-        auto clearance_2 = getClearanceWithDirectionStrict(c2, map);
-        auto clearance_3 = getClearanceWithDirectionStrict(c3, map);
+        auto clearance_0 = getClearanceWithDirectionStrict(c0, CartesianDistance(map, c0));
+        auto clearance_1 = getClearanceWithDirectionStrict(c1, CartesianDistance(map, c1));
+        auto clearance_2 = getClearanceWithDirectionStrict(c2, CartesianDistance(map, c2));
+        auto clearance_3 = getClearanceWithDirectionStrict(c3, CartesianDistance(map, c3));
         if (clearance_0[0] == clearance_0[1] ||
             clearance_1[0] == clearance_1[1] ||
             clearance_2[0] == clearance_2[1] ||
@@ -275,33 +339,28 @@ void ReferencePathImpl::updateBounds(const Map &map) {
         bounds_.emplace_back(covering_circle_bounds);
     }
     if (reference_states_.size() != bounds_.size()) {
-        reference_states_.resize(bounds_.size());
+        reference_states_.truncate(bounds_.size());
     }
     LOG(INFO) << "Boundary updated.";
 }
 
-std::vector<double> ReferencePathImpl::getClearanceWithDirectionStrict(const PathOptimizationNS::State &state,
-                                                                       const PathOptimizationNS::Map &map) {
+template<typename DistanceAt>
+std::array<double, 2> ReferencePathImpl::getClearanceWithDirectionStrict(const PathOptimizationNS::State &state,
+                                                                         const DistanceAt &distance_at) {
     // TODO: too much repeated code!
     double left_bound = 0;
     double right_bound = 0;
     double delta_s = 0.5;
-    double left_angle = constraintAngle(state.z + M_PI_2);
-    double right_angle = constraintAngle(state.z - M_PI_2);
 
     auto n = static_cast<size_t >(5.0 / delta_s);
     // Check if the original position is collision free.
-    grid_map::Position original_position(state.x, state.y);
-    auto original_clearance = map.getObstacleDistance(original_position);
+    auto original_clearance = distance_at(0);
     if (original_clearance > FLAGS_circle_radius) {
         // Normal case:
         double right_s = 0;
         for (size_t j = 0; j != n; ++j) {
             right_s += delta_s;
-            double x = state.x + right_s * cos(right_angle);
-            double y = state.y + right_s * sin(right_angle);
-            grid_map::Position new_position(x, y);
-            double clearance = map.getObstacleDistance(new_position);
+            double clearance = distance_at(-right_s);
             if (clearance < FLAGS_circle_radius) {
                 break;
             }
@@ -309,10 +368,7 @@ std::vector<double> ReferencePathImpl::getClearanceWithDirectionStrict(const Pat
         double left_s = 0;
         for (size_t j = 0; j != n; ++j) {
             left_s += delta_s;
-            double x = state.x + left_s * cos(left_angle);
-            double y = state.y + left_s * sin(left_angle);
-            grid_map::Position new_position(x, y);
-            double clearance = map.getObstacleDistance(new_position);
+            double clearance = distance_at(left_s);
             if (clearance < FLAGS_circle_radius) {
                 break;
             }
@@ -322,11 +378,11 @@ std::vector<double> ReferencePathImpl::getClearanceWithDirectionStrict(const Pat
     } else if (is_original_spline_set && use_spline_ && !FLAGS_enable_simple_boundary_decision) {
         DLOG(INFO) << "Using relative position to determine the direction to expand.";
         // Use position to determine the direction.
-        auto closest_point{findClosestPoint(*original_x_s_,
-                                            *original_y_s_,
-                                            state.x,
-                                            state.y,
-                                            original_max_s_)};
+        if (original_projection_index_.empty()) {
+            original_line_.build(*original_x_s_, *original_y_s_, original_max_s_, FLAGS_reference_line_resolution);
+            original_projection_index_.build(original_line_);
+        }
+        auto closest_point{original_projection_index_.getProjection(state.x, state.y)};
         auto local_view{global2Local(state, closest_point)};
         DLOG(INFO) << "closest point: " << closest_point.x << ", " << closest_point.y << "\n"
                    << "state: " << state.x << ", " << state.y;
@@ -336,10 +392,7 @@ std::vector<double> ReferencePathImpl::getClearanceWithDirectionStrict(const Pat
             double right_s = 0;
             for (int j = 0; j != n; ++j) {
                 right_s += delta_s;
-                double x = state.x + right_s * cos(right_angle);
-                double y = state.y + right_s * sin(right_angle);
-                grid_map::Position new_position(x, y);
-                double clearance = map.getObstacleDistance(new_position);
+                double clearance = distance_at(-right_s);
                 if (clearance > FLAGS_circle_radius) {
                     break;
                 }
@@ -347,10 +400,7 @@ std::vector<double> ReferencePathImpl::getClearanceWithDirectionStrict(const Pat
             left_bound = -right_s;
             for (int j = 0; j != n; ++j) {
                 right_s += delta_s;
-                double x = state.x + right_s * cos(right_angle);
-                double y = state.y + right_s * sin(right_angle);
-                grid_map::Position new_position(x, y);
-                double clearance = map.getObstacleDistance(new_position);
+                double clearance = distance_at(-right_s);
                 if (clearance < FLAGS_circle_radius) {
                     break;
                 }
@@ -362,10 +412,7 @@ std::vector<double> ReferencePathImpl::getClearanceWithDirectionStrict(const Pat
             double left_s = 0;
             for (int j = 0; j != n; ++j) {
                 left_s += delta_s;
-                double x = state.x + left_s * cos(left_angle);
-                double y = state.y + left_s * sin(left_angle);
-                grid_map::Position new_position(x, y);
-                double clearance = map.getObstacleDistance(new_position);
+                double clearance = distance_at(left_s);
                 if (clearance > FLAGS_circle_radius) {
                     break;
                 }
@@ -373,10 +420,7 @@ std::vector<double> ReferencePathImpl::getClearanceWithDirectionStrict(const Pat
             right_bound = left_s;
             for (int j = 0; j != n; ++j) {
                 left_s += delta_s;
-                double x = state.x + left_s * cos(left_angle);
-                double y = state.y + left_s * sin(left_angle);
-                grid_map::Position new_position(x, y);
-                double clearance = map.getObstacleDistance(new_position);
+                double clearance = distance_at(left_s);
                 if (clearance < FLAGS_circle_radius) {
                     break;
                 }
@@ -390,10 +434,7 @@ std::vector<double> ReferencePathImpl::getClearanceWithDirectionStrict(const Pat
         double right_s = 0;
         for (size_t j = 0; j != n; ++j) {
             right_s += delta_s;
-            double x = state.x + right_s * cos(right_angle);
-            double y = state.y + right_s * sin(right_angle);
-            grid_map::Position new_position(x, y);
-            double clearance = map.getObstacleDistance(new_position);
+            double clearance = distance_at(-right_s);
             if (clearance > FLAGS_circle_radius) {
                 break;
             }
@@ -401,10 +442,7 @@ std::vector<double> ReferencePathImpl::getClearanceWithDirectionStrict(const Pat
         double left_s = 0;
         for (size_t j = 0; j != n; ++j) {
             left_s += delta_s;
-            double x = state.x + left_s * cos(left_angle);
-            double y = state.y + left_s * sin(left_angle);
-            grid_map::Position new_position(x, y);
-            double clearance = map.getObstacleDistance(new_position);
+            double clearance = distance_at(left_s);
             if (clearance > FLAGS_circle_radius) {
                 break;
             }
@@ -415,10 +453,7 @@ std::vector<double> ReferencePathImpl::getClearanceWithDirectionStrict(const Pat
             right_bound = left_s;
             for (size_t j = 0; j != n; ++j) {
                 left_s += delta_s;
-                double x = state.x + left_s * cos(left_angle);
-                double y = state.y + left_s * sin(left_angle);
-                grid_map::Position new_position(x, y);
-                double clearance = map.getObstacleDistance(new_position);
+                double clearance = distance_at(left_s);
                 if (clearance < FLAGS_circle_radius) {
                     break;
                 }
@@ -429,10 +464,7 @@ std::vector<double> ReferencePathImpl::getClearanceWithDirectionStrict(const Pat
             left_bound = -right_s;
             for (size_t j = 0; j != n; ++j) {
                 right_s += delta_s;
-                double x = state.x + right_s * cos(right_angle);
-                double y = state.y + right_s * sin(right_angle);
-                grid_map::Position new_position(x, y);
-                double clearance = map.getObstacleDistance(new_position);
+                double clearance = distance_at(-right_s);
                 if (clearance < FLAGS_circle_radius) {
                     break;
                 }
@@ -444,22 +476,14 @@ std::vector<double> ReferencePathImpl::getClearanceWithDirectionStrict(const Pat
     double smaller_ds = 0.1;
     for (int i = 1; i != static_cast<int>(delta_s / smaller_ds); ++i) {
         left_bound += smaller_ds;
-        grid_map::Position position(
-            state.x + left_bound * cos(left_angle),
-            state.y + left_bound * sin(left_angle)
-        );
-        if (map.getObstacleDistance(position) < FLAGS_circle_radius) {
+        if (distance_at(left_bound) < FLAGS_circle_radius) {
             left_bound -= smaller_ds;
             break;
         }
     }
     for (int i = 1; i != static_cast<int>(delta_s / smaller_ds); ++i) {
         right_bound -= smaller_ds;
-        grid_map::Position position(
-            state.x + right_bound * cos(right_angle),
-            state.y + right_bound * sin(right_angle)
-        );
-        if (map.getObstacleDistance(position) < FLAGS_circle_radius) {
+        if (distance_at(right_bound) < FLAGS_circle_radius) {
             right_bound += smaller_ds;
             break;
         }
@@ -482,11 +506,8 @@ bool ReferencePathImpl::buildReferenceFromSpline(double delta_s_smaller, double
     const double small_k = 0.08;
     double tmp_s = 0;
     while (tmp_s <= max_s_) {
-        double x = (*x_s_)(tmp_s);
-        double y = (*y_s_)(tmp_s);
-        double h = getHeading(*x_s_, *y_s_, tmp_s);
-        double k = getCurvature(*x_s_, *y_s_, tmp_s);
-        reference_states_.emplace_back(x, y, h, k, tmp_s);
+        reference_states_.emplace_back(reference_line_.getState(tmp_s));
+        const double k = reference_states_.back().k();
         // Use k to decide delta s.
         if (FLAGS_enable_dynamic_segmentation) {
             double k_share = fabs(k) > large_k ? 1 :
@@ -0,0 +1,82 @@
+#include "path_optimizer/data_struct/trajectory.hpp"
+
+namespace PathOptimizationNS {
+
+Trajectory::Trajectory(const std::vector<State> &states) {
+    assign(states);
+}
+
+void Trajectory::assign(const std::vector<State> &states) {
+    clear();
+    reserve(states.size());
+    for (const auto &state : states) emplace_back(state);
+}
+
+void Trajectory::appendTo(std::vector<State> *states) const {
+    states->reserve(states->size() + size());
+    for (std::size_t i = 0; i != size(); ++i) states->emplace_back(getState(i));
+}
+
+void Trajectory::clear() {
+    x_.clear();
+    y_.clear();
+    heading_.clear();
+    k_.clear();
+    s_.clear();
+    v_.clear();
+    a_.clear();
+    has_speed_ = false;
+}
+
+void Trajectory::reserve(std::size_t size) {
+    x_.reserve(size);
+    y_.reserve(size);
+    heading_.reserve(size);
+    k_.reserve(size);
+    s_.reserve(size);
+}
+
+void Trajectory::truncate(std::size_t size) {
+    if (size >= this->size()) return;
+    x_.resize(size);
+    y_.resize(size);
+    heading_.resize(size);
+    k_.resize(size);
+    s_.resize(size);
+    if (has_speed_) {
+        v_.resize(size);
+        a_.resize(size);
+    }
+}
+
+void Trajectory::emplace_back(double x, double y, double heading, double k, double s) {
+    x_.emplace_back(x);
+    y_.emplace_back(y);
+    heading_.emplace_back(heading);
+    k_.emplace_back(k);
+    s_.emplace_back(s);
+    if (has_speed_) {
+        v_.emplace_back(0);
+        a_.emplace_back(0);
+    }
+}
+
+void Trajectory::emplace_back(const State &state) {
+    if (!has_speed_ && (state.v != 0 || state.a != 0)) {
+        // Fill the columns of the states so far.
+        has_speed_ = true;
+        v_.assign(size(), 0);
+        a_.assign(size(), 0);
+    }
+    emplace_back(state.x, state.y, state.z, state.k, state.s);
+    if (has_speed_) {
+        v_.back() = state.v;
+        a_.back() = state.a;
+    }
+}
+
+State Trajectory::getState(std::size_t i) const {
+    return State(x_[i], y_[i], heading_[i], k_[i], s_[i], v(i), a(i));
+}
+
+}
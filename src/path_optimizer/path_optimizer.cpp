@@ -3,20 +3,32 @@
 //
 #include <iostream>
 #include <cmath>
-#include <ctime>
+#include <chrono>
+#include <future>
+#include <algorithm>
 #include "path_optimizer/path_optimizer.hpp"
 #include "path_optimizer/reference_path_smoother/reference_path_smoother.hpp"
 #include "path_optimizer/tools/tools.hpp"
 #include "path_optimizer/data_struct/reference_path.hpp"
+#include "path_optimizer/data_struct/reference_line.hpp"
 #include "path_optimizer/data_struct/data_struct.hpp"
 #include "path_optimizer/data_struct/vehicle_state_frenet.hpp"
+#include "path_optimizer/data_struct/planning_stats.hpp"
+#include "path_optimizer/data_struct/planning_workspace.hpp"
+#include "path_optimizer/data_struct/lazy_trajectory.hpp"
 #include "path_optimizer/tools/collosion_checker.hpp"
 #include "path_optimizer/tools/Map.hpp"
 #include "path_optimizer/tools/spline.h"
+#include "path_optimizer/tools/instrumentation.hpp"
+#include "path_optimizer/tools/thread_pool.hpp"
+#include "path_optimizer/tools/result_cache.hpp"
+#include "path_optimizer/tools/cancellation_token.hpp"
 #include "path_optimizer/solver/solver.hpp"
 #include "tinyspline_ros/tinysplinecpp.h"
 #include "path_optimizer/reference_path_smoother/angle_diff_smoother.hpp"
 #include "path_optimizer/reference_path_smoother/tension_smoother.hpp"
+#include "path_optimizer/reference_path_smoother/smoother_race.hpp"
+#include "path_optimizer/reference_path_smoother/incremental_smoother.hpp"
 
 namespace PathOptimizationNS {
 
@@ -26,7 +38,13 @@ PathOptimizer::PathOptimizer(const State &start_state,
     grid_map_(new Map{map}),
     collision_checker_(new CollisionChecker{map}),
     reference_path_(new ReferencePath),
-    vehicle_state_(new VehicleState{start_state, end_state, 0, 0}) {
+    vehicle_state_(new VehicleState{start_state, end_state, 0, 0}),
+    incremental_smoother_(new IncrementalSmoother),
+    race_thread_pool_(new ResizableThreadPool),
+    workspace_(new PlanningWorkspace),
+    result_cache_(new ResultCache),
+    candidate_thread_pool_(new ResizableThreadPool) {
+    incremental_smoother_->setRaceThreadPool(race_thread_pool_);
     updateConfig();
 }
 
@@ -35,61 +53,285 @@ PathOptimizer::~PathOptimizer() {
     delete collision_checker_;
     delete reference_path_;
     delete vehicle_state_;
+    delete incremental_smoother_;
+    delete race_thread_pool_;
+    delete workspace_;
+    delete result_cache_;
+    delete candidate_thread_pool_;
 }
 
-bool PathOptimizer::solve(const std::vector<State> &reference_points, std::vector<State> *final_path) {
-    if (FLAGS_enable_computation_time_output) std::cout << "------" << std::endl;
+void PathOptimizer::setMap(const grid_map::GridMap &map) {
+    grid_map_->setGridMap(map);
+    collision_checker_->setMap(map);
+    // The kept smoothing result may run into new obstacles.
+    incremental_smoother_->clear();
+}
+
+void PathOptimizer::setStartState(const State &start_state) {
+    vehicle_state_->setStartState(start_state);
+}
+
+void PathOptimizer::setEndState(const State &end_state) {
+    vehicle_state_->setEndState(end_state);
+}
+
+namespace {
+void printStats(const PlanningStats &stats) {
+    for (int i = 0; i != PlanningStats::kStageNum; ++i) {
+        if (stats.stage_ms[i] == 0) continue;
+        std::cout << PlanningStats::stageName(static_cast<PlanningStats::Stage>(i)) << " time cost: "
+                  << stats.stage_ms[i] << " ms." << std::endl;
+#ifdef PATH_OPTIMIZER_ENABLE_ALLOCATION_TRACKING
+        std::cout << PlanningStats::stageName(static_cast<PlanningStats::Stage>(i)) << " allocations: "
+                  << stats.stage_allocations[i] << ", " << stats.stage_allocated_bytes[i] << " bytes."
+                  << std::endl;
+#endif
+    }
+    if (stats.deadline_exceeded) std::cout << "Latency budget exceeded." << std::endl;
+    if (stats.qp_early_stopped) std::cout << "QP stopped early at the latency budget." << std::endl;
+    if (stats.cache_result != PlanningStats::kCacheDisabled) {
+        std::cout << "Result cache: " << PlanningStats::cacheResultName(stats.cache_result) << ", "
+                  << stats.cache_path_hits << " path hits and " << stats.cache_reference_hits
+                  << " reference hits in " << stats.cache_lookups << " lookups." << std::endl;
+    }
+    std::cout << "All time cost: " << stats.total_ms << " ms." << std::endl;
+}
+}
+
+bool PathOptimizer::solve(const std::vector<State> &reference_points,
+                          std::vector<State> *final_path,
+                          PlanningStats *stats) {
+    CHECK_NOTNULL(final_path);
+    PATH_OPTIMIZER_TRACE_SPAN("solve");
+    return runWithStats("Path optimization", [&](PlanningStats *stats) {
+        setCacheInput(reference_points, stats);
+        StageTimer cache_timer(stats, PlanningStats::kCache);
+        if (result_cache_->findPath(final_path)) {
+            stats->cache_result = PlanningStats::kCachePathHit;
+            size_ = 0;
+            return true;
+        }
+        cache_timer.stop();
+        if (!smoothAndOptimize(reference_points, stats) || !densifyPath(workspace_, final_path, stats)) return false;
+        // An early stopped path, or one on a timing dependent reference, is only good enough for
+        // this call.
+        if (stats->qp_early_stopped) return true;
+        if (stats->cache_result != PlanningStats::kCacheReferenceHit && !isSmoothingRepeatable()) return true;
+        StageTimer put_timer(stats, PlanningStats::kCache);
+        result_cache_->putPath(*final_path);
+        return true;
+    }, stats);
+}
+
+bool PathOptimizer::solve(const std::vector<State> &reference_points,
+                          LazyTrajectory *trajectory,
+                          PlanningStats *stats) {
+    CHECK_NOTNULL(trajectory);
+    PATH_OPTIMIZER_TRACE_SPAN("solve_lazy");
+    return runWithStats("Path optimization", [&](PlanningStats *stats) {
+        setCacheInput(reference_points, stats);
+        return smoothAndOptimize(reference_points, stats) && fitTrajectory(trajectory, stats);
+    }, stats);
+}
+
+bool PathOptimizer::solveCandidates(const std::vector<State> &reference_points,
+                                    const std::vector<PathCandidate> &candidates,
+                                    std::vector<std::vector<State>> *paths,
+                                    PlanningStats *stats) {
+    CHECK_NOTNULL(paths);
+    PATH_OPTIMIZER_TRACE_SPAN("solve_candidates");
+    return runWithStats("Multi-candidate path optimization", [&](PlanningStats *stats) {
+        if (candidates.empty()) {
+            LOG(ERROR) << "No candidate, quit path optimization!";
+            return false;
+        }
+        setCacheInput(reference_points, stats);
+        return smoothReference(reference_points, stats) && optimizeCandidates(candidates, paths, stats);
+    }, stats);
+}
+
+bool PathOptimizer::solveWithoutSmoothing(const std::vector<PathOptimizationNS::State> &reference_points,
+                                          std::vector<PathOptimizationNS::State> *final_path,
+                                          PlanningStats *stats) {
+    // This function is used to calculate once more based on the previous result.
     CHECK_NOTNULL(final_path);
+    PATH_OPTIMIZER_TRACE_SPAN("solve_without_smoothing");
+    return runWithStats("Path optimization without smoothing", [&](PlanningStats *stats) {
+        return optimizeWithoutSmoothing(reference_points, stats) && densifyPath(workspace_, final_path, stats);
+    }, stats);
+}
+
+bool PathOptimizer::runWithStats(const std::string &name,
+                                 const std::function<bool(PlanningStats *)> &plan,
+                                 PlanningStats *stats) {
+    if (FLAGS_enable_computation_time_output) std::cout << "------" << std::endl;
+    const auto start_time = std::chrono::steady_clock::now();
+    PlanningStats local_stats;
+    if (!stats) stats = &local_stats;
+    stats->clear();
+    deadline_ = Deadline::fromBudget(latency_budget_ms_);
+    // Without a budget, the checkpoints cost no more than the caller's token.
+    CancellationToken budget_token(deadline_.getTime(), cancellation_token_);
+    solve_token_ = deadline_.isSet() ? &budget_token : cancellation_token_;
+    stats->success = plan(stats);
+    solve_token_ = nullptr;
+    stats->cancelled = !stats->success && isCancelledByCaller();
+    stats->deadline_exceeded = !stats->success && !stats->cancelled
+        && (stats->deadline_exceeded || deadline_.isExpired());
+    finishStats(start_time, stats);
+    if (stats->success) {
+        LOG(INFO) << name << " SUCCEEDED! Total time cost: " << stats->total_ms / 1000 << " s";
+    } else if (stats->cancelled) {
+        LOG(INFO) << name << " CANCELLED after " << stats->total_ms << " ms.";
+    } else if (stats->deadline_exceeded) {
+        LOG(WARNING) << name << " ran out of its " << latency_budget_ms_ << " ms budget.";
+    } else {
+        LOG(ERROR) << name << " FAILED!";
+    }
+    return stats->success;
+}
+
+bool PathOptimizer::isCancelled() const {
+    return solve_token_ && solve_token_->isCancelled();
+}
+
+bool PathOptimizer::isCancelledByCaller() const {
+    return cancellation_token_ && cancellation_token_->isCancelled();
+}
+
+void PathOptimizer::setQpBudget(OsqpSolver *solver) const {
+    // The solver is reused, so clear the budget of an earlier solve.
+    if (!deadline_.isSet()) {
+        solver->setTimeBudget(0, 0);
+        return;
+    }
+    const double qp_ms = std::max(deadline_.getRemainingMs(), 0.0) * FLAGS_budget_qp_share;
+    // time_limit only works with OSQP built with profiling, the iteration limit always does.
+    const int max_iteration = qp_ms_per_iteration_ > 0
+                              ? std::max(static_cast<int>(qp_ms / qp_ms_per_iteration_), 1) : 0;
+    solver->setTimeBudget(qp_ms, max_iteration);
+}
+
+ReferencePathSmoother *PathOptimizer::getSmoother(const std::vector<State> &reference_points,
+                                                  PlanningWorkspace *workspace) const {
+    workspace->reference_points.assign(reference_points.begin(), reference_points.end());
+    if (!workspace->smoother || workspace->smoother_method != FLAGS_smoothing_method) {
+        workspace->smoother = ReferencePathSmoother::create(FLAGS_smoothing_method,
+                                                            workspace->reference_points,
+                                                            vehicle_state_->getStartState(),
+                                                            *grid_map_);
+        workspace->smoother_method = FLAGS_smoothing_method;
+    }
+    return workspace->smoother.get();
+}
+
+OsqpSolver *PathOptimizer::getSolver(const VehicleState &vehicle_state, PlanningWorkspace *workspace) const {
+    if (!workspace->solver || workspace->solver_method != FLAGS_optimization_method) {
+        workspace->solver = OsqpSolver::create(FLAGS_optimization_method, *reference_path_, vehicle_state, size_);
+        workspace->solver_method = FLAGS_optimization_method;
+    } else {
+        workspace->solver->reset(size_);
+    }
+    return workspace->solver.get();
+}
+
+void PathOptimizer::finishStats(const std::chrono::steady_clock::time_point &start_time,
+                                PlanningStats *stats) const {
+    stats->total_ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+    stats->horizon = size_;
+    stats->cache_lookups = result_cache_->getLookups();
+    stats->cache_reference_hits = result_cache_->getReferenceHits();
+    stats->cache_path_hits = result_cache_->getPathHits();
+    if (FLAGS_enable_computation_time_output) printStats(*stats);
+    if (!FLAGS_planning_stats_file.empty()) stats->appendJsonLine(FLAGS_planning_stats_file);
+}
+
+bool PathOptimizer::smoothAndOptimize(const std::vector<State> &reference_points, PlanningStats *stats) {
+    return smoothReference(reference_points, stats) && optimizePath(stats);
+}
 
-    auto t1 = std::clock();
+void PathOptimizer::setCacheInput(const std::vector<State> &reference_points, PlanningStats *stats) {
+    StageTimer cache_timer(stats, PlanningStats::kCache);
+    result_cache_->setInput(reference_points,
+                            vehicle_state_->getStartState(),
+                            vehicle_state_->getEndState(),
+                            grid_map_->getVersion());
+    if (result_cache_->enabled()) stats->cache_result = PlanningStats::kCacheMiss;
+}
+
+bool PathOptimizer::smoothReference(const std::vector<State> &reference_points, PlanningStats *stats) {
     if (reference_points.empty()) {
         LOG(ERROR) << "Empty input, quit path optimization";
         return false;
     }
     reference_path_->clear();
+    size_ = 0;
 
-    // Smooth reference path.
-    auto reference_path_smoother = ReferencePathSmoother::create(FLAGS_smoothing_method,
-                                                                 reference_points,
-                                                                 vehicle_state_->getStartState(),
-                                                                 *grid_map_);
-    bool smoothing_ok = reference_path_smoother->solve(reference_path_);
-    if (!smoothing_ok) {
-        LOG(ERROR) << "Path optimization FAILED!";
-        return false;
+    StageTimer cache_timer(stats, PlanningStats::kCache);
+    if (result_cache_->findReference(reference_path_)) {
+        stats->cache_result = PlanningStats::kCacheReferenceHit;
+    } else {
+        cache_timer.stop();
+        if (!smooth(reference_points, stats)) return false;
+        if (isSmoothingRepeatable()) {
+            StageTimer put_timer(stats, PlanningStats::kCache);
+            result_cache_->putReference(*reference_path_);
+        }
     }
+    cache_timer.stop();
+    if (isCancelled()) return false;
 
-    auto t2 = std::clock();
     // Divide reference path into segments;
-    if (!segmentSmoothedPath()) {
-        LOG(ERROR) << "Path optimization FAILED!";
-        return false;
-    }
+    return segmentSmoothedPath(stats);
+}
 
-    auto t3 = std::clock();
-    // Optimize.
-    if (optimizePath(final_path)) {
-        auto t4 = std::clock();
-        if (FLAGS_enable_computation_time_output) {
-            time_ms_out(t1, t2, "Reference smoothing");
-            time_ms_out(t2, t3, "Reference segmentation");
-            time_ms_out(t3, t4, "Optimization phase");
-            time_ms_out(t1, t4, "All");
-        }
-        LOG(INFO) << "Path optimization SUCCEEDED! Total time cost: " << time_s(t1, t4) << " s";
-        return true;
+bool PathOptimizer::smooth(const std::vector<State> &reference_points, PlanningStats *stats) {
+    // Smooth reference path.
+    StageTimer smoothing_timer(stats, PlanningStats::kSmoothing);
+    // Smoothing gets its share of the budget, the remaining stages the rest.
+    const Deadline smoothing_deadline = deadline_.share(FLAGS_budget_smoothing_share);
+    CancellationToken smoothing_budget_token(smoothing_deadline.getTime(), solve_token_);
+    const CancellationToken *smoothing_token = smoothing_deadline.isSet() ? &smoothing_budget_token : solve_token_;
+    bool smoothing_ok = false;
+    if (FLAGS_enable_incremental_smoothing) {
+        incremental_smoother_->setPlanningStats(stats);
+        incremental_smoother_->setCancellationToken(smoothing_token);
+        smoothing_ok = incremental_smoother_->solve(FLAGS_smoothing_method,
+                                                    reference_points,
+                                                    vehicle_state_->getStartState(),
+                                                    *grid_map_,
+                                                    reference_path_);
+        incremental_smoother_->setPlanningStats(nullptr);
+        incremental_smoother_->setCancellationToken(nullptr);
+    } else if (FLAGS_smoothing_method == "RACE") {
+        SmootherRace smoother_race(reference_points, vehicle_state_->getStartState(), *grid_map_);
+        smoother_race.setCancellationToken(smoothing_token);
+        smoother_race.setThreadPool(race_thread_pool_);
+        smoothing_ok = smoother_race.solve(reference_path_);
     } else {
-        LOG(ERROR) << "Path optimization FAILED!";
-        return false;
+        auto reference_path_smoother = getSmoother(reference_points, workspace_);
+        if (!reference_path_smoother) return false;
+        reference_path_smoother->setPlanningStats(stats);
+        reference_path_smoother->setCancellationToken(smoothing_token);
+        smoothing_ok = reference_path_smoother->solve(reference_path_);
+        reference_path_smoother->setPlanningStats(nullptr);
+        reference_path_smoother->setCancellationToken(nullptr);
     }
+    smoothing_timer.stop();
+    // Search and post-smoothing ran inside and are counted on their own.
+    stats->stage_ms[PlanningStats::kSmoothing] -=
+        stats->stage_ms[PlanningStats::kSearch] + stats->stage_ms[PlanningStats::kPostSmoothing];
+    // An unconverged smoothing result isn't used, there's nothing to fall back to yet.
+    if (!smoothing_ok && smoothing_deadline.isExpired()) stats->deadline_exceeded = true;
+    return smoothing_ok;
 }
 
-bool PathOptimizer::solveWithoutSmoothing(const std::vector<PathOptimizationNS::State> &reference_points,
-                                          std::vector<PathOptimizationNS::State> *final_path) {
-    // This function is used to calculate once more based on the previous result.
-    if (FLAGS_enable_computation_time_output) std::cout << "------" << std::endl;
-    CHECK_NOTNULL(final_path);
-    auto t1 = std::clock();
+bool PathOptimizer::isSmoothingRepeatable() const {
+    return !deadline_.isSet() && FLAGS_smoothing_method != "RACE";
+}
+
+bool PathOptimizer::optimizeWithoutSmoothing(const std::vector<State> &reference_points, PlanningStats *stats) {
     if (reference_points.empty()) {
         LOG(ERROR) << "Empty input, quit path optimization!";
         return false;
@@ -98,35 +340,26 @@ bool PathOptimizer::solveWithoutSmoothing(const std::vector<PathOptimizationNS::
     // Set reference path.
     reference_path_->clear();
     reference_path_->setReference(reference_points);
-    reference_path_->updateBounds(*grid_map_);
+    StageTimer bounds_timer(stats, PlanningStats::kBounds);
+    reference_path_->updateBounds(*grid_map_, solve_token_);
     reference_path_->updateLimits();
+    bounds_timer.stop();
+    if (isCancelled()) return false;
     size_ = reference_path_->getSize();
 
-    if (optimizePath(final_path)) {
-        auto t2 = std::clock();
-        if (FLAGS_enable_computation_time_output) {
-            time_ms_out(t1, t2, "Solve without smoothing");
-        }
-        LOG(INFO) << "Path optimization without smoothing SUCCEEDED! Total time cost: "
-                  << time_s(t1, t2) << " s";
-        return true;
-    } else {
-        LOG(ERROR) << "Path optimization without smoothing FAILED!";
-        return false;
-    }
+    return optimizePath(stats);
 }
 
-bool PathOptimizer::segmentSmoothedPath() {
+bool PathOptimizer::segmentSmoothedPath(PlanningStats *stats) {
+    StageTimer segmentation_timer(stats, PlanningStats::kSegmentation);
     if (reference_path_->getLength() == 0) {
         LOG(ERROR) << "Smoothed path is empty!";
         return false;
     }
 
     // Calculate the initial deviation and the angle difference.
-    State first_point;
-    first_point.x = reference_path_->getXS(0);
-    first_point.y = reference_path_->getYS(0);
-    first_point.z = getHeading(reference_path_->getXS(), reference_path_->getYS(), 0);
+    const auto &ref_line = reference_path_->getReferenceLine();
+    State first_point = ref_line.getState(0);
     auto first_point_local = global2Local(vehicle_state_->getStartState(), first_point);
     // In reference smoothing, the closest point to the vehicle is found and set as the
     // first point. So the distance here is simply the initial offset.
@@ -141,8 +374,8 @@ bool PathOptimizer::segmentSmoothedPath() {
     vehicle_state_->setInitError(initial_offset, initial_heading_error);
 
     double end_distance =
-        sqrt(pow(vehicle_state_->getEndState().x - reference_path_->getXS(reference_path_->getLength()), 2) +
-            pow(vehicle_state_->getEndState().y - reference_path_->getYS(reference_path_->getLength()), 2));
+        sqrt(pow(vehicle_state_->getEndState().x - ref_line.getX(reference_path_->getLength()), 2) +
+            pow(vehicle_state_->getEndState().y - ref_line.getY(reference_path_->getLength()), 2));
     if (!isEqual(end_distance, 0)) {
         // If the goal position is not the same as the end position of the reference line,
         // then find the closest point to the goal and change max_s of the reference line.
@@ -151,8 +384,8 @@ bool PathOptimizer::segmentSmoothedPath() {
         auto min_dis_to_goal = end_distance;
         double min_dis_s = reference_path_->getLength();
         while (tmp_s > 0) {
-            double x = reference_path_->getXS(tmp_s);
-            double y = reference_path_->getYS(tmp_s);
+            double x = ref_line.getX(tmp_s);
+            double y = ref_line.getY(tmp_s);
             double tmp_dis =
                 sqrt(pow(x - vehicle_state_->getEndState().x, 2) + pow(y - vehicle_state_->getEndState().y, 2));
             if (tmp_dis < min_dis_to_goal) {
@@ -171,55 +404,192 @@ bool PathOptimizer::segmentSmoothedPath() {
     const double delta_s_smaller = FLAGS_enable_raw_output ? 0.15 : 0.5;
     const double delta_s_larger = FLAGS_enable_raw_output ? FLAGS_output_spacing : 1.0;
     reference_path_->buildReferenceFromSpline(delta_s_smaller, delta_s_larger);
-    reference_path_->updateBounds(*grid_map_);
+    segmentation_timer.stop();
+    StageTimer bounds_timer(stats, PlanningStats::kBounds);
+    reference_path_->updateBounds(*grid_map_, solve_token_);
     reference_path_->updateLimits();
+    bounds_timer.stop();
+    if (isCancelled()) return false;
     size_ = reference_path_->getSize();
     return true;
 }
 
-bool PathOptimizer::optimizePath(std::vector<State> *final_path) {
+bool PathOptimizer::optimizePath(PlanningStats *stats) {
+    if (isCancelled()) return false;
     // Solve problem.
-    auto solver = OsqpSolver::create(FLAGS_optimization_method, *reference_path_, *vehicle_state_, size_);
-    if (solver && !solver->solve(final_path)) {
+    auto solver = getSolver(*vehicle_state_, workspace_);
+    if (!solver) return false;
+    setQpBudget(solver);
+    if (!solver->solve(&workspace_->optimized_path, stats)) {
         LOG(ERROR) << "QP failed.";
         return false;
     }
+    if (!stats->qp_early_stopped && stats->osqp_iterations > 0) {
+        qp_ms_per_iteration_ = stats->stage_ms[PlanningStats::kQpSolve] / stats->osqp_iterations;
+    }
+    return true;
+}
+
+bool PathOptimizer::optimizeCandidates(const std::vector<PathCandidate> &candidates,
+                                       std::vector<std::vector<State>> *paths,
+                                       PlanningStats *stats) {
+    while (candidate_workspaces_.size() < candidates.size()) {
+        candidate_workspaces_.emplace_back(new PlanningWorkspace);
+    }
+    paths->resize(candidates.size());
+    // The first candidate runs here, and its solution warm starts the others, which differ only in
+    // the end heading and the linear cost.
+    Eigen::VectorXd warm_start;
+    bool any_ok = solveCandidate(candidates[0],
+                                 Eigen::VectorXd(),
+                                 candidate_workspaces_[0].get(),
+                                 &(*paths)[0],
+                                 &warm_start,
+                                 stats);
+    const auto thread_pool =
+        candidate_thread_pool_->get(static_cast<std::size_t>(std::max(FLAGS_candidate_thread_num, 1)));
+    std::vector<std::future<bool>> futures;
+    futures.reserve(candidates.size() - 1);
+    for (size_t i = 1; i < candidates.size(); ++i) {
+        futures.emplace_back(thread_pool->submit([&, i] {
+            PATH_OPTIMIZER_TRACE_SPAN("path_candidate");
+            // Stats aren't shared between threads.
+            PlanningStats candidate_stats;
+            return solveCandidate(candidates[i],
+                                  warm_start,
+                                  candidate_workspaces_[i].get(),
+                                  &(*paths)[i],
+                                  nullptr,
+                                  &candidate_stats);
+        }));
+    }
+    StageTimer wait_timer(stats, PlanningStats::kQpSolve);
+    for (size_t i = 0; i != futures.size(); ++i) {
+        if (futures[i].get()) {
+            any_ok = true;
+        } else {
+            LOG(WARNING) << "Path candidate " << i + 1 << " failed.";
+        }
+    }
+    return any_ok;
+}
+
+bool PathOptimizer::solveCandidate(const PathCandidate &candidate,
+                                   const Eigen::VectorXd &warm_start,
+                                   PlanningWorkspace *workspace,
+                                   std::vector<State> *path,
+                                   Eigen::VectorXd *solution,
+                                   PlanningStats *stats) const {
+    path->clear();
+    if (isCancelled()) return false;
+    // The workspace's own state, a copy would share the owned start and end states.
+    const auto init_error = vehicle_state_->getInitError();
+    auto &vehicle_state = workspace->vehicle_state;
+    vehicle_state.setStartState(vehicle_state_->getStartState());
+    vehicle_state.setEndState(candidate.override_end_state ? candidate.end_state : vehicle_state_->getEndState());
+    vehicle_state.setInitError(init_error[0], init_error[1]);
+    auto solver = getSolver(vehicle_state, workspace);
+    if (!solver) return false;
+    solver->setLateralPreference(candidate.lateral_offset, FLAGS_candidate_lateral_weight);
+    solver->setWarmStart(warm_start);
+    setQpBudget(solver);
+    if (!solver->solve(&workspace->optimized_path, stats)) {
+        LOG(ERROR) << "QP of path candidate failed.";
+        return false;
+    }
+    if (solution) *solution = solver->getSolution();
+    if (densifyPath(workspace, path, stats)) return true;
+    path->clear();
+    return false;
+}
+
+bool PathOptimizer::densifyPath(PlanningWorkspace *workspace,
+                                std::vector<State> *final_path,
+                                PlanningStats *stats) const {
+    const double collision_check_ms = stats->stage_ms[PlanningStats::kCollisionCheck];
+    StageTimer output_timer(stats, PlanningStats::kOutput);
+    const bool output_ok = outputPath(workspace, final_path, stats);
+    output_timer.stop();
+    // Collision checks ran inside and are counted on their own.
+    stats->stage_ms[PlanningStats::kOutput] -= stats->stage_ms[PlanningStats::kCollisionCheck] - collision_check_ms;
+    return output_ok;
+}
+
+bool PathOptimizer::fitTrajectory(LazyTrajectory *trajectory, PlanningStats *stats) const {
+    if (isCancelledByCaller()) return false;
+    StageTimer output_timer(stats, PlanningStats::kOutput);
+    if (workspace_->optimized_path.size() < 3) {
+        LOG(ERROR) << "Too few optimized states to fit.";
+        return false;
+    }
+    trajectory->fit(workspace_->optimized_path);
+    return true;
+}
+
+bool PathOptimizer::outputPath(PlanningWorkspace *workspace,
+                               std::vector<State> *final_path,
+                               PlanningStats *stats) const {
+    // Check a single state, or the motion from the previous state when continuous check is enabled.
+    auto is_collision_free = [this, stats](const State *prev, const State &current) {
+        if (!FLAGS_enable_collision_check) return true;
+        StageTimer collision_check_timer(stats, PlanningStats::kCollisionCheck);
+        if (FLAGS_enable_continuous_collision_check && prev) {
+            return collision_checker_->isMotionCollisionFree(*prev, current);
+        }
+        return collision_checker_->isSingleStateCollisionFreeImproved(current);
+    };
 
     // Output. Choose from:
     // 1. set the interval smaller and output the result directly.
     // 2. set the interval larger and use interpolation to make the result dense.
+    const auto &optimized_path = workspace->optimized_path;
+    final_path->clear();
     if (FLAGS_enable_raw_output) {
+        final_path->reserve(optimized_path.size());
         double s{0};
-        for (auto iter = final_path->begin(); iter != final_path->end(); ++iter) {
-            if (iter != final_path->begin()) s += distance(*(iter - 1), *iter);
-            iter->s = s;
-            if (FLAGS_enable_collision_check && !collision_checker_->isSingleStateCollisionFreeImproved(*iter)) {
-                final_path->erase(iter, final_path->end());
+        for (size_t i = 0; i != optimized_path.size(); ++i) {
+            if (isCancelledByCaller()) return false;
+            State state = optimized_path.getState(i);
+            if (i != 0) s += distance(final_path->back(), state);
+            state.s = s;
+            const State *prev = final_path->empty() ? nullptr : &final_path->back();
+            if (!is_collision_free(prev, state)) {
                 LOG(ERROR) << "collision check failed at " << final_path->back().s << "m.";
                 return final_path->back().s >= 20;
             }
+            final_path->emplace_back(state);
         }
         return true;
     } else {
-        std::vector<double> result_x, result_y, result_s;
-        for (const auto &p : *final_path) {
-            result_x.emplace_back(p.x);
-            result_y.emplace_back(p.y);
-            result_s.emplace_back(p.s);
-        }
-        tk::spline x_s, y_s;
-        x_s.set_points(result_s, result_x);
-        y_s.set_points(result_s, result_y);
-        final_path->clear();
+        // The columns are the spline knots as they are.
+        const auto &result_s = optimized_path.getSList();
+        auto &x_s = workspace->result_x_s;
+        auto &y_s = workspace->result_y_s;
+        x_s.set_points(result_s, optimized_path.getXList());
+        y_s.set_points(result_s, optimized_path.getYList());
         double delta_s = FLAGS_output_spacing;
+        auto &output_s = workspace->output_s;
+        output_s.clear();
+        output_s.reserve(static_cast<size_t>(result_s.back() / delta_s) + 1);
         for (int i = 0; i * delta_s <= result_s.back(); ++i) {
-            double tmp_s = i * delta_s;
-            State tmp_state{x_s(tmp_s),
-                            y_s(tmp_s),
-                            getHeading(x_s, y_s, tmp_s),
-                            getCurvature(x_s, y_s, tmp_s),
-                            tmp_s};
-            if (FLAGS_enable_collision_check && !collision_checker_->isSingleStateCollisionFreeImproved(tmp_state)) {
+            output_s.emplace_back(i * delta_s);
+        }
+        auto &output_x = workspace->output_x;
+        auto &output_y = workspace->output_y;
+        auto &output_heading = workspace->output_heading;
+        auto &output_k = workspace->output_k;
+        evaluateSplines(x_s, y_s, output_s, &output_x, &output_y, &output_heading, &output_k,
+                        &workspace->output_derivatives);
+        final_path->reserve(output_s.size());
+        for (size_t i = 0; i != output_s.size(); ++i) {
+            if (isCancelledByCaller()) return false;
+            State tmp_state{output_x[i],
+                            output_y[i],
+                            output_heading[i],
+                            output_k[i],
+                            output_s[i]};
+            const State *prev = final_path->empty() ? nullptr : &final_path->back();
+            if (!is_collision_free(prev, tmp_state)) {
                 LOG(ERROR) << "[PathOptimizer] collision check failed at " << final_path->back().s << "m.";
                 return final_path->back().s >= 20;
             }
@@ -0,0 +1,101 @@
+#include <glog/logging.h>
+#include "path_optimizer/planning_service.hpp"
+#include "path_optimizer/path_optimizer.hpp"
+#include "path_optimizer/tools/cancellation_token.hpp"
+#include "path_optimizer/tools/instrumentation.hpp"
+
+namespace PathOptimizationNS {
+
+PlanningService::PlanningService(Callback callback) :
+    callback_(std::move(callback)),
+    worker_(&PlanningService::run, this) {}
+
+PlanningService::~PlanningService() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+        has_pending_ = false;
+        if (running_token_) running_token_->cancel();
+    }
+    request_condition_.notify_all();
+    worker_.join();
+}
+
+uint64_t PlanningService::submit(PlanningRequest request) {
+    uint64_t id;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        id = next_id_++;
+        if (has_pending_) VLOG(1) << "Planning request " << pending_id_ << " replaced by " << id << ".";
+        pending_request_ = std::move(request);
+        pending_id_ = id;
+        has_pending_ = true;
+        if (running_token_) running_token_->cancel();
+    }
+    request_condition_.notify_one();
+    return id;
+}
+
+void PlanningService::cancel() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    has_pending_ = false;
+    if (running_token_) running_token_->cancel();
+    idle_condition_.notify_all();
+}
+
+void PlanningService::waitUntilIdle() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    idle_condition_.wait(lock, [this] { return !has_pending_ && !running_token_; });
+}
+
+void PlanningService::run() {
+    PlanningRequest request;
+    PlanningResult result;
+    while (true) {
+        CancellationToken token;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            request_condition_.wait(lock, [this] { return stop_ || has_pending_; });
+            if (stop_) return;
+            std::swap(request, pending_request_);
+            result.request_id = pending_id_;
+            has_pending_ = false;
+            running_token_ = &token;
+        }
+        PATH_OPTIMIZER_TRACE_SPAN("planning_request");
+        result.success = plan(request, token, &result);
+        // A result finished before the cancellation took effect is still reported.
+        if (!result.stats.cancelled && callback_) callback_(result);
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_token_ = nullptr;
+        if (!has_pending_) idle_condition_.notify_all();
+    }
+}
+
+bool PlanningService::plan(const PlanningRequest &request,
+                           const CancellationToken &token,
+                           PlanningResult *result) {
+    result->path.clear();
+    result->stats.clear();
+    if (request.map && request.map != map_) {
+        map_ = request.map;
+        if (optimizer_) {
+            optimizer_->setMap(*map_);
+        } else {
+            optimizer_.reset(new PathOptimizer(request.start_state, request.end_state, *map_));
+        }
+    }
+    if (!optimizer_) {
+        LOG(ERROR) << "No map to plan on, request " << result->request_id << " dropped.";
+        return false;
+    }
+    optimizer_->setStartState(request.start_state);
+    optimizer_->setEndState(request.end_state);
+    optimizer_->setCancellationToken(&token);
+    optimizer_->setLatencyBudget(request.latency_budget_ms);
+    const bool success = optimizer_->solve(request.reference_points, &result->path, &result->stats);
+    optimizer_->setCancellationToken(nullptr);
+    return success;
+}
+
+}
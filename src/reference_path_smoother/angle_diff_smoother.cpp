@@ -1,91 +1,17 @@
 //
 // Created by ljn on 20-4-14.
 //
+#include <limits>
 #include "glog/logging.h"
+#include "OsqpEigen/OsqpEigen.h"
 #include "path_optimizer/reference_path_smoother/angle_diff_smoother.hpp"
 #include "path_optimizer/tools/tools.hpp"
 #include "path_optimizer/config/planning_flags.hpp"
 #include "path_optimizer/data_struct/reference_path.hpp"
+#include "path_optimizer/tools/cancellation_token.hpp"
 
 namespace PathOptimizationNS {
 
-FgEvalFrenetSmooth::FgEvalFrenetSmooth(const std::vector<double> &seg_x_list,
-                                       const std::vector<double> &seg_y_list,
-                                       const std::vector<double> &seg_angle_list,
-                                       const std::vector<double> &seg_s_list,
-                                       const int &N,
-                                       const std::vector<double> &cost_func) :
-    N(N),
-    seg_s_list_(seg_s_list),
-    seg_x_list_(seg_x_list),
-    seg_y_list_(seg_y_list),
-    seg_angle_list_(seg_angle_list),
-    cost_func_curvature_weight_(cost_func[0]),
-    cost_func_curvature_rate_weight_(cost_func[1]),
-    cost_func_bound_weight_(cost_func[2]),
-    cost_func_s_weight_(cost_func[3]) {}
-
-void FgEvalFrenetSmooth::operator()(PathOptimizationNS::FgEvalFrenetSmooth::ADvector &fg,
-                                    const PathOptimizationNS::FgEvalFrenetSmooth::ADvector &vars) {
-    // The rest of the constraints
-    AD<double> curvature_by_position_before;
-    AD<double> curvature_by_position;
-    AD<double> heading;
-    AD<double> heading_before;
-    for (size_t i = 2; i != N; ++i) {
-        AD<double> pq = vars[i];
-        AD<double> pq_before_before;
-        AD<double> pq_before;
-        AD<double> ref_x_before_before;
-        AD<double> ref_y_before_before;
-        AD<double> ref_angle_before_before;
-        AD<double> ref_x_before;
-        AD<double> ref_y_before;
-        AD<double> ref_angle_before;
-        AD<double> ref_x;
-        AD<double> ref_y;
-        AD<double> ref_angle;
-        AD<double> x_before_before;
-        AD<double> y_before_before;
-        AD<double> x_before;
-        AD<double> y_before;
-        AD<double> x;
-        AD<double> y;
-        pq_before_before = vars[i - 2];
-        pq_before = vars[i - 1];
-        ref_x_before_before = seg_x_list_[i - 2];
-        ref_y_before_before = seg_y_list_[i - 2];
-        ref_angle_before_before = seg_angle_list_[i - 2];
-        ref_x_before = seg_x_list_[i - 1];
-        ref_y_before = seg_y_list_[i - 1];
-        ref_angle_before = seg_angle_list_[i - 1];
-        ref_x = seg_x_list_[i];
-        ref_y = seg_y_list_[i];
-        ref_angle = seg_angle_list_[i];
-        x_before_before = ref_x_before_before + pq_before_before * CppAD::cos(ref_angle_before_before + M_PI_2);
-        y_before_before = ref_y_before_before + pq_before_before * CppAD::sin(ref_angle_before_before + M_PI_2);
-        x_before = ref_x_before + pq_before * CppAD::cos(ref_angle_before + M_PI_2);
-        y_before = ref_y_before + pq_before * CppAD::sin(ref_angle_before + M_PI_2);
-        x = ref_x + pq * CppAD::cos(ref_angle + M_PI_2);
-        y = ref_y + pq * CppAD::sin(ref_angle + M_PI_2);
-        if (seg_x_list_[i] - seg_x_list_[i - 1] < 0) {
-            heading = CppAD::atan2(-y + y_before, -x + x_before);
-            heading_before = CppAD::atan2(-y_before + y_before_before, -x_before + x_before_before);
-            curvature_by_position = heading - heading_before;
-        } else {
-            heading = CppAD::atan2(y - y_before, x - x_before);
-            heading_before = CppAD::atan2(y_before - y_before_before, x_before - x_before_before);
-            curvature_by_position = (heading - heading_before);
-        }
-        fg[0] += cost_func_curvature_weight_ * pow(curvature_by_position, 2);
-        fg[0] +=
-            cost_func_curvature_rate_weight_ * pow(curvature_by_position - curvature_by_position_before, 2);
-        fg[0] += cost_func_s_weight_ * pow(pq, 2);
-        curvature_by_position_before = curvature_by_position;
-    }
-    fg[0] += pow(vars[N - 2], 2) + pow(vars[N - 1], 2);
-}
-
 AngleDiffSmoother::AngleDiffSmoother(const std::vector<PathOptimizationNS::State> &input_points,
                                      const PathOptimizationNS::State &start_state,
                                      const PathOptimizationNS::Map &grid_map)
@@ -96,61 +22,32 @@ bool AngleDiffSmoother::smooth(PathOptimizationNS::ReferencePath *reference_path
     if (!segmentRawReference(&x_list, &y_list, &s_list, &angle_list, nullptr)) return false;
     size_t N = s_list.size();
 
-    typedef CPPAD_TESTVECTOR(double) Dvector;
-    size_t n_vars = N;
-    Dvector vars(n_vars);
-    for (size_t i = 0; i < n_vars; i++) {
-        vars[i] = 0;
-    }
     // bounds of variables
-    Dvector vars_lowerbound(n_vars);
-    Dvector vars_upperbound(n_vars);
-    for (size_t i = 0; i != n_vars; ++i) {
-        vars_lowerbound[i] = -DBL_MAX;
-        vars_upperbound[i] = DBL_MAX;
-    }
+    std::vector<double> vars_lowerbound(N, -DBL_MAX), vars_upperbound(N, DBL_MAX);
     vars_lowerbound[0] = 0;
     vars_upperbound[0] = 0;
-    vars_lowerbound[n_vars - 1] = 0;
-    vars_upperbound[n_vars - 1] = 0;
-    size_t n_constraints = 0;
-    Dvector constraints_lowerbound(n_constraints);
-    Dvector constraints_upperbound(n_constraints);
-    // options for IPOPT solver
-    std::string options;
-    // Uncomment this if you'd like more print information
-    options += "Integer print_level  0\n";
-    // NOTE: Setting sparse to true allows the solver to take advantage
-    // of sparse routines, this makes the computation MUCH FASTER. If you
-    // can uncomment 1 of these and see if it makes a difference or not but
-    // if you uncomment both the computation time should go up in orders of
-    // magnitude.
-    options += "Sparse  true        forward\n";
-    options += "Sparse  true        reverse\n";
-    // NOTE: Currently the solver has a maximum time limit of 0.1 seconds.
-    // Change this as you see fit.
-    options += "Numeric max_cpu_time          0.1\n";
-    // place to return solution
-    CppAD::ipopt::solve_result<Dvector> solution;
-    // weights of the cost function
-    std::vector<double> weights;
-    weights.push_back(FLAGS_frenet_angle_diff_weight); //curvature weight
-    weights.push_back(FLAGS_frenet_angle_diff_diff_weight); //curvature rate weight
-    weights.push_back(0.01); //distance to boundary weight
-    weights.push_back(FLAGS_frenet_deviation_weight); //deviation weight
-    FgEvalFrenetSmooth fg_eval_frenet(x_list,
-                                      y_list,
-                                      angle_list,
-                                      s_list,
-                                      N,
-                                      weights);
-    // solve the problem
-    CppAD::ipopt::solve<Dvector, FgEvalFrenetSmooth>(options, vars,
-                                                     vars_lowerbound, vars_upperbound,
-                                                     constraints_lowerbound, constraints_upperbound,
-                                                     fg_eval_frenet, solution);
-    // Check if it works
-    if (solution.status != CppAD::ipopt::solve_result<Dvector>::success) {
+    vars_lowerbound[N - 1] = 0;
+    vars_upperbound[N - 1] = 0;
+    Ipopt::SmartPtr<AngleDiffSmoothingNlp> nlp = new AngleDiffSmoothingNlp(x_list,
+                                                                            y_list,
+                                                                            angle_list,
+                                                                            vars_lowerbound,
+                                                                            vars_upperbound,
+                                                                            FLAGS_frenet_angle_diff_weight,
+                                                                            FLAGS_frenet_angle_diff_diff_weight,
+                                                                            FLAGS_frenet_deviation_weight);
+    nlp->setCancellationToken(cancellation_token_);
+    std::vector<double> solution;
+    bool solver_ok{false};
+    if (FLAGS_angle_diff_solver == "IPOPT") {
+        solver_ok = ipoptSmooth(nlp, &solution);
+    } else if (FLAGS_angle_diff_solver == "OSQP") {
+        solver_ok = osqpSmooth(*nlp, vars_lowerbound, vars_upperbound, &solution);
+    } else {
+        LOG(ERROR) << "No such solver for angle diff smoother!";
+        return false;
+    }
+    if (!solver_ok) {
         LOG(ERROR) << "Angle diff smoother failed!";
         return false;
     }
@@ -163,8 +60,8 @@ bool AngleDiffSmoother::smooth(PathOptimizationNS::ReferencePath *reference_path
     for (size_t i = 0; i != N; i++) {
         double length_on_ref_path = s_list[i];
         double new_angle = constraintAngle(angle_list[i] + M_PI_2);
-        double tmp_x = raw_x_s(length_on_ref_path) + solution.x[i] * cos(new_angle);
-        double tmp_y = raw_y_s(length_on_ref_path) + solution.x[i] * sin(new_angle);
+        double tmp_x = raw_x_s(length_on_ref_path) + solution[i] * cos(new_angle);
+        double tmp_y = raw_y_s(length_on_ref_path) + solution[i] * sin(new_angle);
         result_x_list.emplace_back(tmp_x);
         result_y_list.emplace_back(tmp_y);
         if (i != 0) {
@@ -178,7 +75,7 @@ bool AngleDiffSmoother::smooth(PathOptimizationNS::ReferencePath *reference_path
     x_spline.set_points(result_s_list, result_x_list);
     y_spline.set_points(result_s_list, result_y_list);
     double max_s_result{result_s_list.back() + 3};
-    reference_path->setSpline(x_spline, y_spline, max_s_result);
+    reference_path->setSpline(std::move(x_spline), std::move(y_spline), max_s_result);
 
     x_list_ = std::move(result_x_list);
     y_list_ = std::move(result_y_list);
@@ -186,4 +83,117 @@ bool AngleDiffSmoother::smooth(PathOptimizationNS::ReferencePath *reference_path
     return true;
 }
 
+bool AngleDiffSmoother::ipoptSmooth(const Ipopt::SmartPtr<AngleDiffSmoothingNlp> &nlp,
+                                    std::vector<double> *offsets) const {
+    // NOTE: Currently the solver has a maximum time limit of 0.1 seconds, or less under a deadline.
+    // Change this as you see fit.
+    solveFrenetOffsetNlp(nlp, getMaxCpuTime(0.1), false, cancellation_token_);
+    if (nlp->getStatus() != Ipopt::SUCCESS) return false;
+    *offsets = nlp->getSolution();
+    return true;
+}
+
+bool AngleDiffSmoother::osqpSmooth(const AngleDiffSmoothingNlp &nlp,
+                                   const std::vector<double> &lower_bound,
+                                   const std::vector<double> &upper_bound,
+                                   std::vector<double> *offsets) const {
+    return solveAngleDiffSqp(nlp,
+                             lower_bound,
+                             upper_bound,
+                             getMaxCpuTime(std::numeric_limits<double>::infinity()),
+                             cancellation_token_,
+                             offsets);
+}
+
+bool solveAngleDiffSqp(const AngleDiffSmoothingNlp &nlp,
+                       const std::vector<double> &lower_bound,
+                       const std::vector<double> &upper_bound,
+                       double time_limit,
+                       const CancellationToken *token,
+                       std::vector<double> *offsets) {
+    static const double initial_trust_radius{0.5}, max_trust_radius{2.0}, min_trust_radius{1e-3};
+    static const double step_tolerance{1e-3};
+    const auto size = lower_bound.size();
+    const int band_width = FrenetOffsetNlp::kBandWidth;
+    std::vector<double> d(size, 0.0), trial(size), gradient_list(size), band(size * band_width);
+    double cost{0};
+    nlp.evalGaussNewton(d.data(), &cost, nullptr, nullptr);
+    double trust_radius{initial_trust_radius};
+    OsqpEigen::Solver solver;
+    solver.settings()->setVerbosity(false);
+    solver.settings()->setWarmStart(true);
+    if (std::isfinite(time_limit)) solver.settings()->setTimeLimit(time_limit);
+    solver.data()->setNumberOfVariables(size);
+    solver.data()->setNumberOfConstraints(size);
+    Eigen::SparseMatrix<double> hessian(size, size), linear_matrix(size, size);
+    linear_matrix.setIdentity();
+    Eigen::VectorXd gradient(size), lower(size), upper(size);
+    std::vector<Eigen::Triplet<double>> triplets;
+    triplets.reserve(size * (2 * band_width - 1));
+    bool model_changed{true};
+    for (int iter = 0; iter != FLAGS_angle_diff_sqp_max_iter; ++iter) {
+        if (token && token->isCancelled()) return false;
+        // Quadratic model of the cost around d: Gauss-Newton Hessian, which is PSD, and exact gradient.
+        if (model_changed) {
+            std::fill(gradient_list.begin(), gradient_list.end(), 0.0);
+            std::fill(band.begin(), band.end(), 0.0);
+            nlp.evalGaussNewton(d.data(), nullptr, gradient_list.data(), &band);
+            triplets.clear();
+            for (size_t i = 0; i != size; ++i) {
+                gradient(i) = gradient_list[i];
+                for (size_t k = 0; k != band_width && k <= i; ++k) {
+                    // Keep explicit zeros so that the sparsity pattern never changes.
+                    triplets.emplace_back(i, i - k, band[i * band_width + k]);
+                    if (k != 0) triplets.emplace_back(i - k, i, band[i * band_width + k]);
+                }
+            }
+            hessian.setFromTriplets(triplets.begin(), triplets.end());
+        }
+        // Variable bounds intersected with the trust region.
+        for (size_t i = 0; i != size; ++i) {
+            lower(i) = std::max(lower_bound[i] - d[i], -trust_radius);
+            upper(i) = std::min(upper_bound[i] - d[i], trust_radius);
+        }
+        if (iter == 0) {
+            if (!solver.data()->setHessianMatrix(hessian)) return false;
+            if (!solver.data()->setGradient(gradient)) return false;
+            if (!solver.data()->setLinearConstraintsMatrix(linear_matrix)) return false;
+            if (!solver.data()->setLowerBound(lower)) return false;
+            if (!solver.data()->setUpperBound(upper)) return false;
+            if (!solver.initSolver()) return false;
+        } else {
+            if (model_changed) {
+                if (!solver.updateHessianMatrix(hessian)) return false;
+                if (!solver.updateGradient(gradient)) return false;
+            }
+            if (!solver.updateBounds(lower, upper)) return false;
+        }
+        if (!solver.solve()) return false;
+        const Eigen::VectorXd step = solver.getSolution();
+        // Compare the actual reduction with the one predicted by the model.
+        const double predicted_reduction = -gradient.dot(step) - 0.5 * step.dot(hessian * step);
+        for (size_t i = 0; i != size; ++i) {
+            trial[i] = d[i] + step(i);
+        }
+        double trial_cost{0};
+        nlp.evalGaussNewton(trial.data(), &trial_cost, nullptr, nullptr);
+        const double actual_reduction = cost - trial_cost;
+        const double ratio = predicted_reduction > 0 ? actual_reduction / predicted_reduction : 0;
+        const double step_norm = step.lpNorm<Eigen::Infinity>();
+        if (ratio < 0.25) {
+            trust_radius = 0.25 * step_norm;
+        } else if (ratio > 0.75 && step_norm > 0.9 * trust_radius) {
+            trust_radius = std::min(2 * trust_radius, max_trust_radius);
+        }
+        model_changed = actual_reduction > 0;
+        if (model_changed) {
+            d.swap(trial);
+            cost = trial_cost;
+        }
+        if ((model_changed && step_norm < step_tolerance) || trust_radius < min_trust_radius) break;
+    }
+    *offsets = std::move(d);
+    return true;
+}
+
 }
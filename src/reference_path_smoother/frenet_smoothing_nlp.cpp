@@ -0,0 +1,387 @@
+#include <cmath>
+#include <algorithm>
+#include <chrono>
+#include "glog/logging.h"
+#include "path_optimizer/reference_path_smoother/frenet_smoothing_nlp.hpp"
+#include "path_optimizer/config/planning_flags.hpp"
+#include "path_optimizer/tools/cancellation_token.hpp"
+
+namespace PathOptimizationNS {
+
+constexpr int FrenetOffsetNlp::kBandWidth;
+
+FrenetOffsetNlp::FrenetOffsetNlp(const std::vector<double> &x_list,
+                                 const std::vector<double> &y_list,
+                                 const std::vector<double> &angle_list,
+                                 const std::vector<double> &lower_bound,
+                                 const std::vector<double> &upper_bound) :
+    size_(x_list.size()),
+    x_list_(x_list),
+    y_list_(y_list),
+    lower_bound_(lower_bound),
+    upper_bound_(upper_bound),
+    band_(size_ * kBandWidth, 0.0) {
+    CHECK_EQ(x_list.size(), y_list.size());
+    CHECK_EQ(x_list.size(), angle_list.size());
+    CHECK_EQ(x_list.size(), lower_bound.size());
+    CHECK_EQ(x_list.size(), upper_bound.size());
+    nx_.reserve(size_);
+    ny_.reserve(size_);
+    for (const auto angle : angle_list) {
+        nx_.emplace_back(cos(angle + M_PI_2));
+        ny_.emplace_back(sin(angle + M_PI_2));
+    }
+}
+
+bool FrenetOffsetNlp::get_nlp_info(Ipopt::Index &n, Ipopt::Index &m, Ipopt::Index &nnz_jac_g,
+                                   Ipopt::Index &nnz_h_lag, IndexStyleEnum &index_style) {
+    n = static_cast<Ipopt::Index>(size_);
+    m = 0;
+    nnz_jac_g = 0;
+    nnz_h_lag = 0;
+    for (size_t i = 0; i != size_; ++i) {
+        nnz_h_lag += static_cast<Ipopt::Index>(std::min<size_t>(i, kBandWidth - 1)) + 1;
+    }
+    index_style = TNLP::C_STYLE;
+    return true;
+}
+
+bool FrenetOffsetNlp::get_bounds_info(Ipopt::Index n, Ipopt::Number *x_l, Ipopt::Number *x_u,
+                                      Ipopt::Index m, Ipopt::Number *g_l, Ipopt::Number *g_u) {
+    for (Ipopt::Index i = 0; i != n; ++i) {
+        x_l[i] = lower_bound_[i];
+        x_u[i] = upper_bound_[i];
+    }
+    return true;
+}
+
+bool FrenetOffsetNlp::get_starting_point(Ipopt::Index n, bool init_x, Ipopt::Number *x,
+                                         bool init_z, Ipopt::Number *z_L, Ipopt::Number *z_U,
+                                         Ipopt::Index m, bool init_lambda, Ipopt::Number *lambda) {
+    if (init_z || init_lambda) return false;
+    // Start from the raw reference.
+    std::fill(x, x + n, 0.0);
+    return true;
+}
+
+bool FrenetOffsetNlp::eval_g(Ipopt::Index n, const Ipopt::Number *x, bool new_x, Ipopt::Index m, Ipopt::Number *g) {
+    return true;
+}
+
+bool FrenetOffsetNlp::eval_jac_g(Ipopt::Index n, const Ipopt::Number *x, bool new_x, Ipopt::Index m,
+                                 Ipopt::Index nele_jac, Ipopt::Index *iRow, Ipopt::Index *jCol,
+                                 Ipopt::Number *values) {
+    return true;
+}
+
+bool FrenetOffsetNlp::eval_h(Ipopt::Index n, const Ipopt::Number *x, bool new_x, Ipopt::Number obj_factor,
+                             Ipopt::Index m, const Ipopt::Number *lambda, bool new_lambda, Ipopt::Index nele_hess,
+                             Ipopt::Index *iRow, Ipopt::Index *jCol, Ipopt::Number *values) {
+    Ipopt::Index idx = 0;
+    if (!values) {
+        // Structure of the lower band, row by row.
+        for (Ipopt::Index i = 0; i != n; ++i) {
+            for (Ipopt::Index k = std::min(i, kBandWidth - 1); k >= 0; --k) {
+                iRow[idx] = i;
+                jCol[idx] = i - k;
+                ++idx;
+            }
+        }
+    } else {
+        std::fill(band_.begin(), band_.end(), 0.0);
+        addHessianBand(x, obj_factor, &band_);
+        for (Ipopt::Index i = 0; i != n; ++i) {
+            for (Ipopt::Index k = std::min(i, kBandWidth - 1); k >= 0; --k) {
+                values[idx++] = band_[i * kBandWidth + k];
+            }
+        }
+    }
+    CHECK_EQ(idx, nele_hess);
+    return true;
+}
+
+void FrenetOffsetNlp::finalize_solution(Ipopt::SolverReturn status, Ipopt::Index n, const Ipopt::Number *x,
+                                        const Ipopt::Number *z_L, const Ipopt::Number *z_U, Ipopt::Index m,
+                                        const Ipopt::Number *g, const Ipopt::Number *lambda,
+                                        Ipopt::Number obj_value, const Ipopt::IpoptData *ip_data,
+                                        Ipopt::IpoptCalculatedQuantities *ip_cq) {
+    status_ = status;
+    solution_.assign(x, x + n);
+}
+
+bool FrenetOffsetNlp::intermediate_callback(Ipopt::AlgorithmMode mode, Ipopt::Index iter, Ipopt::Number obj_value,
+                                            Ipopt::Number inf_pr, Ipopt::Number inf_du, Ipopt::Number mu,
+                                            Ipopt::Number d_norm, Ipopt::Number regularization_size,
+                                            Ipopt::Number alpha_du, Ipopt::Number alpha_pr, Ipopt::Index ls_trials,
+                                            const Ipopt::IpoptData *ip_data,
+                                            Ipopt::IpoptCalculatedQuantities *ip_cq) {
+    return !(cancellation_token_ && cancellation_token_->isCancelled());
+}
+
+void FrenetOffsetNlp::addSquaredTerm(double weight, double r, const double *r_grad, const double *r_hess,
+                                     int begin, int count,
+                                     double *cost, double *grad, std::vector<double> *band, double scale) {
+    if (cost) *cost += weight * r * r;
+    if (grad) {
+        for (int j = 0; j != count; ++j) {
+            grad[begin + j] += 2 * weight * r * r_grad[j];
+        }
+    }
+    if (band) {
+        // d2(w * r^2) = 2w * (grad_r * grad_r^T + r * hess_r)
+        for (int j = 0; j != count; ++j) {
+            for (int k = 0; k <= j; ++k) {
+                double value = r_grad[j] * r_grad[k];
+                if (r_hess) value += r * r_hess[j * count + k];
+                (*band)[(begin + j) * kBandWidth + j - k] += scale * 2 * weight * value;
+            }
+        }
+    }
+}
+
+TensionSmoothingNlp::TensionSmoothingNlp(const std::vector<double> &x_list,
+                                         const std::vector<double> &y_list,
+                                         const std::vector<double> &angle_list,
+                                         const std::vector<double> &lower_bound,
+                                         const std::vector<double> &upper_bound) :
+    FrenetOffsetNlp(x_list, y_list, angle_list, lower_bound, upper_bound) {
+    auto add_term = [this](double weight, int begin, std::initializer_list<double> coeff) {
+        LinearTerm term{};
+        term.weight = weight;
+        term.begin = begin;
+        term.count = static_cast<int>(coeff.size());
+        std::copy(coeff.begin(), coeff.end(), term.coeff);
+        for (int k = 0; k != term.count; ++k) {
+            term.base_x += term.coeff[k] * x_list_[begin + k];
+            term.base_y += term.coeff[k] * y_list_[begin + k];
+        }
+        terms_.emplace_back(term);
+    };
+    for (int i = 1; i + 1 < static_cast<int>(size_); ++i) {
+        // Curvature cost.
+        add_term(FLAGS_cartesian_curvature_weight, i - 1, {1, -2, 1});
+        // Curvature rate cost.
+        if (i > 1) add_term(FLAGS_cartesian_curvature_rate_weight, i - 2, {-1, 3, -3, 1});
+    }
+    // The cost is quadratic, so the Hessian doesn't depend on d.
+    std::vector<double> band(size_ * kBandWidth, 0.0);
+    addHessianBand(nullptr, 1.0, &band);
+    constant_band_ = std::move(band);
+}
+
+void TensionSmoothingNlp::evalCost(const Ipopt::Number *d, double *cost, double *grad) const {
+    double grad_x[kBandWidth], grad_y[kBandWidth];
+    for (const auto &term : terms_) {
+        double rx = term.base_x, ry = term.base_y;
+        for (int k = 0; k != term.count; ++k) {
+            const int idx = term.begin + k;
+            grad_x[k] = term.coeff[k] * nx_[idx];
+            grad_y[k] = term.coeff[k] * ny_[idx];
+            rx += grad_x[k] * d[idx];
+            ry += grad_y[k] * d[idx];
+        }
+        addSquaredTerm(term.weight, rx, grad_x, nullptr, term.begin, term.count, cost, grad, nullptr, 0);
+        addSquaredTerm(term.weight, ry, grad_y, nullptr, term.begin, term.count, cost, grad, nullptr, 0);
+    }
+    // Deviation cost.
+    const double one = 1.0;
+    for (size_t i = 1; i + 1 < size_; ++i) {
+        addSquaredTerm(FLAGS_cartesian_deviation_weight, d[i], &one, nullptr, i, 1, cost, grad, nullptr, 0);
+    }
+}
+
+bool TensionSmoothingNlp::eval_f(Ipopt::Index n, const Ipopt::Number *x, bool new_x, Ipopt::Number &obj_value) {
+    obj_value = 0;
+    evalCost(x, &obj_value, nullptr);
+    return true;
+}
+
+bool TensionSmoothingNlp::eval_grad_f(Ipopt::Index n, const Ipopt::Number *x, bool new_x, Ipopt::Number *grad_f) {
+    std::fill(grad_f, grad_f + n, 0.0);
+    evalCost(x, nullptr, grad_f);
+    return true;
+}
+
+void TensionSmoothingNlp::addHessianBand(const Ipopt::Number *d, double scale, std::vector<double> *band) const {
+    if (!constant_band_.empty()) {
+        for (size_t i = 0; i != band->size(); ++i) {
+            (*band)[i] += scale * constant_band_[i];
+        }
+        return;
+    }
+    // Called once from the constructor. The residuals don't matter because they are linear.
+    double grad_x[kBandWidth], grad_y[kBandWidth];
+    for (const auto &term : terms_) {
+        for (int k = 0; k != term.count; ++k) {
+            grad_x[k] = term.coeff[k] * nx_[term.begin + k];
+            grad_y[k] = term.coeff[k] * ny_[term.begin + k];
+        }
+        addSquaredTerm(term.weight, 0, grad_x, nullptr, term.begin, term.count, nullptr, nullptr, band, scale);
+        addSquaredTerm(term.weight, 0, grad_y, nullptr, term.begin, term.count, nullptr, nullptr, band, scale);
+    }
+    const double one = 1.0;
+    for (size_t i = 1; i + 1 < size_; ++i) {
+        addSquaredTerm(FLAGS_cartesian_deviation_weight, 0, &one, nullptr, i, 1, nullptr, nullptr, band, scale);
+    }
+}
+
+AngleDiffSmoothingNlp::AngleDiffSmoothingNlp(const std::vector<double> &x_list,
+                                             const std::vector<double> &y_list,
+                                             const std::vector<double> &angle_list,
+                                             const std::vector<double> &lower_bound,
+                                             const std::vector<double> &upper_bound,
+                                             double angle_diff_weight,
+                                             double angle_diff_diff_weight,
+                                             double deviation_weight) :
+    FrenetOffsetNlp(x_list, y_list, angle_list, lower_bound, upper_bound),
+    angle_diff_weight_(angle_diff_weight),
+    angle_diff_diff_weight_(angle_diff_diff_weight),
+    deviation_weight_(deviation_weight) {}
+
+namespace {
+// Angle from segment (p0, p1) to segment (p1, p2) with its gradient and Hessian w.r.t. the offsets
+// of p0, p1 and p2.
+struct SegmentAngle {
+    double value;
+    double grad[3];
+    double hess[9];
+};
+
+// Hessian of atan2(y, x) w.r.t. (x, y): [[2xy, y^2 - x^2], [y^2 - x^2, -2xy]] / r^4.
+inline void atan2Hessian(double x, double y, double *hxx, double *hxy, double *hyy) {
+    const double r4 = pow(x * x + y * y, 2);
+    *hxx = 2 * x * y / r4;
+    *hxy = (y * y - x * x) / r4;
+    *hyy = -*hxx;
+}
+
+SegmentAngle segmentAngle(const double *px, const double *py, const double *nx, const double *ny) {
+    SegmentAngle ret{};
+    const double ax = px[1] - px[0], ay = py[1] - py[0];
+    const double bx = px[2] - px[1], by = py[2] - py[1];
+    const double a2 = ax * ax + ay * ay, b2 = bx * bx + by * by;
+    ret.value = atan2(ax * by - ay * bx, ax * bx + ay * by);
+    // The value is heading(b) - heading(a). Derivatives of a and b w.r.t. the three offsets:
+    // a = p1 - p0, b = p2 - p1.
+    const double da_x[3] = {-nx[0], nx[1], 0}, da_y[3] = {-ny[0], ny[1], 0};
+    const double db_x[3] = {0, -nx[1], nx[2]}, db_y[3] = {0, -ny[1], ny[2]};
+    // d heading(v) / dv = (-v_y, v_x) / |v|^2.
+    const double ga_x = -ay / a2, ga_y = ax / a2;
+    const double gb_x = -by / b2, gb_y = bx / b2;
+    double ha_xx, ha_xy, ha_yy, hb_xx, hb_xy, hb_yy;
+    atan2Hessian(ax, ay, &ha_xx, &ha_xy, &ha_yy);
+    atan2Hessian(bx, by, &hb_xx, &hb_xy, &hb_yy);
+    for (int j = 0; j != 3; ++j) {
+        ret.grad[j] = gb_x * db_x[j] + gb_y * db_y[j] - ga_x * da_x[j] - ga_y * da_y[j];
+        for (int k = 0; k != 3; ++k) {
+            ret.hess[j * 3 + k] =
+                db_x[j] * (hb_xx * db_x[k] + hb_xy * db_y[k]) + db_y[j] * (hb_xy * db_x[k] + hb_yy * db_y[k])
+                    - da_x[j] * (ha_xx * da_x[k] + ha_xy * da_y[k]) - da_y[j] * (ha_xy * da_x[k] + ha_yy * da_y[k]);
+        }
+    }
+    return ret;
+}
+}
+
+void AngleDiffSmoothingNlp::evalCost(const Ipopt::Number *d, double *cost, double *grad,
+                                     std::vector<double> *band, double scale, bool gauss_newton) const {
+    const double one = 1.0;
+    SegmentAngle pre_angle{};
+    for (size_t i = 2; i < size_; ++i) {
+        double px[3], py[3];
+        for (int k = 0; k != 3; ++k) {
+            const size_t idx = i - 2 + k;
+            px[k] = x_list_[idx] + d[idx] * nx_[idx];
+            py[k] = y_list_[idx] + d[idx] * ny_[idx];
+        }
+        const auto angle = segmentAngle(px, py, &nx_[i - 2], &ny_[i - 2]);
+        const double *angle_hess = gauss_newton ? nullptr : angle.hess;
+        addSquaredTerm(angle_diff_weight_, angle.value, angle.grad, angle_hess, i - 2, 3, cost, grad, band, scale);
+        if (i == 2) {
+            addSquaredTerm(angle_diff_diff_weight_, angle.value, angle.grad, angle_hess, i - 2, 3,
+                           cost, grad, band, scale);
+        } else {
+            // The difference of two angles spans four offsets.
+            double diff_grad[4], diff_hess[16] = {0};
+            diff_grad[0] = -pre_angle.grad[0];
+            diff_grad[1] = angle.grad[0] - pre_angle.grad[1];
+            diff_grad[2] = angle.grad[1] - pre_angle.grad[2];
+            diff_grad[3] = angle.grad[2];
+            for (int j = 0; j != 3; ++j) {
+                for (int k = 0; k != 3; ++k) {
+                    diff_hess[(j + 1) * 4 + k + 1] += angle.hess[j * 3 + k];
+                    diff_hess[j * 4 + k] -= pre_angle.hess[j * 3 + k];
+                }
+            }
+            addSquaredTerm(angle_diff_diff_weight_, angle.value - pre_angle.value, diff_grad,
+                           gauss_newton ? nullptr : diff_hess, i - 3, 4, cost, grad, band, scale);
+        }
+        addSquaredTerm(deviation_weight_, d[i], &one, nullptr, i, 1, cost, grad, band, scale);
+        pre_angle = angle;
+    }
+    // Keep the end of the path close to the raw reference.
+    for (size_t i = size_ - 2; i < size_; ++i) {
+        addSquaredTerm(1.0, d[i], &one, nullptr, i, 1, cost, grad, band, scale);
+    }
+}
+
+bool AngleDiffSmoothingNlp::eval_f(Ipopt::Index n, const Ipopt::Number *x, bool new_x, Ipopt::Number &obj_value) {
+    obj_value = 0;
+    evalCost(x, &obj_value, nullptr, nullptr, 0, false);
+    return true;
+}
+
+bool AngleDiffSmoothingNlp::eval_grad_f(Ipopt::Index n, const Ipopt::Number *x, bool new_x, Ipopt::Number *grad_f) {
+    std::fill(grad_f, grad_f + n, 0.0);
+    evalCost(x, nullptr, grad_f, nullptr, 0, false);
+    return true;
+}
+
+void AngleDiffSmoothingNlp::addHessianBand(const Ipopt::Number *d, double scale, std::vector<double> *band) const {
+    evalCost(d, nullptr, nullptr, band, scale, false);
+}
+
+void AngleDiffSmoothingNlp::evalGaussNewton(const double *d, double *cost, double *grad,
+                                            std::vector<double> *band) const {
+    evalCost(d, cost, grad, band, 1.0, true);
+}
+
+std::timed_mutex &getIpoptMutex() {
+    static std::timed_mutex ipopt_mutex;
+    return ipopt_mutex;
+}
+
+bool lockIpoptMutex(std::unique_lock<std::timed_mutex> *lock, const CancellationToken *token) {
+    *lock = std::unique_lock<std::timed_mutex>(getIpoptMutex(), std::defer_lock);
+    if (!token) {
+        lock->lock();
+        return true;
+    }
+    // Nothing notifies the waiters on cancellation, so poll it.
+    const auto poll_period = std::chrono::milliseconds(1);
+    while (!lock->try_lock_for(poll_period)) {
+        if (token->isCancelled()) return false;
+    }
+    return true;
+}
+
+Ipopt::ApplicationReturnStatus solveFrenetOffsetNlp(const Ipopt::SmartPtr<Ipopt::TNLP> &nlp,
+                                                    double max_cpu_time,
+                                                    bool hessian_constant,
+                                                    const CancellationToken *token) {
+    std::unique_lock<std::timed_mutex> lock;
+    if (!lockIpoptMutex(&lock, token)) return Ipopt::User_Requested_Stop;
+    Ipopt::SmartPtr<Ipopt::IpoptApplication> app = IpoptApplicationFactory();
+    app->Options()->SetIntegerValue("print_level", 0);
+    app->Options()->SetStringValue("sb", "yes");
+    app->Options()->SetNumericValue("max_cpu_time", max_cpu_time);
+    if (hessian_constant) app->Options()->SetStringValue("hessian_constant", "yes");
+    auto status = app->Initialize();
+    if (status != Ipopt::Solve_Succeeded) {
+        LOG(ERROR) << "Failed to initialize IPOPT: " << status;
+        return status;
+    }
+    return app->OptimizeTNLP(nlp);
+}
+
+}
@@ -0,0 +1,237 @@
+#include <cmath>
+#include <algorithm>
+#include <memory>
+#include <limits>
+#include <glog/logging.h>
+#include "path_optimizer/reference_path_smoother/incremental_smoother.hpp"
+#include "path_optimizer/reference_path_smoother/reference_path_smoother.hpp"
+#include "path_optimizer/reference_path_smoother/smoother_race.hpp"
+#include "path_optimizer/data_struct/reference_line.hpp"
+#include "path_optimizer/tools/tools.hpp"
+#include "path_optimizer/tools/spline.h"
+#include "path_optimizer/tools/projection_index.hpp"
+#include "path_optimizer/config/planning_flags.hpp"
+
+namespace PathOptimizationNS {
+
+namespace {
+// Length over which the kept path fades into the re-smoothed one.
+const double kBlendLength = 5.0;
+// Spacing of the samples the stitched spline is fitted to.
+const double kStitchSpacing = 1.0;
+// A start projected closer than this to the kept path's start reuses it as it is.
+const double kSameStartS = 1e-3;
+// How far the stitched path's curvature may leave the range of the two paths' around the seam.
+const double kMaxSeamCurvatureExcess = 0.01;
+
+bool smoothWithMethod(const std::string &method,
+                      const std::vector<State> &input_points,
+                      const State &start_state,
+                      const Map &grid_map,
+                      PlanningStats *stats,
+                      const CancellationToken *cancellation_token,
+                      ResizableThreadPool *race_thread_pool,
+                      ReferencePath *reference_path) {
+    if (method == "RACE") {
+        SmootherRace smoother_race(input_points, start_state, grid_map);
+        smoother_race.setCancellationToken(cancellation_token);
+        smoother_race.setThreadPool(race_thread_pool);
+        return smoother_race.solve(reference_path);
+    }
+    auto smoother = ReferencePathSmoother::create(method, input_points, start_state, grid_map);
+    if (!smoother) return false;
+    smoother->setPlanningStats(stats);
+    smoother->setCancellationToken(cancellation_token);
+    return smoother->solve(reference_path);
+}
+
+bool isSamePoint(const State &p1, const State &p2) {
+    return fabs(p1.x - p2.x) < 1e-6 && fabs(p1.y - p2.y) < 1e-6;
+}
+
+// Quintic smoothstep, its first and second derivatives are 0 at t = 0 and t = 1.
+double smoothstep(double t) {
+    return t * t * t * (10 + t * (6 * t - 15));
+}
+}
+
+bool IncrementalSmoother::solve(const std::string &method,
+                                const std::vector<State> &input_points,
+                                const State &start_state,
+                                const Map &grid_map,
+                                ReferencePath *reference_path) {
+    CHECK_NOTNULL(reference_path);
+    if (has_previous_ && solveIncrementally(method, input_points, start_state, grid_map, reference_path)) {
+        keep(input_points, *reference_path);
+        return true;
+    }
+    if (!smoothWithMethod(method, input_points, start_state, grid_map, planning_stats_, cancellation_token_,
+                          race_thread_pool_, reference_path)) {
+        clear();
+        return false;
+    }
+    keep(input_points, *reference_path);
+    return true;
+}
+
+void IncrementalSmoother::clear() {
+    previous_points_.clear();
+    previous_path_.clear();
+    has_previous_ = false;
+}
+
+bool IncrementalSmoother::solveIncrementally(const std::string &method,
+                                             const std::vector<State> &input_points,
+                                             const State &start_state,
+                                             const Map &grid_map,
+                                             ReferencePath *reference_path) const {
+    if (input_points.empty()) return false;
+    // Points passed by the vehicle may have been dropped from the front of the input.
+    size_t offset = 0;
+    while (offset < previous_points_.size() && !isSamePoint(input_points.front(), previous_points_[offset])) {
+        ++offset;
+    }
+    if (offset == previous_points_.size()) return false;
+    size_t changed_index = 0;
+    const size_t common_size = std::min(input_points.size(), previous_points_.size() - offset);
+    while (changed_index < common_size
+        && isSamePoint(input_points[changed_index], previous_points_[offset + changed_index])) {
+        ++changed_index;
+    }
+
+    // The kept path starts at the last start point, the result has to start at this one.
+    const double previous_length = previous_path_.getLength();
+    const State start_projection = previous_path_.getProjectionIndex().getProjection(start_state.x, start_state.y);
+    if (distance(start_state, start_projection) > FLAGS_incremental_smoothing_max_start_offset) return false;
+    const double begin_s = start_projection.s;
+
+    if (changed_index == input_points.size() && offset + changed_index == previous_points_.size()) {
+        if (begin_s < kSameStartS) {
+            LOG(INFO) << "Same input and start as last time, reuse the smoothed path.";
+            reference_path->setSpline(previous_path_.getSharedXS(), previous_path_.getSharedYS(), previous_length);
+            return true;
+        }
+        if (previous_length - begin_s < kBlendLength) return false;
+        // Cutting the passed part off leaves the rest of the curve exactly as it was.
+        tk::spline x_spline(previous_path_.getXS()), y_spline(previous_path_.getYS());
+        x_spline.trim_left(begin_s);
+        y_spline.trim_left(begin_s);
+        reference_path->setSpline(std::move(x_spline), std::move(y_spline), previous_length - begin_s);
+        LOG(INFO) << "Same input as last time, reuse the smoothed path from " << begin_s << " m on.";
+        return true;
+    }
+    if (changed_index < 2) return false;
+
+    // The kept path is shaped by the old points after the last unchanged one, so the seam is
+    // placed some distance before it.
+    const auto &last_unchanged = input_points[changed_index - 1];
+    const double changed_s =
+        previous_path_.getProjectionIndex().getProjection(last_unchanged.x, last_unchanged.y).s;
+    const double seam_s = changed_s - FLAGS_incremental_smoothing_overlap;
+    if (seam_s - begin_s < kBlendLength) return false;
+
+    // Window input: the kept path's state at the seam, followed by the input points beyond it.
+    const State seam_state = previous_path_.getReferenceLine().getState(seam_s);
+    size_t first_index = changed_index - 1;
+    double distance_to_changed = 0;
+    while (first_index > 0) {
+        const double d = distance(input_points[first_index - 1], input_points[first_index]);
+        if (distance_to_changed + d > changed_s - seam_s - kStitchSpacing) break;
+        distance_to_changed += d;
+        --first_index;
+    }
+    std::vector<State> window_points{seam_state};
+    window_points.insert(window_points.end(), input_points.begin() + first_index, input_points.end());
+    if (window_points.size() < 4) return false;
+
+    ReferencePath window_path;
+    if (!smoothWithMethod(method, window_points, seam_state, grid_map, planning_stats_, cancellation_token_,
+                          race_thread_pool_, &window_path)) {
+        LOG(WARNING) << "Smoothing the changed part failed, smooth the whole input again.";
+        return false;
+    }
+    if (!stitch(previous_path_, begin_s, seam_s, window_path, reference_path)) return false;
+    LOG(INFO) << "Incremental smoothing kept " << seam_s - begin_s << " m of " << previous_length
+              << " m and smoothed " << window_path.getLength() << " m again.";
+    return true;
+}
+
+bool IncrementalSmoother::stitch(const ReferencePath &kept_path, double begin_s, double seam_s,
+                                 const ReferencePath &window_path, ReferencePath *reference_path) {
+    CHECK_NOTNULL(reference_path);
+    const double window_length = window_path.getLength();
+    const double blend_length = std::min({kBlendLength, kept_path.getLength() - seam_s, window_length});
+    std::vector<double> x_list, y_list, s_list;
+    const auto reserve_size = static_cast<size_t>((seam_s - begin_s + window_length) / kStitchSpacing) + 2;
+    x_list.reserve(reserve_size);
+    y_list.reserve(reserve_size);
+    s_list.reserve(reserve_size);
+    auto add_point = [&](double x, double y) {
+        if (!s_list.empty()) {
+            const double ds = sqrt(pow(x - x_list.back(), 2) + pow(y - y_list.back(), 2));
+            if (ds < 1e-3) return;
+            s_list.emplace_back(s_list.back() + ds);
+        } else {
+            s_list.emplace_back(0);
+        }
+        x_list.emplace_back(x);
+        y_list.emplace_back(y);
+    };
+    // Both paths are sampled on their splines, so the blend keeps their curvature.
+    for (double s = begin_s; s < seam_s; s += kStitchSpacing) {
+        add_point(kept_path.getXS(s), kept_path.getYS(s));
+    }
+    for (double s = 0;; s = std::min(s + kStitchSpacing, window_length)) {
+        double x = window_path.getXS(s), y = window_path.getYS(s);
+        if (s < blend_length) {
+            const double w = smoothstep(s / blend_length);
+            x = (1 - w) * kept_path.getXS(seam_s + s) + w * x;
+            y = (1 - w) * kept_path.getYS(seam_s + s) + w * y;
+        }
+        add_point(x, y);
+        if (s >= window_length) break;
+    }
+    if (s_list.size() < 3) return false;
+
+    tk::spline x_spline, y_spline;
+    x_spline.set_points(s_list, x_list);
+    y_spline.set_points(s_list, y_list);
+
+    // To end on the window path, the blend bends towards it, the more the farther the two paths
+    // curve apart. Such a result is refused, its curvature may leave the range of the two paths'.
+    const double check_step = 0.1;
+    double min_k = std::numeric_limits<double>::max(), max_k = std::numeric_limits<double>::lowest();
+    for (double s = std::max(begin_s, seam_s - kBlendLength); s <= seam_s + blend_length; s += check_step) {
+        const double k = getCurvature(kept_path.getXS(), kept_path.getYS(), s);
+        min_k = std::min(min_k, k);
+        max_k = std::max(max_k, k);
+    }
+    for (double s = 0; s <= std::min(blend_length + kBlendLength, window_length); s += check_step) {
+        const double k = getCurvature(window_path.getXS(), window_path.getYS(), s);
+        min_k = std::min(min_k, k);
+        max_k = std::max(max_k, k);
+    }
+    const double stitched_seam_s = seam_s - begin_s;
+    for (double s = std::max(0.0, stitched_seam_s - kBlendLength);
+         s <= std::min(stitched_seam_s + blend_length + kBlendLength, s_list.back()); s += check_step) {
+        const double k = getCurvature(x_spline, y_spline, s);
+        if (k < min_k - kMaxSeamCurvatureExcess || k > max_k + kMaxSeamCurvatureExcess) {
+            LOG(INFO) << "Curvature " << k << " at the seam is out of [" << min_k << ", " << max_k
+                      << "], the paths can't be stitched.";
+            return false;
+        }
+    }
+    reference_path->setSpline(std::move(x_spline), std::move(y_spline), s_list.back());
+    return true;
+}
+
+void IncrementalSmoother::keep(const std::vector<State> &input_points, const ReferencePath &reference_path) {
+    previous_points_ = input_points;
+    // A new path object sharing the result's splines, the caller's path may be cleared or set
+    // to other splines between calls.
+    previous_path_ = ReferencePath();
+    previous_path_.setSpline(reference_path.getSharedXS(), reference_path.getSharedYS(), reference_path.getLength());
+    has_previous_ = true;
+}
+
+}
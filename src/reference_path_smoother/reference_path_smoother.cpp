@@ -1,13 +1,26 @@
 //
 // Created by ljn on 20-2-9.
 //
+#include <cmath>
+#include <chrono>
+#include <limits>
+#include <algorithm>
 #include <glog/logging.h>
 #include "path_optimizer/reference_path_smoother/reference_path_smoother.hpp"
 #include "path_optimizer/tools/spline.h"
 #include "path_optimizer/tools/tools.hpp"
+#include "path_optimizer/tools/b_spline.hpp"
+#include "path_optimizer/tools/cancellation_token.hpp"
+#include "path_optimizer/tools/indexed_heap.hpp"
+#include "path_optimizer/tools/clearance_raster.hpp"
+#include "path_optimizer/tools/projection_index.hpp"
+#include "path_optimizer/tools/instrumentation.hpp"
 #include "path_optimizer/tools/Map.hpp"
 #include "path_optimizer/config/planning_flags.hpp"
 #include "path_optimizer/data_struct/reference_path.hpp"
+#include "path_optimizer/data_struct/reference_line.hpp"
+#include "path_optimizer/data_struct/search_lattice.hpp"
+#include "path_optimizer/data_struct/planning_stats.hpp"
 #include "path_optimizer/reference_path_smoother/angle_diff_smoother.hpp"
 #include "path_optimizer/reference_path_smoother/tension_smoother.hpp"
 #include "path_optimizer/reference_path_smoother/tension_smoother_2.hpp"
@@ -15,6 +28,59 @@
 
 namespace PathOptimizationNS {
 
+namespace {
+// Min obstacle distance of DP nodes and rough bounds.
+const double kSearchThreshold = 1.45;
+
+// Cost of passing a DP node.
+inline double getDpNodeCost(double l, double dis_to_obs) {
+    static const double weight_ref_offset = 1.0;
+    static const double weight_obstacle = 0.5;
+    static const double safe_distance = 3.0;
+    double cost = 0;
+    if (dis_to_obs < safe_distance) cost += (safe_distance - dis_to_obs) / safe_distance * weight_obstacle;
+    cost += fabs(l) / FLAGS_search_lateral_range * weight_ref_offset;
+    return cost;
+}
+
+// Cost of a DP edge turning by angle_change from the previous one, at local_direction to the
+// reference.
+inline double getDpEdgeCost(double angle_change, double local_direction) {
+    static const double weight_angle_change = 16.0;
+    static const double weight_ref_angle_diff = 0.5;
+    return fabs(angle_change) / M_PI_2 * weight_angle_change + fabs(local_direction) / M_PI_2 * weight_ref_angle_diff;
+}
+
+// Directions of the edges between a layer and the previous one. The edge is the difference of
+// the two layers' points moved along their own normals, which differ on a curved reference, so
+// its direction depends on l and pre_l and not only on their difference: it can't be tabulated
+// per lateral offset, and each edge takes one atan2.
+class DpLayerEdges {
+ public:
+    DpLayerEdges(const SearchLattice &lattice, int layer_index)
+        : heading_(lattice.layer_heading[layer_index]),
+          cos_heading_(lattice.layer_cos[layer_index]),
+          sin_heading_(lattice.layer_sin[layer_index]),
+          pre_cos_heading_(lattice.layer_cos[layer_index - 1]),
+          pre_sin_heading_(lattice.layer_sin[layer_index - 1]),
+          base_dx_(lattice.layer_x[layer_index] - lattice.layer_x[layer_index - 1]),
+          base_dy_(lattice.layer_y[layer_index] - lattice.layer_y[layer_index - 1]) {}
+    // Direction of the edge from pre_l on the previous layer to l, and its angle to the reference
+    // heading of this layer.
+    double getDirection(double pre_l, double l, double *local_direction) const {
+        // Edge direction in the frame of the reference heading, so the angle to the reference
+        // needs no wrapping.
+        const double dx = base_dx_ - l * sin_heading_ + pre_l * pre_sin_heading_;
+        const double dy = base_dy_ + l * cos_heading_ - pre_l * pre_cos_heading_;
+        *local_direction = atan2(dy * cos_heading_ - dx * sin_heading_, dx * cos_heading_ + dy * sin_heading_);
+        return heading_ + *local_direction;
+    }
+
+ private:
+    double heading_, cos_heading_, sin_heading_, pre_cos_heading_, pre_sin_heading_, base_dx_, base_dy_;
+};
+}
+
 std::unique_ptr<ReferencePathSmoother> ReferencePathSmoother::create(const std::string &type,
                                                                      const std::vector<State> &input_points,
                                                                      const State &start_state,
@@ -40,13 +106,37 @@ bool ReferencePathSmoother::solve(PathOptimizationNS::ReferencePath *reference_p
 
     bSpline();
 
-    if (!smooth(reference_path)) return false;
+    if (isCancelled() || !smooth(reference_path)) return false;
 
-    if (!graphSearchDp(reference_path)) return false;
+    if (isCancelled()) return false;
+    StageTimer search_timer(planning_stats_, PlanningStats::kSearch);
+    const bool search_ok = FLAGS_search_method == "A_STAR" ? graphSearch(reference_path) : graphSearchDp(reference_path);
+    search_timer.stop();
+    if (!search_ok) return false;
 
+    if (isCancelled()) return false;
+    StageTimer post_smoothing_timer(planning_stats_, PlanningStats::kPostSmoothing);
     return postSmooth(reference_path);
 }
 
+bool ReferencePathSmoother::isCancelled() const {
+    return cancellation_token_ && cancellation_token_->isCancelled();
+}
+
+double ReferencePathSmoother::getMaxCpuTime(double max_cpu_time) const {
+    if (!cancellation_token_) return max_cpu_time;
+    const auto deadline = cancellation_token_->getDeadline();
+    if (deadline == CancellationToken::Clock::time_point::max()) return max_cpu_time;
+    const double remaining = std::chrono::duration<double>(deadline - CancellationToken::Clock::now()).count();
+    // Solvers want a positive limit, an expired deadline is caught at the next checkpoint.
+    return std::max(std::min(max_cpu_time, remaining), 1e-3);
+}
+
+void ReferencePathSmoother::limitSolveTime(OsqpEigen::Solver *solver) const {
+    const double time_limit = getMaxCpuTime(std::numeric_limits<double>::infinity());
+    if (std::isfinite(time_limit)) solver->settings()->setTimeLimit(time_limit);
+}
+
 bool ReferencePathSmoother::segmentRawReference(std::vector<double> *x_list,
                                                 std::vector<double> *y_list,
                                                 std::vector<double> *s_list,
@@ -69,21 +159,8 @@ bool ReferencePathSmoother::segmentRawReference(std::vector<double> *x_list,
     if (max_s - s_list->back() > 1) {
         s_list->emplace_back(max_s);
     }
-    auto point_num = s_list->size();
     // Store reference states in vectors. They will be used later.
-    for (size_t i = 0; i != point_num; ++i) {
-        double length_on_ref_path = s_list->at(i);
-        double dx = x_spline.deriv(1, length_on_ref_path);
-        double dy = y_spline.deriv(1, length_on_ref_path);
-        double ddx = x_spline.deriv(2, length_on_ref_path);
-        double ddy = y_spline.deriv(2, length_on_ref_path);
-        double angle = atan2(dy, dx);
-        angle_list->emplace_back(angle);
-        double curvature = (dx * ddy - dy * ddx) / pow(dx * dx + dy * dy, 1.5);
-        k_list->emplace_back(curvature);
-        x_list->emplace_back(x_spline(length_on_ref_path));
-        y_list->emplace_back(y_spline(length_on_ref_path));
-    }
+    evaluateSplines(x_spline, y_spline, *s_list, x_list, y_list, angle_list, k_list);
     return true;
 }
 
@@ -91,64 +168,237 @@ std::vector<std::vector<double>> ReferencePathSmoother::display() const {
     return std::vector<std::vector<double>>{x_list_, y_list_, s_list_};
 }
 
-double ReferencePathSmoother::getG(const PathOptimizationNS::APoint &point,
-                                   const PathOptimizationNS::APoint &parent) const {
+double ReferencePathSmoother::getG(const SearchLattice &lattice, int node, int parent) const {
     // Obstacle cost.
-    grid_map::Position position(point.x, point.y);
     double obstacle_cost = 0;
-    double distance_to_obs = grid_map_.getObstacleDistance(position);
+    double distance_to_obs = lattice.dis_to_obs[node];
     double safety_distance = 5;
     if (distance_to_obs < safety_distance) {
         obstacle_cost = (safety_distance - distance_to_obs) / safety_distance * FLAGS_search_obstacle_cost;
     }
     // Deviation cost.
-    double offset_cost = fabs(point.l) / FLAGS_search_lateral_range * FLAGS_search_deviation_cost;
+    double offset_cost = fabs(lattice.l[node]) / FLAGS_search_lateral_range * FLAGS_search_deviation_cost;
     // Smoothness cost.
-    return parent.g + offset_cost + obstacle_cost;
+    return lattice.cost[parent] + offset_cost + obstacle_cost;
 }
 
-void ReferencePathSmoother::calculateCostAt(std::vector<std::vector<DpPoint>> &samples,
-                                            int layer_index,
-                                            int lateral_index) const {
+void ReferencePathSmoother::calculateLayerCost(SearchLattice *lattice_ptr, int layer_index, double lateral_spacing) const {
     if (layer_index == 0) return;
-    if (!samples[layer_index][lateral_index].is_feasible_) return;
+    auto &lattice = *lattice_ptr;
+
+    const int begin = lattice.layerBegin(layer_index), end = lattice.layerEnd(layer_index);
+    const int pre_begin = lattice.layerBegin(layer_index - 1), pre_end = lattice.layerEnd(layer_index - 1);
+    if (begin == end || pre_begin == pre_end) return;
+    // Constants of this layer pair. Edges with |delta l| > delta s are rejected, so only a band
+    // of the previous layer around the same lateral index can be a parent.
+    const double delta_s = lattice.layer_s[layer_index] - lattice.layer_s[layer_index - 1];
+    const int band = static_cast<int>(delta_s / lateral_spacing + 1e-6);
+    // Layers may cover different lateral ranges. Lateral index of this layer's first node in the
+    // previous layer.
+    const int first_offset = static_cast<int>(lround((lattice.l[begin] - lattice.l[pre_begin]) / lateral_spacing));
+    const DpLayerEdges edges(lattice, layer_index);
+
+    for (int node = begin; node != end; ++node) {
+        if (!lattice.hasFlag(node, SearchLattice::kFeasible)) continue;
+        const double l = lattice.l[node];
+        const double self_cost = getDpNodeCost(l, lattice.dis_to_obs[node]);
 
-    static const double weight_ref_offset = 1.0;
-    static const double weight_obstacle = 0.5;
-    static const double weight_angle_change = 16.0;
-    static const double weight_ref_angle_diff = 0.5;
-    static const double safe_distance = 3.0;
+        auto min_cost = DBL_MAX;
+        const int lateral_index = node - begin + first_offset;
+        const int first = pre_begin + std::max(lateral_index - band, 0);
+        const int last = std::min(pre_begin + lateral_index + band, pre_end - 1);
+        PATH_OPTIMIZER_COUNT_N(kSearchEdge, std::max(last - first + 1, 0));
+        for (int pre_node = first; pre_node <= last; ++pre_node) {
+            const double pre_cost = lattice.cost[pre_node];
+            if (pre_cost == DBL_MAX || !lattice.hasFlag(pre_node, SearchLattice::kFeasible)) continue;
+            const double pre_l = lattice.l[pre_node];
+            if (fabs(pre_l - l) > delta_s) continue;
+            double local_direction;
+            const double direction = edges.getDirection(pre_l, l, &local_direction);
+            const double edge_cost =
+                getDpEdgeCost(constraintAngle(direction - lattice.dir[pre_node]), local_direction);
+            const double total_cost = self_cost + edge_cost + pre_cost;
+            if (total_cost < min_cost) {
+                min_cost = total_cost;
+                lattice.parent[node] = pre_node;
+                lattice.dir[node] = direction;
+            }
+        }
+
+        if (lattice.parent[node] >= 0) lattice.cost[node] = min_cost;
+    }
+}
+
+void ReferencePathSmoother::calculateCostToGo(const SearchLattice &lattice,
+                                              int last_layer,
+                                              std::vector<double> *cost_to_go,
+                                              std::vector<double> *out_dir) const {
+    cost_to_go->assign(lattice.nodeNum(), DBL_MAX);
+    out_dir->assign(lattice.nodeNum(), 0);
+    for (int node = lattice.layerBegin(last_layer); node != lattice.layerEnd(last_layer); ++node) {
+        if (lattice.cost[node] != DBL_MAX) (*cost_to_go)[node] = 0;
+    }
+    for (int i = last_layer - 1; i >= 0; --i) {
+        const double delta_s = lattice.layer_s[i + 1] - lattice.layer_s[i];
+        const DpLayerEdges edges(lattice, i + 1);
+        for (int node = lattice.layerBegin(i); node != lattice.layerEnd(i); ++node) {
+            if (lattice.cost[node] == DBL_MAX) continue;
+            const double l = lattice.l[node];
+            for (int child = lattice.layerBegin(i + 1); child != lattice.layerEnd(i + 1); ++child) {
+                const double child_cost_to_go = (*cost_to_go)[child];
+                if (child_cost_to_go == DBL_MAX || fabs(lattice.l[child] - l) > delta_s) continue;
+                double local_direction;
+                const double direction = edges.getDirection(l, lattice.l[child], &local_direction);
+                // The last layer's nodes have no edge after them.
+                const double angle_change = i + 1 == last_layer ? 0 : constraintAngle((*out_dir)[child] - direction);
+                const double total_cost = getDpNodeCost(lattice.l[child], lattice.dis_to_obs[child])
+                    + getDpEdgeCost(angle_change, local_direction) + child_cost_to_go;
+                if (total_cost < (*cost_to_go)[node]) {
+                    (*cost_to_go)[node] = total_cost;
+                    (*out_dir)[node] = direction;
+                }
+            }
+        }
+    }
+}
 
-    auto &point = samples[layer_index][lateral_index];
-    double self_cost = 0;
-    if (point.dis_to_obs_ < safe_distance) self_cost += (safe_distance - point.dis_to_obs_) / safe_distance * weight_obstacle;
-    self_cost += fabs(point.l_) / FLAGS_search_lateral_range * weight_ref_offset;
+void ReferencePathSmoother::sampleDpLattice(const ReferenceLine &ref_line,
+                                            const ClearanceRaster &raster,
+                                            const std::vector<double> &layers_s,
+                                            const std::vector<std::pair<double, double>> &lateral_ranges,
+                                            double lateral_spacing,
+                                            double vehicle_l,
+                                            SearchLattice *lattice) const {
+    lattice->clear();
+    int start_lateral_index = static_cast<int>((FLAGS_search_lateral_range + vehicle_l) / lateral_spacing);
+    for (int i = 0; i < layers_s.size(); ++i) {
+        double cur_s = layers_s[i];
+        double ref_curvature = ref_line.getCurvature(cur_s);
+        double ref_r = 1 / ref_curvature;
+        lattice->addLayer(cur_s, ref_line.getX(cur_s), ref_line.getY(cur_s), ref_line.getHeading(cur_s));
+        const int row = raster.getRow(cur_s);
+        double cur_l = -FLAGS_search_lateral_range;
+        // Lateral indices keep counting from -FLAGS_search_lateral_range outside the range.
+        for (int lateral_index = 0; cur_l <= FLAGS_search_lateral_range; ++lateral_index, cur_l += lateral_spacing) {
+            if (cur_l < lateral_ranges[i].first - 1e-6 || cur_l > lateral_ranges[i].second + 1e-6) continue;
+            const int node = lattice->addNode(cur_l);
+            // 0 outside the map.
+            const double dis_to_obs = raster.getDistance(row, cur_l);
+            lattice->dis_to_obs[node] = dis_to_obs;
+            bool is_feasible = !((ref_curvature < 0 && cur_l < ref_r) || (ref_curvature > 0 && cur_l > ref_r)
+                || dis_to_obs < kSearchThreshold);
+            if (i == 0) {
+                is_feasible = lateral_index == start_lateral_index;
+                if (is_feasible) {
+                    lattice->dir[node] = start_state_.z;
+                    lattice->cost[node] = 0.0;
+                }
+            }
+            lattice->setFlag(node, SearchLattice::kFeasible, is_feasible);
+        }
+    }
+}
 
+int ReferencePathSmoother::solveDpLattice(double lateral_spacing, SearchLattice *lattice) const {
+    int max_layer_reached = 0;
+    for (int i = 0; i < lattice->layerNum(); ++i) {
+        if (isCancelled()) return -1;
+        calculateLayerCost(lattice, i, lateral_spacing);
+        bool is_layer_feasible = false;
+        for (int node = lattice->layerBegin(i); node != lattice->layerEnd(i); ++node) {
+            if (lattice->parent[node] >= 0) is_layer_feasible = true;
+        }
+        if (i != 0 && !is_layer_feasible) break;
+        max_layer_reached = i;
+    }
+    int end_node = -1;
     auto min_cost = DBL_MAX;
-    for (const auto &pre_point : samples[layer_index - 1]) {
-        if (!pre_point.is_feasible_) continue;
-        if (fabs(pre_point.l_ - point.l_) > (point.s_ - pre_point.s_)) continue;
-        double direction = atan2(point.y_ - pre_point.y_, point.x_ - pre_point.x_);
-        double edge_cost = fabs(constraintAngle(direction - pre_point.dir_)) / M_PI_2 * weight_angle_change
-            + fabs(constraintAngle(direction - point.heading_)) / M_PI_2 * weight_ref_angle_diff;
-        double total_cost = self_cost + edge_cost + pre_point.cost_;
-        if (total_cost < min_cost) {
-            min_cost = total_cost;
-            point.parent_ = &pre_point;
-            point.dir_ = direction;
+    for (int i = lattice->layerBegin(max_layer_reached); i != lattice->layerEnd(max_layer_reached); ++i) {
+        if (lattice->cost[i] < min_cost) {
+            end_node = i;
+            min_cost = lattice->cost[i];
         }
     }
+    return end_node;
+}
+
+bool ReferencePathSmoother::narrowLateralRanges(const ReferenceLine &ref_line,
+                                                const ClearanceRaster &raster,
+                                                double vehicle_l,
+                                                std::vector<std::pair<double, double>> *lateral_ranges) {
+    // Coarse pass over the same span and the whole lateral range.
+    std::vector<double> coarse_s_list;
+    const double end_s = layers_s_list_.back();
+    for (double s = layers_s_list_.front(); s < end_s - 1e-6; s += FLAGS_search_coarse_longitudinal_spacing) {
+        coarse_s_list.emplace_back(s);
+    }
+    coarse_s_list.emplace_back(end_s);
+    const std::vector<std::pair<double, double>> full_ranges(
+        coarse_s_list.size(), std::make_pair(-FLAGS_search_lateral_range, FLAGS_search_lateral_range));
+    auto &coarse_lattice = coarse_lattice_;
+    sampleDpLattice(ref_line, raster, coarse_s_list, full_ranges, FLAGS_search_coarse_lateral_spacing,
+                    vehicle_l, &coarse_lattice);
+    const int end_node = solveDpLattice(FLAGS_search_coarse_lateral_spacing, &coarse_lattice);
+    DLOG(INFO) << "Coarse DP searched " << coarse_lattice.nodeNum() << " nodes.";
+    if (end_node < 0 || coarse_lattice.layer[end_node] == 0) {
+        LOG(INFO) << "Coarse search failed, search the whole lateral range.";
+        return false;
+    }
 
-    if (point.parent_) point.cost_ = min_cost;
+    // The coarse lattice is too sparse to tell which side of an obstacle is better when the costs
+    // of both are close. So every coarse node on a path costing at most search_coarse_cost_margin
+    // more than the best one is kept, the cost of the best path through a node being its cost
+    // plus the cost to go from it to the last layer reached.
+    const int last_layer = coarse_lattice.layer[end_node];
+    auto &cost_to_go = cost_to_go_;
+    auto &out_dir = out_dir_;
+    calculateCostToGo(coarse_lattice, last_layer, &cost_to_go, &out_dir);
+    const double max_cost = coarse_lattice.cost[end_node] * (1 + FLAGS_search_coarse_cost_margin);
+    std::vector<double> path_s(last_layer + 1), lower_l(last_layer + 1, DBL_MAX), upper_l(last_layer + 1, -DBL_MAX);
+    for (int i = 0; i <= last_layer; ++i) {
+        path_s[i] = coarse_lattice.layer_s[i];
+        for (int node = coarse_lattice.layerBegin(i); node != coarse_lattice.layerEnd(i); ++node) {
+            if (coarse_lattice.cost[node] == DBL_MAX || cost_to_go[node] == DBL_MAX) continue;
+            const double angle_change = i == last_layer ? 0 : constraintAngle(out_dir[node] - coarse_lattice.dir[node]);
+            const double through_cost =
+                coarse_lattice.cost[node] + getDpEdgeCost(angle_change, 0) + cost_to_go[node];
+            if (through_cost > max_cost) continue;
+            lower_l[i] = std::min(lower_l[i], coarse_lattice.l[node]);
+            upper_l[i] = std::max(upper_l[i], coarse_lattice.l[node]);
+        }
+    }
+    // The best path itself is always kept.
+    for (int node = end_node; node >= 0; node = coarse_lattice.parent[node]) {
+        const int i = coarse_lattice.layer[node];
+        lower_l[i] = std::min(lower_l[i], coarse_lattice.l[node]);
+        upper_l[i] = std::max(upper_l[i], coarse_lattice.l[node]);
+    }
+    // The coarse start node may be a coarse spacing away from the vehicle.
+    lower_l.front() = upper_l.front() = vehicle_l;
+
+    // A band around the kept coarse nodes, the whole range beyond the last layer reached.
+    size_t j = 0;
+    for (size_t i = 0; i != layers_s_list_.size(); ++i) {
+        const double s = layers_s_list_[i];
+        if (s > path_s.back() + 1e-6) break;
+        while (j + 2 < path_s.size() && path_s[j + 1] < s) ++j;
+        const double t = std::max(0.0, std::min(1.0, (s - path_s[j]) / (path_s[j + 1] - path_s[j])));
+        const double lower = lower_l[j] + t * (lower_l[j + 1] - lower_l[j]);
+        const double upper = upper_l[j] + t * (upper_l[j + 1] - upper_l[j]);
+        (*lateral_ranges)[i].first = std::max(-FLAGS_search_lateral_range, lower - FLAGS_search_fine_band);
+        (*lateral_ranges)[i].second = std::min(FLAGS_search_lateral_range, upper + FLAGS_search_fine_band);
+    }
+    // The start node is sampled whatever the coarse path is.
+    auto &start_range = lateral_ranges->front();
+    start_range.first = std::min(start_range.first, vehicle_l - FLAGS_search_lateral_spacing);
+    start_range.second = std::max(start_range.second, vehicle_l);
+    return true;
 }
 
 bool ReferencePathSmoother::graphSearchDp(PathOptimizationNS::ReferencePath *reference) {
-    auto t1 = std::clock();
-
-    const tk::spline &x_s = reference->getXS();
-    const tk::spline &y_s = reference->getYS();
+    const auto &ref_line = reference->getReferenceLine();
     // Sampling interval.
-    double tmp_s = findClosestPoint(x_s, y_s, start_state_.x, start_state_.y, reference->getLength()).s;
+    double tmp_s = reference->getProjectionIndex().getProjection(start_state_.x, start_state_.y).s;
     layers_s_list_.clear();
     layers_bounds_.clear();
     double search_ds = reference->getLength() > 6 ? FLAGS_search_longitudial_spacing : 0.5;
@@ -161,111 +411,50 @@ bool ReferencePathSmoother::graphSearchDp(PathOptimizationNS::ReferencePath *ref
     target_s_ = layers_s_list_.back();
 
     double vehicle_s = layers_s_list_.front();
-    State proj_point(x_s(vehicle_s), y_s(vehicle_s), getHeading(x_s, y_s, vehicle_s));
+    State proj_point = ref_line.getState(vehicle_s);
     auto vehicle_local = global2Local(proj_point, start_state_);
     vehicle_l_wrt_smoothed_ref_ = vehicle_local.y;
     if (fabs(vehicle_local.y) > FLAGS_search_lateral_range) {
         LOG(INFO) << "Vehicle far from ref, quit graph search.";
         return false;
     }
-    int start_lateral_index =
-        static_cast<int>((FLAGS_search_lateral_range + vehicle_local.y) / FLAGS_search_lateral_spacing);
-
-    std::vector<std::vector<DpPoint>> samples;
-    samples.reserve(layers_s_list_.size());
-    static const double search_threshold = 1.45;
-    // Sample nodes.
-    for (int i = 0; i < layers_s_list_.size(); ++i) {
-        samples.emplace_back(std::vector<DpPoint>());
-        double cur_s = layers_s_list_[i];
-        double ref_x = x_s(cur_s);
-        double ref_y = y_s(cur_s);
-        double ref_heading = getHeading(x_s, y_s, cur_s);
-        double ref_curvature = getCurvature(x_s, y_s, cur_s);
-        double ref_r = 1 / ref_curvature;
-        double cur_l = -FLAGS_search_lateral_range;
-        int lateral_index = 0;
-        while (cur_l <= FLAGS_search_lateral_range) {
-            DpPoint dp_point;
-            dp_point.x_ = ref_x + cur_l * cos(ref_heading + M_PI_2);
-            dp_point.y_ = ref_y + cur_l * sin(ref_heading + M_PI_2);
-            dp_point.heading_ = ref_heading;
-            dp_point.s_ = cur_s;
-            dp_point.l_ = cur_l;
-            dp_point.layer_index_ = i;
-            dp_point.lateral_index_ = lateral_index;
-            grid_map::Position node_pose(dp_point.x_, dp_point.y_);
-            dp_point.dis_to_obs_ = grid_map_.isInside(node_pose) ? grid_map_.getObstacleDistance(node_pose) : -1;
-            if ((ref_curvature < 0 && cur_l < ref_r) || (ref_curvature > 0 && cur_l > ref_r)
-                || dp_point.dis_to_obs_ < search_threshold) {
-                dp_point.is_feasible_ = false;
-            }
-            if (i == 0 && dp_point.lateral_index_ != start_lateral_index) dp_point.is_feasible_ = false;
-            if (i == 0 && dp_point.lateral_index_ == start_lateral_index) {
-                dp_point.is_feasible_ = true;
-                dp_point.dir_ = start_state_.z;
-                dp_point.cost_ = 0.0;
-            }
-            samples.back().emplace_back(dp_point);
-            cur_l += FLAGS_search_lateral_spacing;
-            ++lateral_index;
-        }
-        // Get rough bounds.
-        auto &point_set = samples.back();
-        for (int j = 0; j < point_set.size(); ++j) {
-            if (j == 0 || !point_set[j - 1].is_feasible_ || !point_set[j].is_feasible_) {
-                point_set[j].rough_lower_bound = point_set[j].l_;
-            } else {
-                point_set[j].rough_lower_bound = point_set[j - 1].rough_lower_bound;
-            }
-        }
-        for (int j = point_set.size() - 1; j >= 0; --j) {
-            if (j == point_set.size() - 1 || !point_set[j + 1].is_feasible_ || !point_set[j].is_feasible_) {
-                point_set[j].rough_upper_bound = point_set[j].l_;
-            } else {
-                point_set[j].rough_upper_bound = point_set[j + 1].rough_upper_bound;
-            }
-        }
-    }
-
-    // Calculate cost.
-    int max_layer_reached = 0;
-    for (const auto &layer : samples) {
-        bool is_layer_feasible = false;
-        for (const auto &point : layer) {
-            calculateCostAt(samples, point.layer_index_, point.lateral_index_);
-            if (point.parent_) is_layer_feasible = true;
-        }
-        if (layer.front().layer_index_ != 0 && !is_layer_feasible) break;
-        max_layer_reached = layer.front().layer_index_;
-    }
-
-    // Retrieve path.
-    const DpPoint *ptr = nullptr;
-    auto min_cost = DBL_MAX;
-    for (const auto &point : samples[max_layer_reached]) {
-        if (point.cost_ < min_cost) {
-            ptr = &point;
-            min_cost = point.cost_;
-        }
-    }
-
-    while (ptr) {
-        if (ptr->layer_index_ == 0) {
+    const auto &raster = reference->getClearanceRaster(grid_map_, layers_s_list_.front(), reference->getLength(),
+                                                       FLAGS_search_lateral_range);
+    // Lateral range searched on each layer, narrowed around the coarse path if enabled.
+    std::vector<std::pair<double, double>> lateral_ranges(
+        layers_s_list_.size(), std::make_pair(-FLAGS_search_lateral_range, FLAGS_search_lateral_range));
+    const bool is_narrowed =
+        FLAGS_enable_coarse_to_fine_search && narrowLateralRanges(ref_line, raster, vehicle_local.y, &lateral_ranges);
+    auto &lattice = lattice_;
+    sampleDpLattice(ref_line, raster, layers_s_list_, lateral_ranges, FLAGS_search_lateral_spacing,
+                    vehicle_local.y, &lattice);
+    // Calculate cost and find the end of the path.
+    int node = solveDpLattice(FLAGS_search_lateral_spacing, &lattice);
+    if (isCancelled()) return false;
+    if (is_narrowed && (node < 0 || lattice.layer[node] + 1 < lattice.layerNum())) {
+        LOG(INFO) << "Search in the band is blocked, search the whole lateral range.";
+        lateral_ranges.assign(layers_s_list_.size(),
+                              std::make_pair(-FLAGS_search_lateral_range, FLAGS_search_lateral_range));
+        sampleDpLattice(ref_line, raster, layers_s_list_, lateral_ranges, FLAGS_search_lateral_spacing,
+                        vehicle_local.y, &lattice);
+        node = solveDpLattice(FLAGS_search_lateral_spacing, &lattice);
+    }
+    DLOG(INFO) << "DP searched " << lattice.nodeNum() << " nodes.";
+
+    while (node >= 0) {
+        const int layer_index = lattice.layer[node];
+        if (layer_index == 0) {
             layers_bounds_.emplace_back(-10, 10);
         } else {
             static const double check_s = 0.2;
-            double upper_bound = check_s + ptr->rough_upper_bound;
-            double lower_bound = -check_s + ptr->rough_lower_bound;
+            double rough_lower_bound, rough_upper_bound;
+            lattice.getFeasibleRun(node, &rough_lower_bound, &rough_upper_bound);
+            double upper_bound = check_s + rough_upper_bound;
+            double lower_bound = -check_s + rough_lower_bound;
             static const double check_limit = 6.0;
-            double ref_x = x_s(ptr->s_);
-            double ref_y = y_s(ptr->s_);
+            const int row = raster.getRow(lattice.layer_s[layer_index]);
             while (upper_bound < check_limit) {
-                grid_map::Position pos;
-                pos(0) = ref_x + upper_bound * cos(ptr->heading_ + M_PI_2);
-                pos(1) = ref_y + upper_bound * sin(ptr->heading_ + M_PI_2);
-                if (grid_map_.isInside(pos)
-                    && grid_map_.getObstacleDistance(pos) > search_threshold) {
+                if (raster.getDistance(row, upper_bound) > kSearchThreshold) {
                     upper_bound += check_s;
                 } else {
                     upper_bound -= check_s;
@@ -273,11 +462,7 @@ bool ReferencePathSmoother::graphSearchDp(PathOptimizationNS::ReferencePath *ref
                 }
             }
             while (lower_bound > -check_limit) {
-                grid_map::Position pos;
-                pos(0) = ref_x + lower_bound * cos(ptr->heading_ + M_PI_2);
-                pos(1) = ref_y + lower_bound * sin(ptr->heading_ + M_PI_2);
-                if (grid_map_.isInside(pos)
-                    && grid_map_.getObstacleDistance(pos) > search_threshold) {
+                if (raster.getDistance(row, lower_bound) > kSearchThreshold) {
                     lower_bound -= check_s;
                 } else {
                     lower_bound += check_s;
@@ -286,26 +471,20 @@ bool ReferencePathSmoother::graphSearchDp(PathOptimizationNS::ReferencePath *ref
             }
             layers_bounds_.emplace_back(lower_bound, upper_bound);
         }
-        ptr = ptr->parent_;
+        node = lattice.parent[node];
     }
 
     std::reverse(layers_bounds_.begin(), layers_bounds_.end());
     layers_s_list_.resize(layers_bounds_.size());
 
-    auto t2 = std::clock();
-    if (FLAGS_enable_computation_time_output) {
-        time_ms_out(t1, t2, "Search");
-    }
     return true;
 
 }
 
 bool ReferencePathSmoother::graphSearch(ReferencePath *reference) {
-    auto t1 = std::clock();
-    tk::spline x_s = reference->getXS();
-    tk::spline y_s = reference->getYS();
+    const auto &ref_line = reference->getReferenceLine();
     // Sampling interval.
-    double tmp_s = findClosestPoint(x_s, y_s, start_state_.x, start_state_.y, reference->getLength()).s;
+    double tmp_s = reference->getProjectionIndex().getProjection(start_state_.x, start_state_.y).s;
     layers_s_list_.clear();
     layers_bounds_.clear();
     double search_ds = reference->getLength() > 6 ? FLAGS_search_longitudial_spacing : 0.5;
@@ -317,28 +496,26 @@ bool ReferencePathSmoother::graphSearch(ReferencePath *reference) {
     target_s_ = layers_s_list_.back();
 
     double vehicle_s = layers_s_list_.front();
-    State proj_point(x_s(vehicle_s), y_s(vehicle_s), getHeading(x_s, y_s, vehicle_s));
+    State proj_point = ref_line.getState(vehicle_s);
     auto vehicle_local = global2Local(proj_point, start_state_);
     vehicle_l_wrt_smoothed_ref_ = vehicle_local.y;
 
-    // Sample points.
+    // Layers are added when a node of the previous layer is expanded, and the feasibility of a
+    // node is checked when it is first reached, so the work follows the explored part.
+    auto &lattice = lattice_;
+    auto &open_set = open_set_;
+    lattice.clear();
+    open_set.clear();
+    const auto &raster = reference->getClearanceRaster(grid_map_, layers_s_list_.front(), reference->getLength(),
+                                                       FLAGS_search_lateral_range);
     static const double search_k = 1.2;
-    APoint start_point;
-    start_point.x = start_state_.x;
-    start_point.y = start_state_.y;
-    start_point.dir = proj_point.z;
-    start_point.s = layers_s_list_.front();
-    start_point.l = vehicle_local.y;
-    start_point.layer = 0;
-    start_point.g = 0;
-    start_point.h = getH(start_point);
-    sampled_points_.emplace_back(std::vector<APoint>{start_point});
-    for (size_t i = 1; i != layers_s_list_.size(); ++i) {
-        double sr = layers_s_list_[i];
-        double xr = x_s(sr);
-        double yr = y_s(sr);
-        double hr = getHeading(x_s, y_s, sr);
-        double rr = 1.0 / (getCurvature(x_s, y_s, sr));
+    lattice.addLayer(layers_s_list_.front(), proj_point.x, proj_point.y, proj_point.z);
+    const int start_node = lattice.addNode(vehicle_local.y);
+    lattice.setFlag(start_node, SearchLattice::kEvaluated, true);
+    lattice.cost[start_node] = 0;
+    auto add_layer = [&](int layer_index) {
+        double sr = layers_s_list_[layer_index];
+        double rr = 1.0 / ref_line.getCurvature(sr);
         double left_range = FLAGS_search_lateral_range, right_range = -FLAGS_search_lateral_range;
         if (rr > 0) {
             // Left turn
@@ -347,118 +524,118 @@ bool ReferencePathSmoother::graphSearch(ReferencePath *reference) {
             // right turn
             right_range = std::max(right_range, rr);
         }
-        std::vector<APoint> point_set;
+        lattice.addLayer(sr, ref_line.getX(sr), ref_line.getY(sr), ref_line.getHeading(sr));
         double offset = right_range;
-        int offset_idx = 0;
         while (offset <= left_range) {
-            APoint point;
-            point.s = sr;
-            point.l = offset;
-            point.x = xr + offset * cos(hr + M_PI_2);
-            point.y = yr + offset * sin(hr + M_PI_2);
-            point.dir = hr;
-            point.layer = i;
-            point.offset_idx = offset_idx;
-            grid_map::Position position(point.x, point.y);
-            if (grid_map_.isInside(position)
-                && grid_map_.getObstacleDistance(position) > search_k * FLAGS_circle_radius) {
-                point_set.emplace_back(point);
-            }
+            lattice.addNode(offset);
             offset += FLAGS_search_lateral_spacing;
-            ++offset_idx;
         }
-        // Get rough bounds.
-        for (int i = 0; i < point_set.size(); ++i) {
-            if (i == 0 || point_set[i].offset_idx != point_set[i - 1].offset_idx + 1) {
-                point_set[i].rough_lower_bound = point_set[i].l;
-            } else {
-                point_set[i].rough_lower_bound = point_set[i - 1].rough_lower_bound;
-            }
-        }
-        for (int i = point_set.size() - 1; i >= 0; --i) {
-            if (i == point_set.size() - 1 || point_set[i].offset_idx != point_set[i + 1].offset_idx - 1) {
-                point_set[i].rough_upper_bound = point_set[i].l;
-            } else {
-                point_set[i].rough_upper_bound = point_set[i + 1].rough_upper_bound;
-            }
+    };
+    auto is_feasible = [&](int node) {
+        if (!lattice.hasFlag(node, SearchLattice::kEvaluated)) {
+            // 0 outside the map.
+            lattice.dis_to_obs[node] = raster.getDistance(raster.getRow(lattice.s(node)), lattice.l[node]);
+            lattice.setFlag(node, SearchLattice::kFeasible, lattice.dis_to_obs[node] > search_k * FLAGS_circle_radius);
+            lattice.setFlag(node, SearchLattice::kEvaluated, true);
         }
-        sampled_points_.emplace_back(point_set);
-    }
+        return lattice.hasFlag(node, SearchLattice::kFeasible);
+    };
 
     // Push the start point into the open set.
-    open_set_.push(&sampled_points_[0][0]);
-    sampled_points_[0][0].is_in_open_set = true;
+    open_set.push(start_node, getH(lattice.s(start_node)));
 
     // Search.
+    static const double max_angle = 60 * M_PI / 180;
+    const double max_slope = tan(max_angle);
     int max_layer_reached = 0;
     while (true) {
-        if (open_set_.empty()) {
+        if (isCancelled()) return false;
+        if (open_set.empty()) {
             LOG(ERROR) << "Lattice search failed!";
             break;
         }
-        auto tmp_point_ptr = open_set_.top();
-        if (isEqual(tmp_point_ptr->s, target_s_)) {
+        const int current = open_set.top();
+        if (isEqual(lattice.s(current), target_s_)) {
             break;
         }
-        open_set_.pop();
-        max_layer_reached = std::max(max_layer_reached, tmp_point_ptr->layer);
-        for (auto &child : sampled_points_[tmp_point_ptr->layer + 1]) {
+        open_set.pop();
+        lattice.setFlag(current, SearchLattice::kClosed, true);
+        const int current_layer = lattice.layer[current];
+        max_layer_reached = std::max(max_layer_reached, current_layer);
+        const int child_layer = current_layer + 1;
+        if (child_layer == static_cast<int>(layers_s_list_.size())) continue;
+        if (child_layer == lattice.layerNum()) add_layer(child_layer);
+        const int child_begin = lattice.layerBegin(child_layer), child_end = lattice.layerEnd(child_layer);
+        if (child_begin == child_end) continue;
+        // Only children within the angle limit, the exact check is done below.
+        const double delta_s = lattice.layer_s[child_layer] - lattice.s(current);
+        const double first_l = lattice.l[child_begin];
+        const double reach = max_slope * delta_s;
+        const int first = std::max(child_begin, child_begin
+            + static_cast<int>(floor((lattice.l[current] - reach - first_l) / FLAGS_search_lateral_spacing)));
+        const int last = std::min(child_end - 1, child_begin
+            + static_cast<int>(ceil((lattice.l[current] + reach - first_l) / FLAGS_search_lateral_spacing)));
+        PATH_OPTIMIZER_COUNT_N(kSearchEdge, std::max(last - first + 1, 0));
+        for (int child = first; child <= last; ++child) {
             // If angle difference is too large, skip it.
-            if (fabs(atan2(child.l - tmp_point_ptr->l, child.s - tmp_point_ptr->s)) > 60 * M_PI / 180) {
+            if (fabs(atan2(lattice.l[child] - lattice.l[current], delta_s)) > max_angle) {
                 continue;
             }
             // If already exsit in closet set, skip it.
-            if (checkExistenceInClosedSet(child)) {
+            if (lattice.hasFlag(child, SearchLattice::kClosed) || !is_feasible(child)) {
                 continue;
             }
-            if (child.is_in_open_set) {
-                double new_g = getG(child, *tmp_point_ptr);
-                if (new_g < child.g) {
-                    child.g = new_g;
-                    child.parent = tmp_point_ptr;
+            const double g = getG(lattice, child, current);
+            if (open_set.contains(child)) {
+                if (g < lattice.cost[child]) {
+                    lattice.cost[child] = g;
+                    lattice.parent[child] = current;
+                    open_set.decreaseKey(child, g + getH(lattice.s(child)));
                 }
             } else {
-                child.g = getG(child, *tmp_point_ptr);
-                child.h = getH(child);
-                child.parent = tmp_point_ptr;
-                open_set_.push(&child);
-                child.is_in_open_set = true;
+                lattice.cost[child] = g;
+                lattice.parent[child] = current;
+                open_set.push(child, g + getH(lattice.s(child)));
             }
         }
-        closed_set_.insert(tmp_point_ptr);
     }
 
     // Retrieve the optimal path.
-    APoint *ptr = nullptr;
-    if (open_set_.empty()) {
+    int node = -1;
+    if (open_set.empty()) {
         auto min_cost = DBL_MAX;
-        for (int i = 0; i < sampled_points_[max_layer_reached].size(); ++i) {
-            if (sampled_points_[max_layer_reached][i].parent == nullptr) continue;
-            if (sampled_points_[max_layer_reached][i].f() < min_cost) {
-                ptr = &sampled_points_[max_layer_reached][i];
-                min_cost = ptr->f();
+        for (int i = lattice.layerBegin(max_layer_reached); i != lattice.layerEnd(max_layer_reached); ++i) {
+            if (lattice.parent[i] < 0) continue;
+            const double f = lattice.cost[i] + getH(lattice.s(i));
+            if (f < min_cost) {
+                node = i;
+                min_cost = f;
             }
         }
     } else {
-        ptr = open_set_.top();
+        node = open_set.top();
+    }
+    // The rough bounds need the feasibility of whole layers on the path.
+    for (int i = node; i >= 0; i = lattice.parent[i]) {
+        const int layer_index = lattice.layer[i];
+        if (layer_index == 0) continue;
+        for (int j = lattice.layerBegin(layer_index); j != lattice.layerEnd(layer_index); ++j) is_feasible(j);
     }
 
-    while (ptr) {
-        if (ptr->layer == 0) {
+    while (node >= 0) {
+        const int layer_index = lattice.layer[node];
+        if (layer_index == 0) {
             layers_bounds_.emplace_back(-10, 10);
         } else {
             static const double check_s = 0.2;
-            double upper_bound = check_s + ptr->rough_upper_bound;
-            double lower_bound = -check_s + ptr->rough_lower_bound;
+            double rough_lower_bound, rough_upper_bound;
+            lattice.getFeasibleRun(node, &rough_lower_bound, &rough_upper_bound);
+            double upper_bound = check_s + rough_upper_bound;
+            double lower_bound = -check_s + rough_lower_bound;
             static const double check_limit = 6.0;
-            double ref_x = x_s(ptr->s);
-            double ref_y = y_s(ptr->s);
+            const int row = raster.getRow(lattice.layer_s[layer_index]);
             while (upper_bound < check_limit) {
-                grid_map::Position pos;
-                pos(0) = ref_x + upper_bound * cos(ptr->dir + M_PI_2);
-                pos(1) = ref_y + upper_bound * sin(ptr->dir + M_PI_2);
-                if (grid_map_.isInside(pos)
-                    && grid_map_.getObstacleDistance(pos) > 1.3 * FLAGS_circle_radius) {
+                if (raster.getDistance(row, upper_bound) > 1.3 * FLAGS_circle_radius) {
                     upper_bound += check_s;
                 } else {
                     upper_bound -= check_s;
@@ -466,11 +643,7 @@ bool ReferencePathSmoother::graphSearch(ReferencePath *reference) {
                 }
             }
             while (lower_bound > -check_limit) {
-                grid_map::Position pos;
-                pos(0) = ref_x + lower_bound * cos(ptr->dir + M_PI_2);
-                pos(1) = ref_y + lower_bound * sin(ptr->dir + M_PI_2);
-                if (grid_map_.isInside(pos)
-                    && grid_map_.getObstacleDistance(pos) > search_k * FLAGS_circle_radius) {
+                if (raster.getDistance(row, lower_bound) > search_k * FLAGS_circle_radius) {
                     lower_bound -= check_s;
                 } else {
                     lower_bound += check_s;
@@ -479,22 +652,14 @@ bool ReferencePathSmoother::graphSearch(ReferencePath *reference) {
             }
             layers_bounds_.emplace_back(lower_bound, upper_bound);
         }
-        ptr = ptr->parent;
+        node = lattice.parent[node];
     }
     std::reverse(layers_bounds_.begin(), layers_bounds_.end());
     layers_s_list_.resize(layers_bounds_.size());
 
-    auto t2 = std::clock();
-    if (FLAGS_enable_computation_time_output) {
-        time_ms_out(t1, t2, "Search");
-    }
     return true;
 }
 
-bool ReferencePathSmoother::checkExistenceInClosedSet(const APoint &point) const {
-    return closed_set_.find(&point) != closed_set_.end();
-}
-
 void ReferencePathSmoother::bSpline() {
     // B spline smoothing.
     double length = 0;
@@ -506,29 +671,10 @@ void ReferencePathSmoother::bSpline() {
     if (average_length > 10) degree = 3;
     else if (average_length > 5) degree = 4;
     else degree = 5;
-    tinyspline::BSpline b_spline_raw(input_points_.size(), 2, degree);
-    std::vector<tinyspline::real> ctrlp_raw = b_spline_raw.controlPoints();
-    for (size_t i = 0; i != input_points_.size(); ++i) {
-        ctrlp_raw[2 * (i)] = input_points_[i].x;
-        ctrlp_raw[2 * (i) + 1] = input_points_[i].y;
-    }
-    b_spline_raw.setControlPoints(ctrlp_raw);
-    double delta_t = 1.0 / length;
-    double tmp_t = 0;
-    while (tmp_t < 1) {
-        auto result = b_spline_raw.eval(tmp_t).result();
-        x_list_.emplace_back(result[0]);
-        y_list_.emplace_back(result[1]);
-        tmp_t += delta_t;
-    }
-    auto result = b_spline_raw.eval(1).result();
-    x_list_.emplace_back(result[0]);
-    y_list_.emplace_back(result[1]);
-    s_list_.emplace_back(0);
-    for (size_t i = 1; i != x_list_.size(); ++i) {
-        double dis = sqrt(pow(x_list_[i] - x_list_[i - 1], 2) + pow(y_list_[i] - y_list_[i - 1], 2));
-        s_list_.emplace_back(s_list_.back() + dis);
-    }
+    // Sample by arc length so that the points are evenly spaced for segmentRawReference.
+    static const double sample_spacing{1.0};
+    ClampedBSpline b_spline_raw(input_points_, degree);
+    b_spline_raw.sampleByArcLength(sample_spacing, &x_list_, &y_list_, &s_list_);
 }
 
 bool ReferencePathSmoother::postSmooth(PathOptimizationNS::ReferencePath *reference_path) {
@@ -541,6 +687,7 @@ bool ReferencePathSmoother::postSmooth(PathOptimizationNS::ReferencePath *refere
     OsqpEigen::Solver solver;
     solver.settings()->setVerbosity(false);
     solver.settings()->setWarmStart(true);
+    limitSolveTime(&solver);
     solver.data()->setNumberOfVariables(3 * point_num);
     solver.data()->setNumberOfConstraints(3 * point_num - 2);
     // Allocate QP problem matrices and vectors.
@@ -566,14 +713,14 @@ bool ReferencePathSmoother::postSmooth(PathOptimizationNS::ReferencePath *refere
     const auto &QPSolution = solver.getSolution();
 
     std::vector<double> x_list, y_list, s_list;
-    const auto &ref_xs = reference_path->getXS();
-    const auto &ref_ys = reference_path->getYS();
+    const auto &ref_line = reference_path->getReferenceLine();
     double s = 0;
     for (int i = 0; i < point_num; ++i) {
         const double ref_s = layers_s_list_[i];
-        double ref_dir = getHeading(ref_xs, ref_ys, ref_s);
-        x_list.push_back(ref_xs(ref_s) + QPSolution(i) * cos(ref_dir + M_PI_2));
-        y_list.push_back(ref_ys(ref_s) + QPSolution(i) * sin(ref_dir + M_PI_2));
+        double nx, ny;
+        ref_line.getNormal(ref_s, &nx, &ny);
+        x_list.push_back(ref_line.getX(ref_s) + QPSolution(i) * nx);
+        y_list.push_back(ref_line.getY(ref_s) + QPSolution(i) * ny);
         if (i > 0) {
             s += sqrt(pow(x_list[i] - x_list[i - 1], 2) + pow(y_list[i] - y_list[i - 1], 2));
         }
@@ -582,7 +729,7 @@ bool ReferencePathSmoother::postSmooth(PathOptimizationNS::ReferencePath *refere
     tk::spline new_x_s, new_y_s;
     new_x_s.set_points(s_list, x_list);
     new_y_s.set_points(s_list, y_list);
-    reference_path->setSpline(new_x_s, new_y_s, s_list.back());
+    reference_path->setSpline(std::move(new_x_s), std::move(new_y_s), s_list.back());
 
     return true;
 }
@@ -650,11 +797,11 @@ ReferencePathSmoother::ReferencePathSmoother(const std::vector<State> &input_poi
     start_state_(start_state),
     grid_map_(grid_map) {}
 
-inline double ReferencePathSmoother::getH(const APoint &p) const {
+inline double ReferencePathSmoother::getH(double s) const {
     // Note that this h is neither admissible nor consistent, so the result is not optimal.
     // There is a smoothing stage after this, so time efficiency is much more
     // important than optimality here.
-    return (target_s_ - p.s) * 0.1;
+    return (target_s_ - s) * 0.1;
 //        return 0;
 }
 }
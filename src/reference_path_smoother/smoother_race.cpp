@@ -0,0 +1,167 @@
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <sstream>
+#include <glog/logging.h>
+#include "path_optimizer/reference_path_smoother/smoother_race.hpp"
+#include "path_optimizer/reference_path_smoother/reference_path_smoother.hpp"
+#include "path_optimizer/data_struct/reference_path.hpp"
+#include "path_optimizer/data_struct/reference_line.hpp"
+#include "path_optimizer/tools/cancellation_token.hpp"
+#include "path_optimizer/tools/thread_pool.hpp"
+#include "path_optimizer/tools/instrumentation.hpp"
+#include "path_optimizer/config/planning_flags.hpp"
+
+namespace PathOptimizationNS {
+
+namespace {
+struct Candidate {
+    std::string method;
+    std::unique_ptr<ReferencePathSmoother> smoother;
+    ReferencePath path;
+    bool ok{false};
+    // Finished before the race was decided.
+    bool in_time{false};
+    double cost{0};
+};
+
+std::vector<std::string> splitMethods(const std::string &methods) {
+    std::vector<std::string> ret;
+    std::stringstream stream(methods);
+    std::string method;
+    while (std::getline(stream, method, ',')) {
+        if (!method.empty()) ret.emplace_back(method);
+    }
+    return ret;
+}
+
+// Whether the method solves with IPOPT, whose solves are serialized by the IPOPT mutex.
+bool solvesWithIpopt(const std::string &method) {
+    if (method == "ANGLE_DIFF") return FLAGS_angle_diff_solver == "IPOPT";
+    return (method == "TENSION" || method == "TENSION2") && FLAGS_tension_solver == "IPOPT";
+}
+
+// Integral of k^2 along the path, lower is smoother.
+double squaredCurvatureIntegral(const ReferencePath &path) {
+    const auto &reference_line = path.getReferenceLine();
+    const double ds = reference_line.getResolution();
+    double cost = 0;
+    for (size_t i = 0; i != reference_line.size(); ++i) {
+        cost += pow(reference_line.getCurvature(i * ds), 2) * ds;
+    }
+    return cost;
+}
+}
+
+SmootherRace::SmootherRace(const std::vector<State> &input_points,
+                           const State &start_state,
+                           const Map &grid_map) :
+    input_points_(input_points),
+    start_state_(start_state),
+    grid_map_(grid_map) {}
+
+bool SmootherRace::solve(ReferencePath *reference_path) {
+    winner_.clear();
+    ResizableThreadPool own_thread_pool;
+    const auto thread_pool = (thread_pool_ ? thread_pool_ : &own_thread_pool)->get(
+        static_cast<std::size_t>(std::max(FLAGS_race_thread_num, 1)));
+    const bool take_first = FLAGS_race_policy == "FIRST";
+    const auto deadline = CancellationToken::Clock::now()
+        + std::chrono::microseconds(static_cast<int64_t>(FLAGS_race_deadline_ms * 1000));
+    CancellationToken token(deadline, cancellation_token_);
+
+    const auto methods = splitMethods(FLAGS_race_smoothing_methods);
+    std::vector<Candidate> candidates;
+    candidates.reserve(methods.size());
+    for (const auto &method : methods) {
+        auto smoother = ReferencePathSmoother::create(method, input_points_, start_state_, grid_map_);
+        if (!smoother) continue;
+        smoother->setCancellationToken(&token);
+        candidates.emplace_back();
+        candidates.back().method = method;
+        candidates.back().smoother = std::move(smoother);
+    }
+    if (candidates.empty()) {
+        LOG(ERROR) << "No valid smoother in race!";
+        return false;
+    }
+    const auto ipopt_num = std::count_if(candidates.begin(), candidates.end(), [](const Candidate &candidate) {
+        return solvesWithIpopt(candidate.method);
+    });
+    LOG_IF(WARNING, ipopt_num > 1) << ipopt_num << " smoothers in race solve with IPOPT, they run one at a time.";
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool decided{false};
+    size_t finished_num{0}, first_ok{candidates.size()};
+    std::vector<std::future<void>> futures;
+    futures.reserve(candidates.size());
+    for (size_t i = 0; i != candidates.size(); ++i) {
+        futures.emplace_back(thread_pool->submit([&, i] {
+            PATH_OPTIMIZER_TRACE_SPAN("race_candidate");
+            auto &candidate = candidates[i];
+            const bool ok = candidate.smoother->solve(&candidate.path);
+            const double cost = ok ? squaredCurvatureIntegral(candidate.path) : 0;
+            std::lock_guard<std::mutex> lock(mutex);
+            candidate.ok = ok;
+            candidate.cost = cost;
+            candidate.in_time = !decided;
+            if (ok && first_ok == candidates.size()) first_ok = i;
+            ++finished_num;
+            condition.notify_all();
+        }));
+    }
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        const auto is_decided = [&] {
+            return finished_num == candidates.size() || (take_first && first_ok != candidates.size());
+        };
+        if (cancellation_token_) {
+            // Nothing notifies the condition on cancellation, so poll it.
+            const auto poll_period = std::chrono::milliseconds(1);
+            while (!is_decided() && !cancellation_token_->isCancelled()
+                && CancellationToken::Clock::now() < deadline) {
+                condition.wait_until(lock, std::min(deadline, CancellationToken::Clock::now() + poll_period));
+            }
+        } else {
+            condition.wait_until(lock, deadline, is_decided);
+        }
+        decided = true;
+    }
+    token.cancel();
+    // The candidates read the caller's input and map, so wait until all of them have stopped. They
+    // stop at their next checkpoint, IPOPT iteration or OSQP time limit. Only TENSION2 with IPOPT
+    // can't be stopped within its solve, which max_cpu_time ends at the race deadline.
+    const auto stop_start = CancellationToken::Clock::now();
+    for (auto &future : futures) future.wait();
+    VLOG(1) << "Race losers stopped in " << std::chrono::duration<double, std::milli>(
+        CancellationToken::Clock::now() - stop_start).count() << " ms.";
+
+    const Candidate *winner{nullptr};
+    if (take_first) {
+        if (first_ok != candidates.size()) winner = &candidates[first_ok];
+    } else {
+        // Prefer results finished in time, fall back to late ones.
+        for (int pass = 0; pass != 2 && !winner; ++pass) {
+            for (const auto &candidate : candidates) {
+                if (!candidate.ok || (pass == 0 && !candidate.in_time)) continue;
+                if (!winner || candidate.cost < winner->cost) winner = &candidate;
+            }
+        }
+    }
+    for (const auto &candidate : candidates) {
+        LOG(INFO) << "Race smoother " << candidate.method << ": "
+                  << (candidate.ok ? "succeeded" : "failed or cancelled")
+                  << (candidate.in_time ? "" : " after the race was decided")
+                  << ", integral of k^2 " << candidate.cost;
+    }
+    if (!winner) {
+        LOG(ERROR) << "All smoothers in race failed!";
+        return false;
+    }
+    winner_ = winner->method;
+    *reference_path = winner->path;
+    return true;
+}
+
+}
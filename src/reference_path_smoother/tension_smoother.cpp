@@ -6,6 +6,7 @@
 #include "glog/logging.h"
 #include "path_optimizer/tools/Map.hpp"
 #include "path_optimizer/reference_path_smoother/tension_smoother.hpp"
+#include "path_optimizer/reference_path_smoother/frenet_smoothing_nlp.hpp"
 #include "path_optimizer/tools/tools.hpp"
 #include "path_optimizer/data_struct/reference_path.hpp"
 #include "path_optimizer/config/planning_flags.hpp"
@@ -85,7 +86,7 @@ bool TensionSmoother::smooth(PathOptimizationNS::ReferencePath *reference_path)
     y_spline.set_points(result_s_list, result_y_list);
 
     double max_s_result = result_s_list.back() + 3;
-    reference_path->setSpline(x_spline, y_spline, max_s_result);
+    reference_path->setSpline(std::move(x_spline), std::move(y_spline), max_s_result);
 
     x_list_ = std::move(result_x_list);
     y_list_ = std::move(result_y_list);
@@ -104,15 +105,9 @@ bool TensionSmoother::ipoptSmooth(const std::vector<double> &x_list,
     CHECK_EQ(x_list.size(), y_list.size());
     CHECK_EQ(y_list.size(), angle_list.size());
     CHECK_EQ(angle_list.size(), s_list.size());
-    typedef CPPAD_TESTVECTOR(double) Dvector;
     size_t n_vars = x_list.size();
-    Dvector vars(n_vars);
-    for (size_t i = 0; i < n_vars; i++) {
-        vars[i] = 0;
-    }
     // bounds of variables
-    Dvector vars_lowerbound(n_vars);
-    Dvector vars_upperbound(n_vars);
+    std::vector<double> vars_lowerbound(n_vars), vars_upperbound(n_vars);
     // Start point is the start position of the vehicle.
     vars_lowerbound[0] = 0;
     vars_upperbound[0] = 0;
@@ -133,37 +128,18 @@ bool TensionSmoother::ipoptSmooth(const std::vector<double> &x_list,
         vars_lowerbound[i] = -clearance;
         vars_upperbound[i] = clearance;
     }
-    // Set constraints.
-    // Note that the constraint number should be point_num - 2
-    // because the first and the last point is fixed.
-    size_t n_constraints = 0;
-    Dvector constraints_lowerbound(n_constraints);
-    Dvector constraints_upperbound(n_constraints);
-    // options for IPOPT solver
-    std::string options;
-    options += "Integer print_level  0\n";
-    options += "Sparse  true        forward\n";
-    options += "Sparse  true        reverse\n";
-    options += "Numeric max_cpu_time          0.05\n";
-
-    // place to return solution
-    CppAD::ipopt::solve_result<Dvector> solution;
-    // weights of the cost function
-    FgEvalReferenceSmoothing fg_eval_reference_smoothing(x_list,
-                                                         y_list,
-                                                         s_list,
-                                                         angle_list);
-    // solve the problem
-    CppAD::ipopt::solve<Dvector, FgEvalReferenceSmoothing>(options, vars,
-                                                           vars_lowerbound, vars_upperbound,
-                                                           constraints_lowerbound, constraints_upperbound,
-                                                           fg_eval_reference_smoothing, solution);
+    // The cost is quadratic, so IPOPT only needs the Hessian once.
+    auto *nlp = new TensionSmoothingNlp(x_list, y_list, angle_list, vars_lowerbound, vars_upperbound);
+    nlp->setCancellationToken(cancellation_token_);
+    Ipopt::SmartPtr<Ipopt::TNLP> nlp_holder = nlp;
+    solveFrenetOffsetNlp(nlp_holder, getMaxCpuTime(0.05), true, cancellation_token_);
     // Check if it works
-    bool ok = solution.status == CppAD::ipopt::solve_result<Dvector>::success;
+    bool ok = nlp->getStatus() == Ipopt::SUCCESS;
     if (!ok) {
         LOG(ERROR) << "Tension smoothing ipopt solver failed!";
         return false;
     }
+    const auto &solution = nlp->getSolution();
     // output
     result_s_list->clear();
     result_x_list->clear();
@@ -171,8 +147,8 @@ bool TensionSmoother::ipoptSmooth(const std::vector<double> &x_list,
     double tmp_s = 0;
     for (size_t i = 0; i != n_vars; ++i) {
         double new_angle = constraintAngle(angle_list[i] + M_PI_2);
-        double tmp_x = x_list[i] + solution.x[i] * cos(new_angle);
-        double tmp_y = y_list[i] + solution.x[i] * sin(new_angle);
+        double tmp_x = x_list[i] + solution[i] * cos(new_angle);
+        double tmp_y = y_list[i] + solution[i] * sin(new_angle);
         result_x_list->emplace_back(tmp_x);
         result_y_list->emplace_back(tmp_y);
         if (i != 0)
@@ -198,6 +174,7 @@ bool TensionSmoother::osqpSmooth(const std::vector<double> &x_list,
     OsqpEigen::Solver solver;
     solver.settings()->setVerbosity(false);
     solver.settings()->setWarmStart(true);
+    limitSolveTime(&solver);
     solver.data()->setNumberOfVariables(3 * point_num);
     solver.data()->setNumberOfConstraints(3 * point_num);
     // Allocate QP problem matrices and vectors.
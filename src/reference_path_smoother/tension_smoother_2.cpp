@@ -1,6 +1,7 @@
 //
 // Created by ljn on 20-5-4.
 //
+#include <string>
 #include <tinyspline_ros/tinysplinecpp.h>
 #include "OsqpEigen/OsqpEigen.h"
 #include "glog/logging.h"
@@ -8,6 +9,7 @@
 #include <cppad/ipopt/solve.hpp>
 #include "path_optimizer/tools/Map.hpp"
 #include "path_optimizer/reference_path_smoother/tension_smoother_2.hpp"
+#include "path_optimizer/reference_path_smoother/frenet_smoothing_nlp.hpp"
 #include "path_optimizer/tools/tools.hpp"
 #include "path_optimizer/data_struct/reference_path.hpp"
 #include "path_optimizer/config/planning_flags.hpp"
@@ -122,7 +124,7 @@ bool TensionSmoother2::ipoptSmooth(const std::vector<double> &x_list,
     options += "Integer print_level  0\n";
     options += "Sparse  true        forward\n";
     options += "Sparse  true        reverse\n";
-    options += "Numeric max_cpu_time          1\n";
+    options += "Numeric max_cpu_time          " + std::to_string(getMaxCpuTime(1)) + "\n";
 
     // place to return solution
     CppAD::ipopt::solve_result<Dvector> solution;
@@ -133,10 +135,15 @@ bool TensionSmoother2::ipoptSmooth(const std::vector<double> &x_list,
                                                   angle_list,
                                                   k_list);
     // solve the problem
-    CppAD::ipopt::solve<Dvector, FgEvalQPSmoothing>(options, vars,
-                                                    vars_lowerbound, vars_upperbound,
-                                                    constraints_lowerbound, constraints_upperbound,
-                                                    fg_eval_reference_smoothing, solution);
+    {
+        // CppAD has no way to stop IPOPT early, max_cpu_time above bounds it by the deadline.
+        std::unique_lock<std::timed_mutex> lock;
+        if (!lockIpoptMutex(&lock, cancellation_token_) || isCancelled()) return false;
+        CppAD::ipopt::solve<Dvector, FgEvalQPSmoothing>(options, vars,
+                                                        vars_lowerbound, vars_upperbound,
+                                                        constraints_lowerbound, constraints_upperbound,
+                                                        fg_eval_reference_smoothing, solution);
+    }
     // Check if it works
     bool ok = solution.status == CppAD::ipopt::solve_result<Dvector>::success;
     if (!ok) {
@@ -175,6 +182,7 @@ bool TensionSmoother2::osqpSmooth(const std::vector<double> &x_list,
     OsqpEigen::Solver solver;
     solver.settings()->setVerbosity(false);
     solver.settings()->setWarmStart(true);
+    limitSolveTime(&solver);
     solver.data()->setNumberOfVariables(4 * point_num - 1);
     solver.data()->setNumberOfConstraints(3 * (point_num - 1) + 2);
     // Allocate QP problem matrices and vectors.
@@ -8,6 +8,9 @@
 #include "path_optimizer/solver/solver_kp_as_input_constrained.hpp"
 #include "path_optimizer/data_struct/reference_path.hpp"
 #include "path_optimizer/data_struct/data_struct.hpp"
+#include "path_optimizer/data_struct/trajectory.hpp"
+#include "path_optimizer/data_struct/planning_stats.hpp"
+#include "path_optimizer/config/planning_flags.hpp"
 
 namespace PathOptimizationNS {
 
@@ -18,15 +21,31 @@ OsqpSolver::OsqpSolver(const ReferencePath &reference_path,
     reference_path_(reference_path),
     vehicle_state_(vehicle_state),
     reference_interval_(0) {
+    updateReferenceInterval();
+}
+
+void OsqpSolver::updateReferenceInterval() {
     // Check some of the reference states to get the interval.
+    reference_interval_ = 0;
     const int check_num = 10;
     for (int i = 1; i < reference_path_.getSize() && i < check_num; ++i) {
         reference_interval_ = std::max(reference_interval_,
-                                       reference_path_.getReferenceStates()[i].s
-                                           - reference_path_.getReferenceStates()[i - 1].s);
+                                       reference_path_.getReferenceStates().s(i)
+                                           - reference_path_.getReferenceStates().s(i - 1));
     }
 }
 
+void OsqpSolver::reset(size_t horizon) {
+    horizon_ = horizon;
+    updateReferenceInterval();
+    setProblemSize();
+    solver_.clearSolver();
+    solver_.data()->clearHessianMatrix();
+    solver_.data()->clearLinearConstraintsMatrix();
+    // Undo the time limit and the iteration limit of the last solve.
+    solver_.settings()->resetDefaultSettings();
+}
+
 std::unique_ptr<OsqpSolver> OsqpSolver::create(std::string &type,
                                                const PathOptimizationNS::ReferencePath &reference_path,
                                                const PathOptimizationNS::VehicleState &vehicle_state,
@@ -43,37 +62,83 @@ std::unique_ptr<OsqpSolver> OsqpSolver::create(std::string &type,
     }
 }
 
-bool OsqpSolver::solve(std::vector<PathOptimizationNS::State> *optimized_path) {
+bool OsqpSolver::solve(Trajectory *optimized_path, PlanningStats *stats) {
+    StageTimer setup_timer(stats, PlanningStats::kQpSetup);
     const auto &ref_states = reference_path_.getReferenceStates();
     solver_.settings()->setVerbosity(false);
     solver_.settings()->setWarmStart(true);
+    if (time_limit_ms_ > 0) solver_.settings()->setTimeLimit(time_limit_ms_ / 1000);
+    if (max_iteration_ > 0) solver_.settings()->setMaxIteration(max_iteration_);
+    early_stopped_ = false;
     solver_.data()->setNumberOfVariables(num_of_variables_);
     solver_.data()->setNumberOfConstraints(num_of_constraints_);
-    // Allocate QP problem matrices and vectors.
-    Eigen::SparseMatrix<double> hessian;
-    Eigen::VectorXd gradient = Eigen::VectorXd::Zero(num_of_variables_);
-    Eigen::SparseMatrix<double> linearMatrix;
-    Eigen::VectorXd lowerBound;
-    Eigen::VectorXd upperBound;
+    // QP problem matrices and vectors.
+    gradient_.setZero(num_of_variables_);
     // Set Hessian matrix.
-    setHessianMatrix(&hessian);
+    setHessianMatrix(&hessian_);
+    if (lateral_preference_weight_ > 0) {
+        // w / 2 * (e - offset)^2 without the constant term.
+        for (size_t i = 0; i != horizon_; ++i) {
+            const auto index = offsetIndex(i);
+            hessian_.coeffRef(index, index) += lateral_preference_weight_;
+            gradient_(index) = -lateral_preference_weight_ * lateral_preference_;
+        }
+    }
     // Set state transition matrix, constraint matrix and bound vector.
     setConstraintMatrix(
-        &linearMatrix,
-        &lowerBound,
-        &upperBound);
+        &linear_matrix_,
+        &lower_bound_,
+        &upper_bound_);
     // Input to solver.
-    if (!solver_.data()->setHessianMatrix(hessian)) return false;
-    if (!solver_.data()->setGradient(gradient)) return false;
-    if (!solver_.data()->setLinearConstraintsMatrix(linearMatrix)) return false;
-    if (!solver_.data()->setLowerBound(lowerBound)) return false;
-    if (!solver_.data()->setUpperBound(upperBound)) return false;
+    if (!solver_.data()->setHessianMatrix(hessian_)) return false;
+    if (!solver_.data()->setGradient(gradient_)) return false;
+    if (!solver_.data()->setLinearConstraintsMatrix(linear_matrix_)) return false;
+    if (!solver_.data()->setLowerBound(lower_bound_)) return false;
+    if (!solver_.data()->setUpperBound(upper_bound_)) return false;
     // Solve.
     if (!solver_.initSolver()) return false;
-    if (!solver_.solve()) return false;
-    const auto &QPSolution = solver_.getSolution();
-    getOptimizedPath(QPSolution, optimized_path);
+    if (warm_start_.size() == num_of_variables_ && !solver_.setPrimalVariable(warm_start_)) return false;
+    setup_timer.stop();
+    StageTimer solve_timer(stats, PlanningStats::kQpSolve);
+    bool solved = solver_.solve();
+    solve_timer.stop();
+    if (!solved && (time_limit_ms_ > 0 || max_iteration_ > 0) && solver_.workspace()) {
+        // Anytime result: the last iterate, if it's close enough to feasible.
+        const auto &info = *solver_.workspace()->info;
+        early_stopped_ = isUsableEarlyStop(info.status_val, info.pri_res, solver_.getSolution());
+        solved = early_stopped_;
+    }
+    if (stats && solver_.workspace()) {
+        stats->osqp_iterations = static_cast<int>(solver_.workspace()->info->iter);
+        stats->osqp_status = solver_.workspace()->info->status;
+        stats->qp_early_stopped = early_stopped_;
+    }
+    if (!solved) return false;
+    StageTimer output_timer(stats, PlanningStats::kOutput);
+    solution_ = solver_.getSolution();
+    getOptimizedPath(solution_, optimized_path);
     return true;
 }
 
+bool OsqpSolver::isUsableEarlyStop(int status, double primal_residual, const Eigen::VectorXd &iterate) {
+    if (status != OSQP_TIME_LIMIT_REACHED && status != OSQP_MAX_ITER_REACHED && status != OSQP_SOLVED_INACCURATE) {
+        return false;
+    }
+    return primal_residual <= FLAGS_qp_early_stop_max_primal_residual && iterate.allFinite();
+}
+
+void OsqpSolver::setLateralPreference(double offset, double weight) {
+    lateral_preference_ = offset;
+    lateral_preference_weight_ = weight;
+}
+
+void OsqpSolver::setTimeBudget(double time_limit_ms, int max_iteration) {
+    time_limit_ms_ = time_limit_ms;
+    max_iteration_ = max_iteration;
+}
+
+void OsqpSolver::setWarmStart(const Eigen::VectorXd &primal_variable) {
+    warm_start_ = primal_variable;
+}
+
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 
 #include "path_optimizer/solver/solver_k_as_input.hpp"
 #include "path_optimizer/data_struct/data_struct.hpp"
+#include "path_optimizer/data_struct/trajectory.hpp"
 #include "path_optimizer/data_struct/reference_path.hpp"
 #include "path_optimizer/data_struct/vehicle_state_frenet.hpp"
 #include "path_optimizer/tools/tools.hpp"
@@ -15,21 +16,25 @@ SolverKAsInput::SolverKAsInput(const ReferencePath &reference_path,
                                const VehicleState &vehicle_state,
                                const size_t &horizon) :
     OsqpSolver(reference_path, vehicle_state, horizon) {
+    setProblemSize();
+}
+
+void SolverKAsInput::setProblemSize() {
     num_of_variables_ = 4 * horizon_ - 1;
     num_of_constraints_ = 11 * horizon_ - 1;
 }
 
 void SolverKAsInput::getOptimizedPath(const Eigen::VectorXd &optimization_result,
-                                      std::vector<PathOptimizationNS::State> *optimized_path) const {
+                                      Trajectory *optimized_path) const {
     CHECK_EQ(optimization_result.size(), num_of_variables_);
     optimized_path->clear();
     const auto &ref_states = reference_path_.getReferenceStates();
     double tmp_s = 0;
     for (size_t i = 0; i != horizon_; ++i) {
-        double angle = ref_states[i].z;
+        double angle = ref_states.heading(i);
         double new_angle = constraintAngle(angle + M_PI_2);
-        double tmp_x = ref_states[i].x + optimization_result(2 * i + 1) * cos(new_angle);
-        double tmp_y = ref_states[i].y + optimization_result(2 * i + 1) * sin(new_angle);
+        double tmp_x = ref_states.x(i) + optimization_result(2 * i + 1) * cos(new_angle);
+        double tmp_y = ref_states.y(i) + optimization_result(2 * i + 1) * sin(new_angle);
         double k = 0;
         if (i != horizon_ - 1) {
             k = optimization_result(2 * horizon_ + i);
@@ -37,7 +42,7 @@ void SolverKAsInput::getOptimizedPath(const Eigen::VectorXd &optimization_result
             k = optimization_result(3 * horizon_ - 2);
         }
         if (i != 0) {
-            tmp_s += sqrt(pow(tmp_x - optimized_path->back().x, 2) + pow(tmp_y - optimized_path->back().y, 2));
+            tmp_s += sqrt(pow(tmp_x - optimized_path->back().x(), 2) + pow(tmp_y - optimized_path->back().y(), 2));
         }
         optimized_path->emplace_back(tmp_x, tmp_y, angle + optimization_result(2 * i), k, tmp_s);
     }
@@ -90,8 +95,8 @@ void SolverKAsInput::setDynamicMatrix(size_t i,
                                       Eigen::Matrix<double, 2, 2> *matrix_a,
                                       Eigen::Matrix<double, 2, 1> *matrix_b) const {
     const auto &ref_states = reference_path_.getReferenceStates();
-    double ref_k = ref_states[i].k;
-    double ref_s = ref_states[i + 1].s - ref_states[i].s;
+    double ref_k = ref_states.k(i);
+    double ref_s = ref_states.s(i + 1) - ref_states.s(i);
     double ref_delta = atan(ref_k * FLAGS_wheel_base);
     Eigen::Matrix2d a;
     a << 1, -ref_s * pow(ref_k, 2),
@@ -157,8 +162,8 @@ void SolverKAsInput::setConstraintMatrix(Eigen::SparseMatrix<double> *matrix_con
     lower_bound->block(0, 0, 2, 1) = -x0;
     upper_bound->block(0, 0, 2, 1) = -x0;
     for (size_t i = 0; i != horizon_ - 1; ++i) {
-        double ds = ref_states[i + 1].s - ref_states[i].s;
-        double steer = atan(ref_states[i].k * FLAGS_wheel_base);
+        double ds = ref_states.s(i + 1) - ref_states.s(i);
+        double steer = atan(ref_states.k(i) * FLAGS_wheel_base);
         Eigen::Vector2d c;
         c << ds * steer / FLAGS_wheel_base / pow(cos(steer), 2), 0;
         lower_bound->block(2 + 2 * i, 0, 2, 1) = c;
@@ -169,7 +174,7 @@ void SolverKAsInput::setConstraintMatrix(Eigen::SparseMatrix<double> *matrix_con
     upper_bound->block(2 * horizon_, 0, 2 * horizon_, 1) = Eigen::VectorXd::Constant(2 * horizon_, OsqpEigen::INFTY);
     // Add end state bounds.
     if (FLAGS_constraint_end_heading) {
-        double end_psi = constraintAngle(vehicle_state_.getEndState().z - ref_states.back().z);
+        double end_psi = constraintAngle(vehicle_state_.getEndState().z - ref_states.back().heading());
         if (end_psi < 70 * M_PI / 180) {
             (*lower_bound)(2 * horizon_ + 2 * horizon_ - 2) = end_psi - 5 * M_PI / 180;
             (*upper_bound)(2 * horizon_ + 2 * horizon_ - 2) = end_psi + 5 * M_PI / 180;
@@ -4,6 +4,7 @@
 
 #include "path_optimizer/solver/solver_kp_as_input.hpp"
 #include "path_optimizer/data_struct/data_struct.hpp"
+#include "path_optimizer/data_struct/trajectory.hpp"
 #include "path_optimizer/data_struct/reference_path.hpp"
 #include "path_optimizer/data_struct/vehicle_state_frenet.hpp"
 #include "path_optimizer/tools/tools.hpp"
@@ -13,30 +14,34 @@ namespace PathOptimizationNS {
 SolverKpAsInput::SolverKpAsInput(const ReferencePath &reference_path,
                                  const VehicleState &vehicle_state,
                                  const size_t &horizon) :
-    OsqpSolver(reference_path, vehicle_state, horizon),
-    keep_control_steps_(std::max(static_cast<int>(1.2 / reference_interval_), 1)),
-    control_horizon_((horizon_ + keep_control_steps_ - 2) / keep_control_steps_),
-    state_size_(3 * horizon_),
-    control_size_(control_horizon_),
-    slack_size_(2 * horizon_) {
+    OsqpSolver(reference_path, vehicle_state, horizon) {
+    setProblemSize();
+}
+
+void SolverKpAsInput::setProblemSize() {
+    keep_control_steps_ = std::max(static_cast<int>(1.2 / reference_interval_), 1);
+    control_horizon_ = (horizon_ + keep_control_steps_ - 2) / keep_control_steps_;
+    state_size_ = 3 * horizon_;
+    control_size_ = control_horizon_;
+    slack_size_ = 2 * horizon_;
     num_of_variables_ = state_size_ + control_size_ + slack_size_;
     num_of_constraints_ = 11 * horizon_ + control_horizon_ + 2;
 }
 
 void SolverKpAsInput::getOptimizedPath(const Eigen::VectorXd &optimization_result,
-                                       std::vector<PathOptimizationNS::State> *optimized_path) const {
+                                       Trajectory *optimized_path) const {
     CHECK_EQ(optimization_result.size(), num_of_variables_);
     optimized_path->clear();
     const auto &ref_states = reference_path_.getReferenceStates();
     double tmp_s = 0;
     for (size_t i = 0; i != horizon_; ++i) {
-        double angle = ref_states[i].z;
+        double angle = ref_states.heading(i);
         double new_angle = constraintAngle(angle + M_PI_2);
-        double tmp_x = ref_states[i].x + optimization_result(3 * i) * cos(new_angle);
-        double tmp_y = ref_states[i].y + optimization_result(3 * i) * sin(new_angle);
+        double tmp_x = ref_states.x(i) + optimization_result(3 * i) * cos(new_angle);
+        double tmp_y = ref_states.y(i) + optimization_result(3 * i) * sin(new_angle);
         double k = optimization_result(3 * i + 2);
         if (i != 0) {
-            tmp_s += sqrt(pow(tmp_x - optimized_path->back().x, 2) + pow(tmp_y - optimized_path->back().y, 2));
+            tmp_s += sqrt(pow(tmp_x - optimized_path->back().x(), 2) + pow(tmp_y - optimized_path->back().y(), 2));
         }
         optimized_path->emplace_back(tmp_x, tmp_y, angle + optimization_result(3 * i + 1), k, tmp_s);
     }
@@ -82,9 +87,9 @@ void SolverKpAsInput::setConstraintMatrix(Eigen::SparseMatrix<double> *matrix_co
     b(2, 0) = 1;
     std::vector<Eigen::MatrixXd> c_list;
     for (size_t i = 0; i != horizon_ - 1; ++i) {
-        const auto ref_k{ref_states[i].k};
-        const auto ds{ref_states[i + 1].s - ref_states[i].s};
-        const auto ref_kp{(ref_states[i + 1].k - ref_k) / ds};
+        const auto ref_k{ref_states.k(i)};
+        const auto ds{ref_states.s(i + 1) - ref_states.s(i)};
+        const auto ref_kp{(ref_states.k(i + 1) - ref_k) / ds};
         a(1, 0) = -pow(ref_k, 2);
         auto A{a * ds + Eigen::Matrix3d::Identity()};
         auto B{b * ds};
@@ -193,7 +198,7 @@ void SolverKpAsInput::setConstraintMatrix(Eigen::SparseMatrix<double> *matrix_co
     (*lower_bound)(end_state_range_begin + 1) = -OsqpEigen::INFTY;
     (*upper_bound)(end_state_range_begin + 1) = OsqpEigen::INFTY;
     if (FLAGS_constraint_end_heading) {
-        double end_psi = constraintAngle(vehicle_state_.getEndState().z - ref_states.back().z);
+        double end_psi = constraintAngle(vehicle_state_.getEndState().z - ref_states.back().heading());
         if (end_psi < 70 * M_PI / 180) {
             (*lower_bound)(end_state_range_begin + 1) = end_psi - 5 * M_PI / 180;
             (*upper_bound)(end_state_range_begin + 1) = end_psi + 5 * M_PI / 180;
@@ -16,33 +16,51 @@
 #include <opencv/cv.hpp>
 #include "glog/logging.h"
 #include <path_optimizer/path_optimizer.hpp>
+#include "path_optimizer/planning_service.hpp"
 #include "path_optimizer/tools/eigen2cv.hpp"
+#include "path_optimizer/tools/allocation_tracker.hpp"
 #include "path_optimizer/data_struct/data_struct.hpp"
+#include "path_optimizer/data_struct/lazy_trajectory.hpp"
+#include "path_optimizer/data_struct/reference_path.hpp"
+#include "path_optimizer/data_struct/reference_line.hpp"
+#include "path_optimizer/tools/tools.hpp"
+#include "path_optimizer/tools/projection_index.hpp"
+#include "path_optimizer/tools/collosion_checker.hpp"
 
-static void BM_optimizePath(benchmark::State &state) {
-    // Initialize grid map from image.
-    std::string image_dir = ros::package::getPath("path_optimizer");
-    std::string base_dir = image_dir;
-    std::string image_file = "obstacles_for_benchmark.png";
-    image_dir.append("/" + image_file);
-    cv::Mat img_src = cv::imread(image_dir, CV_8UC1);
-    double resolution = 0.2;  // in meter
-    grid_map::GridMap grid_map(std::vector<std::string>{"obstacle", "distance"});
-    grid_map::GridMapCvConverter::initializeFromImage(
-        img_src, resolution, grid_map, grid_map::Position::Zero());
-    // Add obstacle layer.
-    unsigned char OCCUPY = 0;
-    unsigned char FREE = 255;
-    grid_map::GridMapCvConverter::addLayerFromImage<unsigned char, 1>(
-        img_src, "obstacle", grid_map, OCCUPY, FREE, 0.5);
-    // Update distance layer.
-    Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic> binary =
-        grid_map.get("obstacle").cast<unsigned char>();
-    cv::distanceTransform(eigen2cv(binary), eigen2cv(grid_map.get("distance")),
-                          CV_DIST_L2, CV_DIST_MASK_PRECISE);
-    grid_map.get("distance") *= resolution;
-    grid_map.setFrameId("/map");
+// Map shared by all benchmarks.
+static const grid_map::GridMap &benchmarkMap() {
+    static const grid_map::GridMap grid_map = [] {
+        // Initialize grid map from image.
+        std::string image_dir = ros::package::getPath("path_optimizer");
+        std::string base_dir = image_dir;
+        std::string image_file = "obstacles_for_benchmark.png";
+        image_dir.append("/" + image_file);
+        cv::Mat img_src = cv::imread(image_dir, CV_8UC1);
+        double resolution = 0.2;  // in meter
+        grid_map::GridMap grid_map(std::vector<std::string>{"obstacle", "distance"});
+        grid_map::GridMapCvConverter::initializeFromImage(
+            img_src, resolution, grid_map, grid_map::Position::Zero());
+        // Add obstacle layer.
+        unsigned char OCCUPY = 0;
+        unsigned char FREE = 255;
+        grid_map::GridMapCvConverter::addLayerFromImage<unsigned char, 1>(
+            img_src, "obstacle", grid_map, OCCUPY, FREE, 0.5);
+        // Update distance layer.
+        Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic> binary =
+            grid_map.get("obstacle").cast<unsigned char>();
+        cv::distanceTransform(eigen2cv(binary), eigen2cv(grid_map.get("distance")),
+                              CV_DIST_L2, CV_DIST_MASK_PRECISE);
+        grid_map.get("distance") *= resolution;
+        grid_map.setFrameId("/map");
+        return grid_map;
+    }();
+    return grid_map;
+}
 
+// Reference points, start state and goal state shared by all benchmarks.
+static void benchmarkInput(std::vector<PathOptimizationNS::State> *points,
+                           PathOptimizationNS::State *start_state,
+                           PathOptimizationNS::State *goal_state) {
     // Input reference path.
     std::vector<double> x_list_ =
         {36.933, 35.664, 34.5232, 33.5006, 32.5863, 31.7711, 31.0461, 30.4029, 29.8334, 29.33, 28.8857, 28.4938,
@@ -64,22 +82,27 @@ static void BM_optimizePath(benchmark::State &state) {
          0.845838, 0.684314, 0.522481, 0.360532, 0.198675, 0.0371402, -0.123809, -0.283872, -0.442713, -0.599958,
          -0.755201, -0.907996, -1.05786, -1.20428, -1.3467, -1.48454, -1.61716, -1.7439, -1.86408, -1.97694,
          -2.08173, -2.17764, -2.26383, -2.33941, -2.40347, -2.45507, -2.49321, -2.51688, -2.52501};
-    std::vector<PathOptimizationNS::State> points, final_path;
     for (size_t i = 0; i != x_list_.size(); ++i) {
         PathOptimizationNS::State state;
         state.x = x_list_[i];
         state.y = y_list_[i];
-        points.push_back(state);
+        points->push_back(state);
     }
+    start_state->x = 36.933;
+    start_state->y = 33.6609;
+    start_state->z = -1.36375;
+    start_state->k = 0;
+    goal_state->x = 21.4611;
+    goal_state->y = -2.52501;
+    goal_state->z = -1.30825;
+    goal_state->k = 0;
+}
+
+static void BM_optimizePath(benchmark::State &state) {
+    std::vector<PathOptimizationNS::State> points, final_path;
     PathOptimizationNS::State start_state, goal_state;
-    start_state.x = 36.933;
-    start_state.y = 33.6609;
-    start_state.z = -1.36375;
-    start_state.k = 0;
-    goal_state.x = 21.4611;
-    goal_state.y = -2.52501;
-    goal_state.z = -1.30825;
-    goal_state.k = 0;
+    benchmarkInput(&points, &start_state, &goal_state);
+    const auto &grid_map = benchmarkMap();
     for (auto _:state) {
         FLAGS_enable_computation_time_output = false;
         PathOptimizationNS::PathOptimizer path_optimizer(start_state, goal_state, grid_map);
@@ -89,68 +112,11 @@ static void BM_optimizePath(benchmark::State &state) {
 BENCHMARK(BM_optimizePath)->Unit(benchmark::kMillisecond);
 
 static void BM_optimizePathWithoutSmoothing(benchmark::State &state) {
-    // Initialize grid map from image.
-    std::string image_dir = ros::package::getPath("path_optimizer");
-    std::string base_dir = image_dir;
-    std::string image_file = "obstacles_for_benchmark.png";
-    image_dir.append("/" + image_file);
-    cv::Mat img_src = cv::imread(image_dir, CV_8UC1);
-    double resolution = 0.2;  // in meter
-    grid_map::GridMap grid_map(std::vector<std::string>{"obstacle", "distance"});
-    grid_map::GridMapCvConverter::initializeFromImage(
-        img_src, resolution, grid_map, grid_map::Position::Zero());
-    // Add obstacle layer.
-    unsigned char OCCUPY = 0;
-    unsigned char FREE = 255;
-    grid_map::GridMapCvConverter::addLayerFromImage<unsigned char, 1>(
-        img_src, "obstacle", grid_map, OCCUPY, FREE, 0.5);
-    // Update distance layer.
-    Eigen::Matrix<unsigned char, Eigen::Dynamic, Eigen::Dynamic> binary =
-        grid_map.get("obstacle").cast<unsigned char>();
-    cv::distanceTransform(eigen2cv(binary), eigen2cv(grid_map.get("distance")),
-                          CV_DIST_L2, CV_DIST_MASK_PRECISE);
-    grid_map.get("distance") *= resolution;
-    grid_map.setFrameId("/map");
-
-    // Input reference path.
-    std::vector<double> x_list_ =
-        {36.933, 35.664, 34.5232, 33.5006, 32.5863, 31.7711, 31.0461, 30.4029, 29.8334, 29.33, 28.8857, 28.4938,
-         28.1478, 27.8421, 27.5711, 27.3299, 27.1139, 26.919, 26.7415, 26.5781, 26.4261, 26.283, 26.1468, 26.016,
-         25.8895, 25.7666, 25.6471, 25.5308, 25.4176, 25.3073, 25.1998, 25.0951, 24.9929, 24.8933, 24.7961, 24.7011,
-         24.6084, 24.5178, 24.4292, 24.3425, 24.2578, 24.1748, 24.0936, 24.0141, 23.9361, 23.8597, 23.7848, 23.7114,
-         23.6394, 23.5687, 23.4994, 23.4314, 23.3647, 23.2992, 23.235, 23.172, 23.1101, 23.0493, 22.9897, 22.9312,
-         22.8738, 22.8174, 22.762, 22.7076, 22.6542, 22.6018, 22.5504, 22.4998, 22.4502, 22.4015, 22.3536, 22.3066,
-         22.2605, 22.2151, 22.1707, 22.127, 22.0841, 22.042, 22.0007, 21.9603, 21.9208, 21.8821, 21.8445, 21.8079,
-         21.7724, 21.7381, 21.7051, 21.6736, 21.6436, 21.6153, 21.5888, 21.5642, 21.5418, 21.5217, 21.5042, 21.4893,
-         21.4773, 21.4685, 21.463, 21.4611};
-    std::vector<double> y_list_ =
-        {33.6609, 30.1924, 27.1101, 24.3825, 21.9795, 19.8724, 18.0336, 16.437, 15.0581, 13.8733, 12.8606, 11.9994,
-         11.2702, 10.6552, 10.1376, 9.70216, 9.3349, 9.02324, 8.7559, 8.52298, 8.31592, 8.1275, 7.95186, 7.78447,
-         7.62217, 7.46313, 7.30673, 7.15283, 7.00127, 6.85193, 6.70466, 6.55933, 6.41578, 6.27389, 6.13352, 5.99451,
-         5.85674, 5.72006, 5.58434, 5.44943, 5.31518, 5.18147, 5.04815, 4.91508, 4.78211, 4.64912, 4.51595, 4.38246,
-         4.24852, 4.11398, 3.9787, 3.84254, 3.70538, 3.5671, 3.4276, 3.28681, 3.14465, 3.00106, 2.85602, 2.70948,
-         2.56145, 2.41193, 2.26093, 2.10849, 1.95465, 1.79949, 1.64306, 1.48548, 1.32684, 1.16726, 1.00687,
-         0.845838, 0.684314, 0.522481, 0.360532, 0.198675, 0.0371402, -0.123809, -0.283872, -0.442713, -0.599958,
-         -0.755201, -0.907996, -1.05786, -1.20428, -1.3467, -1.48454, -1.61716, -1.7439, -1.86408, -1.97694,
-         -2.08173, -2.17764, -2.26383, -2.33941, -2.40347, -2.45507, -2.49321, -2.51688, -2.52501};
     std::vector<PathOptimizationNS::State> points, optimized_path, final_path;
-    for (size_t i = 0; i != x_list_.size(); ++i) {
-        PathOptimizationNS::State state;
-        state.x = x_list_[i];
-        state.y = y_list_[i];
-        points.push_back(state);
-    }
     PathOptimizationNS::State start_state, goal_state;
-    start_state.x = 36.933;
-    start_state.y = 33.6609;
-    start_state.z = -1.36375;
-    start_state.k = 0;
-    goal_state.x = 21.4611;
-    goal_state.y = -2.52501;
-    goal_state.z = -1.30825;
-    goal_state.k = 0;
+    benchmarkInput(&points, &start_state, &goal_state);
 
-    PathOptimizationNS::PathOptimizer path_optimizer(start_state, goal_state, grid_map);
+    PathOptimizationNS::PathOptimizer path_optimizer(start_state, goal_state, benchmarkMap());
     path_optimizer.solve(points, &optimized_path);
     for (auto _:state) {
         FLAGS_enable_computation_time_output = false;
@@ -159,4 +125,370 @@ static void BM_optimizePathWithoutSmoothing(benchmark::State &state) {
 }
 BENCHMARK(BM_optimizePathWithoutSmoothing)->Unit(benchmark::kMillisecond);
 
+// Most operator new calls a steady state solve may make. What's left is mostly local vectors of
+// the smoothers and the search, Eigen and OSQP use malloc and aren't counted.
+static const double kMaxSteadyStateAllocations = 1000;
+
+// Full planning with one optimizer kept across solves, rebound to the start and goal each time as
+// a planner running in a loop would. With allocation tracking, reports the heap allocations left
+// per solve once the buffers have grown, and fails above kMaxSteadyStateAllocations.
+static void BM_steadyStateSolve(benchmark::State &state) {
+    std::vector<PathOptimizationNS::State> points, final_path;
+    PathOptimizationNS::State start_state, goal_state;
+    benchmarkInput(&points, &start_state, &goal_state);
+    const auto &grid_map = benchmarkMap();
+    FLAGS_enable_computation_time_output = false;
+    PathOptimizationNS::PathOptimizer path_optimizer(start_state, goal_state, grid_map);
+    // Warm up.
+    for (int i = 0; i != 3; ++i) path_optimizer.solve(points, &final_path);
+#ifdef PATH_OPTIMIZER_ENABLE_ALLOCATION_TRACKING
+    const auto start_count = PathOptimizationNS::allocation_tracker::getTotalCount();
+#endif
+    for (auto _:state) {
+        path_optimizer.setMap(grid_map);
+        path_optimizer.setStartState(start_state);
+        path_optimizer.setEndState(goal_state);
+        path_optimizer.solve(points, &final_path);
+    }
+#ifdef PATH_OPTIMIZER_ENABLE_ALLOCATION_TRACKING
+    const auto end_count = PathOptimizationNS::allocation_tracker::getTotalCount();
+    state.counters["allocations"] =
+        benchmark::Counter(end_count.calls - start_count.calls, benchmark::Counter::kAvgIterations);
+    state.counters["allocated_bytes"] =
+        benchmark::Counter(end_count.bytes - start_count.bytes, benchmark::Counter::kAvgIterations);
+    const double allocations_per_solve =
+        static_cast<double>(end_count.calls - start_count.calls) / std::max<int64_t>(state.iterations(), 1);
+    if (allocations_per_solve > kMaxSteadyStateAllocations) {
+        state.SkipWithError("Too many allocations per steady state solve.");
+    }
+#endif
+}
+BENCHMARK(BM_steadyStateSolve)->Unit(benchmark::kMillisecond);
+
+// Full planning with the densified and checked output, or with the lazy output checked for the
+// first 10m only, as a consumer that only follows the beginning of the path would.
+static void BM_outputMode(benchmark::State &state, bool lazy) {
+    std::vector<PathOptimizationNS::State> points, final_path;
+    PathOptimizationNS::State start_state, goal_state;
+    benchmarkInput(&points, &start_state, &goal_state);
+    const auto &grid_map = benchmarkMap();
+    PathOptimizationNS::LazyTrajectory trajectory;
+    PathOptimizationNS::CollisionChecker collision_checker(grid_map);
+    for (auto _:state) {
+        FLAGS_enable_computation_time_output = false;
+        PathOptimizationNS::PathOptimizer path_optimizer(start_state, goal_state, grid_map);
+        if (lazy) {
+            if (path_optimizer.solve(points, &trajectory)) {
+                benchmark::DoNotOptimize(trajectory.checkCollision(&collision_checker, 0, 10, FLAGS_output_spacing));
+            }
+        } else {
+            path_optimizer.solve(points, &final_path);
+        }
+    }
+}
+BENCHMARK_CAPTURE(BM_outputMode, DENSE, false)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_outputMode, LAZY, true)->Unit(benchmark::kMillisecond);
+
+// Full planning with the tension smoother, comparing its IPOPT and OSQP solvers.
+static void BM_tensionSmoother(benchmark::State &state, const std::string &solver) {
+    std::vector<PathOptimizationNS::State> points, final_path;
+    PathOptimizationNS::State start_state, goal_state;
+    benchmarkInput(&points, &start_state, &goal_state);
+    const auto &grid_map = benchmarkMap();
+    const auto smoothing_method = FLAGS_smoothing_method;
+    const auto tension_solver = FLAGS_tension_solver;
+    FLAGS_smoothing_method = "TENSION";
+    FLAGS_tension_solver = solver;
+    for (auto _:state) {
+        FLAGS_enable_computation_time_output = false;
+        PathOptimizationNS::PathOptimizer path_optimizer(start_state, goal_state, grid_map);
+        path_optimizer.solve(points, &final_path);
+    }
+    FLAGS_smoothing_method = smoothing_method;
+    FLAGS_tension_solver = tension_solver;
+}
+BENCHMARK_CAPTURE(BM_tensionSmoother, IPOPT, std::string("IPOPT"))->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_tensionSmoother, OSQP, std::string("OSQP"))->Unit(benchmark::kMillisecond);
+
+// Distance of the smoothed reference of a planner from that of another one, every 0.5 m.
+static void referenceDeviation(const PathOptimizationNS::PathOptimizer &path_optimizer,
+                               const PathOptimizationNS::PathOptimizer &baseline_optimizer,
+                               double *max_deviation,
+                               double *mean_deviation) {
+    const auto &baseline_line = baseline_optimizer.getReferencePath().getReferenceLine();
+    const auto &line = path_optimizer.getReferencePath().getReferenceLine();
+    PathOptimizationNS::ProjectionIndex baseline_index;
+    baseline_index.build(baseline_line);
+    double deviation_sum = 0, hint_s = -1;
+    int sample_num = 0;
+    *max_deviation = 0;
+    for (double s = 0; s <= line.getLength(); s += 0.5, ++sample_num) {
+        const auto closest = baseline_index.getProjection(line.getX(s), line.getY(s), hint_s);
+        hint_s = closest.s;
+        const double deviation = PathOptimizationNS::distance(closest, {line.getX(s), line.getY(s)});
+        *max_deviation = std::max(*max_deviation, deviation);
+        deviation_sum += deviation;
+    }
+    *mean_deviation = sample_num ? deviation_sum / sample_num : 0;
+}
+
+// Full planning with the angle diff smoother, comparing IPOPT with the SQP on OSQP. The counters
+// give the distance of the smoothed reference from the IPOPT one, every 0.5 m.
+static void BM_angleDiffSmoother(benchmark::State &state, const std::string &solver) {
+    std::vector<PathOptimizationNS::State> points, final_path;
+    PathOptimizationNS::State start_state, goal_state;
+    benchmarkInput(&points, &start_state, &goal_state);
+    const auto &grid_map = benchmarkMap();
+    const auto smoothing_method = FLAGS_smoothing_method;
+    const auto angle_diff_solver = FLAGS_angle_diff_solver;
+    FLAGS_smoothing_method = "ANGLE_DIFF";
+    FLAGS_enable_computation_time_output = false;
+    FLAGS_angle_diff_solver = "IPOPT";
+    PathOptimizationNS::PathOptimizer ipopt_optimizer(start_state, goal_state, grid_map);
+    ipopt_optimizer.solve(points, &final_path);
+    FLAGS_angle_diff_solver = solver;
+    PathOptimizationNS::PathOptimizer path_optimizer(start_state, goal_state, grid_map);
+    for (auto _:state) {
+        path_optimizer.solve(points, &final_path);
+    }
+    double max_deviation, mean_deviation;
+    referenceDeviation(path_optimizer, ipopt_optimizer, &max_deviation, &mean_deviation);
+    state.counters["max_deviation_from_ipopt"] = max_deviation;
+    state.counters["mean_deviation_from_ipopt"] = mean_deviation;
+    FLAGS_smoothing_method = smoothing_method;
+    FLAGS_angle_diff_solver = angle_diff_solver;
+}
+BENCHMARK_CAPTURE(BM_angleDiffSmoother, IPOPT, std::string("IPOPT"))->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_angleDiffSmoother, OSQP, std::string("OSQP"))->Unit(benchmark::kMillisecond);
+
+// Full planning with the RACE smoothing method under each policy.
+static void BM_raceSmoother(benchmark::State &state, const std::string &policy) {
+    std::vector<PathOptimizationNS::State> points, final_path;
+    PathOptimizationNS::State start_state, goal_state;
+    benchmarkInput(&points, &start_state, &goal_state);
+    const auto &grid_map = benchmarkMap();
+    const auto smoothing_method = FLAGS_smoothing_method;
+    const auto race_policy = FLAGS_race_policy;
+    FLAGS_smoothing_method = "RACE";
+    FLAGS_race_policy = policy;
+    for (auto _:state) {
+        FLAGS_enable_computation_time_output = false;
+        PathOptimizationNS::PathOptimizer path_optimizer(start_state, goal_state, grid_map);
+        path_optimizer.solve(points, &final_path);
+    }
+    FLAGS_smoothing_method = smoothing_method;
+    FLAGS_race_policy = race_policy;
+}
+BENCHMARK_CAPTURE(BM_raceSmoother, FIRST, std::string("FIRST"))->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_raceSmoother, BEST, std::string("BEST"))->Unit(benchmark::kMillisecond);
+
+// Planning on a route extended by 30 points after planning on its first 70 points, timing only
+// the second call, with and without incremental smoothing.
+static void BM_extendedRoute(benchmark::State &state, bool incremental) {
+    std::vector<PathOptimizationNS::State> points, final_path;
+    PathOptimizationNS::State start_state, goal_state;
+    benchmarkInput(&points, &start_state, &goal_state);
+    const std::vector<PathOptimizationNS::State> prefix(points.begin(), points.begin() + 70);
+    const auto &grid_map = benchmarkMap();
+    const auto enable_incremental_smoothing = FLAGS_enable_incremental_smoothing;
+    FLAGS_enable_incremental_smoothing = incremental;
+    for (auto _:state) {
+        FLAGS_enable_computation_time_output = false;
+        state.PauseTiming();
+        PathOptimizationNS::PathOptimizer path_optimizer(start_state, goal_state, grid_map);
+        path_optimizer.solve(prefix, &final_path);
+        state.ResumeTiming();
+        path_optimizer.solve(points, &final_path);
+    }
+    FLAGS_enable_incremental_smoothing = enable_incremental_smoothing;
+}
+BENCHMARK_CAPTURE(BM_extendedRoute, FULL, false)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_extendedRoute, INCREMENTAL, true)->Unit(benchmark::kMillisecond);
+
+// Full planning with each graph search on the smoothed reference.
+static void BM_graphSearch(benchmark::State &state, const std::string &method) {
+    std::vector<PathOptimizationNS::State> points, final_path;
+    PathOptimizationNS::State start_state, goal_state;
+    benchmarkInput(&points, &start_state, &goal_state);
+    const auto &grid_map = benchmarkMap();
+    const auto search_method = FLAGS_search_method;
+    FLAGS_search_method = method;
+    for (auto _:state) {
+        FLAGS_enable_computation_time_output = false;
+        PathOptimizationNS::PathOptimizer path_optimizer(start_state, goal_state, grid_map);
+        path_optimizer.solve(points, &final_path);
+    }
+    FLAGS_search_method = search_method;
+}
+BENCHMARK_CAPTURE(BM_graphSearch, DP, std::string("DP"))->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_graphSearch, A_STAR, std::string("A_STAR"))->Unit(benchmark::kMillisecond);
+
+// Full planning with the DP search on the whole lattice or coarse to fine. The counters give the
+// distance of the smoothed reference from the one with the search on the whole lattice, which is 0
+// when both searches find the same path.
+static void BM_coarseToFineSearch(benchmark::State &state, bool coarse_to_fine) {
+    std::vector<PathOptimizationNS::State> points, final_path;
+    PathOptimizationNS::State start_state, goal_state;
+    benchmarkInput(&points, &start_state, &goal_state);
+    const auto &grid_map = benchmarkMap();
+    const auto search_method = FLAGS_search_method;
+    const auto enable_coarse_to_fine_search = FLAGS_enable_coarse_to_fine_search;
+    FLAGS_search_method = "DP";
+    FLAGS_enable_computation_time_output = false;
+    FLAGS_enable_coarse_to_fine_search = false;
+    PathOptimizationNS::PathOptimizer full_optimizer(start_state, goal_state, grid_map);
+    full_optimizer.solve(points, &final_path);
+    FLAGS_enable_coarse_to_fine_search = coarse_to_fine;
+    PathOptimizationNS::PathOptimizer path_optimizer(start_state, goal_state, grid_map);
+    for (auto _:state) {
+        path_optimizer.solve(points, &final_path);
+    }
+    double max_deviation, mean_deviation;
+    referenceDeviation(path_optimizer, full_optimizer, &max_deviation, &mean_deviation);
+    state.counters["max_deviation_from_full"] = max_deviation;
+    state.counters["mean_deviation_from_full"] = mean_deviation;
+    FLAGS_search_method = search_method;
+    FLAGS_enable_coarse_to_fine_search = enable_coarse_to_fine_search;
+}
+BENCHMARK_CAPTURE(BM_coarseToFineSearch, FULL, false)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_coarseToFineSearch, COARSE_TO_FINE, true)->Unit(benchmark::kMillisecond);
+
+// Heap allocations per full planning, in total and per stage of the planning thread. Needs a
+// build with PATH_OPTIMIZER_ENABLE_ALLOCATION_TRACKING.
+static void BM_allocationsPerSolve(benchmark::State &state) {
+#ifdef PATH_OPTIMIZER_ENABLE_ALLOCATION_TRACKING
+    using PathOptimizationNS::PlanningStats;
+    namespace allocation_tracker = PathOptimizationNS::allocation_tracker;
+    std::vector<PathOptimizationNS::State> points, final_path;
+    PathOptimizationNS::State start_state, goal_state;
+    benchmarkInput(&points, &start_state, &goal_state);
+    const auto &grid_map = benchmarkMap();
+    std::array<double, PlanningStats::kStageNum> stage_allocations{};
+    const auto start_count = allocation_tracker::getTotalCount();
+    for (auto _:state) {
+        FLAGS_enable_computation_time_output = false;
+        PathOptimizationNS::PathOptimizer path_optimizer(start_state, goal_state, grid_map);
+        PlanningStats stats;
+        path_optimizer.solve(points, &final_path, &stats);
+        for (int i = 0; i != PlanningStats::kStageNum; ++i) stage_allocations[i] += stats.stage_allocations[i];
+    }
+    const auto end_count = allocation_tracker::getTotalCount();
+    state.counters["allocations"] =
+        benchmark::Counter(end_count.calls - start_count.calls, benchmark::Counter::kAvgIterations);
+    state.counters["allocated_bytes"] =
+        benchmark::Counter(end_count.bytes - start_count.bytes, benchmark::Counter::kAvgIterations);
+    for (int i = 0; i != PlanningStats::kStageNum; ++i) {
+        state.counters[PlanningStats::stageName(static_cast<PlanningStats::Stage>(i))] =
+            benchmark::Counter(stage_allocations[i], benchmark::Counter::kAvgIterations);
+    }
+#else
+    state.SkipWithError("Built without PATH_OPTIMIZER_ENABLE_ALLOCATION_TRACKING.");
+    for (auto _:state) {}
+#endif
+}
+BENCHMARK(BM_allocationsPerSolve)->Unit(benchmark::kMillisecond);
+
+// Three paths from three full solves, or three candidates with different lateral preferences
+// from one solveCandidates call sharing the smoothing and the bounds.
+static void BM_candidates(benchmark::State &state, bool shared) {
+    std::vector<PathOptimizationNS::State> points, final_path;
+    PathOptimizationNS::State start_state, goal_state;
+    benchmarkInput(&points, &start_state, &goal_state);
+    const auto &grid_map = benchmarkMap();
+    std::vector<PathOptimizationNS::PathCandidate> candidates(3);
+    candidates[1].lateral_offset = 1;
+    candidates[2].lateral_offset = -1;
+    std::vector<std::vector<PathOptimizationNS::State>> paths;
+    for (auto _:state) {
+        FLAGS_enable_computation_time_output = false;
+        PathOptimizationNS::PathOptimizer path_optimizer(start_state, goal_state, grid_map);
+        if (shared) {
+            path_optimizer.solveCandidates(points, candidates, &paths);
+        } else {
+            for (size_t i = 0; i != candidates.size(); ++i) path_optimizer.solve(points, &final_path);
+        }
+    }
+}
+BENCHMARK_CAPTURE(BM_candidates, SEPARATE, false)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_candidates, SHARED, true)->Unit(benchmark::kMillisecond);
+
+// Repeated planning on an unchanged input with one optimizer, with the result cache disabled, or
+// with a new goal each time so only the smoothing is cached, or with the whole input unchanged.
+static void BM_resultCache(benchmark::State &state, const std::string &mode) {
+    std::vector<PathOptimizationNS::State> points, final_path;
+    PathOptimizationNS::State start_state, goal_state;
+    benchmarkInput(&points, &start_state, &goal_state);
+    const auto result_cache_capacity = FLAGS_result_cache_capacity;
+    FLAGS_result_cache_capacity = mode == "DISABLED" ? 0 : 8;
+    FLAGS_enable_computation_time_output = false;
+    PathOptimizationNS::PathOptimizer path_optimizer(start_state, goal_state, benchmarkMap());
+    path_optimizer.solve(points, &final_path);
+    int i = 0;
+    for (auto _:state) {
+        if (mode == "REFERENCE") {
+            // Goal headings apart by more than the cache resolution, never within the last 8.
+            auto goal = goal_state;
+            goal.z += (++i % 100) * 0.002;
+            path_optimizer.setEndState(goal);
+        }
+        path_optimizer.solve(points, &final_path);
+    }
+    FLAGS_result_cache_capacity = result_cache_capacity;
+}
+BENCHMARK_CAPTURE(BM_resultCache, DISABLED, std::string("DISABLED"))->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_resultCache, REFERENCE, std::string("REFERENCE"))->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_resultCache, PATH, std::string("PATH"))->Unit(benchmark::kMillisecond);
+
+// A request superseded right after it was submitted, until the newer one is planned: the stale one
+// is cancelled by the service, or planned to the end before the newer one as with synchronous calls.
+static void BM_supersededRequest(benchmark::State &state, bool service) {
+    PathOptimizationNS::PlanningRequest request;
+    benchmarkInput(&request.reference_points, &request.start_state, &request.end_state);
+    // The benchmark map lives until exit.
+    request.map.reset(&benchmarkMap(), [](const grid_map::GridMap *) {});
+    FLAGS_enable_computation_time_output = false;
+    PathOptimizationNS::PlanningService planning_service(nullptr);
+    PathOptimizationNS::PathOptimizer path_optimizer(request.start_state, request.end_state, *request.map);
+    std::vector<PathOptimizationNS::State> final_path;
+    for (auto _:state) {
+        if (service) {
+            planning_service.submit(request);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            planning_service.submit(request);
+            planning_service.waitUntilIdle();
+        } else {
+            path_optimizer.solve(request.reference_points, &final_path);
+            path_optimizer.solve(request.reference_points, &final_path);
+        }
+    }
+}
+BENCHMARK_CAPTURE(BM_supersededRequest, SYNC, false)->Unit(benchmark::kMillisecond)->UseRealTime();
+BENCHMARK_CAPTURE(BM_supersededRequest, SERVICE, true)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// Full planning under a latency budget in ms, none with 0, with the share of solves that succeeded,
+// ran out of the budget or output an early stopped QP iterate.
+static void BM_latencyBudget(benchmark::State &state) {
+    using PathOptimizationNS::PlanningStats;
+    std::vector<PathOptimizationNS::State> points, final_path;
+    PathOptimizationNS::State start_state, goal_state;
+    benchmarkInput(&points, &start_state, &goal_state);
+    FLAGS_enable_computation_time_output = false;
+    PathOptimizationNS::PathOptimizer path_optimizer(start_state, goal_state, benchmarkMap());
+    // The first solve measures the QP iteration time the iteration limit is estimated from.
+    path_optimizer.solve(points, &final_path);
+    path_optimizer.setLatencyBudget(state.range(0));
+    double successes = 0, deadlines_exceeded = 0, qp_early_stops = 0;
+    for (auto _:state) {
+        PlanningStats stats;
+        path_optimizer.solve(points, &final_path, &stats);
+        successes += stats.success;
+        deadlines_exceeded += stats.deadline_exceeded;
+        qp_early_stops += stats.qp_early_stopped;
+    }
+    state.counters["success"] = benchmark::Counter(successes, benchmark::Counter::kAvgIterations);
+    state.counters["deadline_exceeded"] = benchmark::Counter(deadlines_exceeded, benchmark::Counter::kAvgIterations);
+    state.counters["qp_early_stopped"] = benchmark::Counter(qp_early_stops, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_latencyBudget)->Arg(0)->Arg(50)->Arg(20)->Arg(5)->Unit(benchmark::kMillisecond)->UseRealTime();
+
 BENCHMARK_MAIN();
\ No newline at end of file
@@ -1,4 +1,498 @@
 //
 // Created by ljn on 20-4-9.
 //
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+#include <gflags/gflags.h>
+#include <gtest/gtest.h>
+#include <grid_map_core/grid_map_core.hpp>
+#include "path_optimizer/config/planning_flags.hpp"
+#include "path_optimizer/data_struct/data_struct.hpp"
+#include "path_optimizer/data_struct/reference_line.hpp"
+#include "path_optimizer/data_struct/reference_path.hpp"
+#include "path_optimizer/reference_path_smoother/angle_diff_smoother.hpp"
+#include "path_optimizer/reference_path_smoother/frenet_smoothing_nlp.hpp"
+#include "path_optimizer/reference_path_smoother/incremental_smoother.hpp"
+#include "path_optimizer/solver/solver.hpp"
+#include "path_optimizer/tools/clearance_raster.hpp"
+#include "path_optimizer/tools/collosion_checker.hpp"
+#include "path_optimizer/tools/Map.hpp"
+#include "path_optimizer/tools/projection_index.hpp"
+#include "path_optimizer/tools/result_cache.hpp"
+#include "path_optimizer/tools/spline.h"
 
+namespace {
+using PathOptimizationNS::State;
+
+// 40 m x 40 m with single-cell obstacles, the distance layer holding the exact distance from
+// each cell center to the closest one.
+grid_map::GridMap obstacleMap(const std::vector<grid_map::Position> &obstacles) {
+    grid_map::GridMap map({"distance"});
+    map.setGeometry(grid_map::Length(40, 40), 0.1, grid_map::Position(0, 0));
+    for (grid_map::GridMapIterator it(map); !it.isPastEnd(); ++it) {
+        grid_map::Position position;
+        map.getPosition(*it, position);
+        double min_distance = 100;
+        for (const auto &obstacle : obstacles) min_distance = std::min(min_distance, (position - obstacle).norm());
+        map.at("distance", *it) = static_cast<float>(min_distance);
+    }
+    return map;
+}
+
+// Rear axle state after moving length along an arc of curvature k.
+State moveAlongArc(const State &from, double k, double length) {
+    if (std::fabs(k) < 1e-9) {
+        return State(from.x + length * cos(from.z), from.y + length * sin(from.z), from.z, 0);
+    }
+    const double heading = from.z + k * length;
+    return State(from.x + (sin(heading) - sin(from.z)) / k,
+                 from.y - (cos(heading) - cos(from.z)) / k,
+                 heading,
+                 k);
+}
+
+// Every 1 cm along the arc, both ends included, with the check used without continuous checking.
+bool isDenselyCollisionFree(PathOptimizationNS::CollisionChecker *checker, const State &from, double k, double length) {
+    const int sample_num = static_cast<int>(std::ceil(length / 0.01));
+    for (int i = 0; i <= sample_num; ++i) {
+        if (!checker->isSingleStateCollisionFreeImproved(moveAlongArc(from, k, length * i / sample_num))) return false;
+    }
+    return true;
+}
+
+// The same along a clothoid whose curvature changes linearly from from_k to to_k, integrated in
+// 1 mm steps. Returns the end state in to if it's not null.
+bool isDenselyCollisionFree(PathOptimizationNS::CollisionChecker *checker,
+                            const State &from,
+                            double from_k,
+                            double to_k,
+                            double length,
+                            State *to = nullptr) {
+    const int sample_num = static_cast<int>(std::ceil(length / 0.01));
+    const int steps_per_sample = 10;
+    const double ds = length / (sample_num * steps_per_sample);
+    State state(from.x, from.y, from.z, from_k);
+    bool is_free = checker == nullptr || checker->isSingleStateCollisionFreeImproved(state);
+    for (int i = 0; i != sample_num * steps_per_sample; ++i) {
+        const double s = (i + 0.5) * ds;
+        const double heading = from.z + from_k * s + (to_k - from_k) * s * s / (2 * length);
+        state.x += ds * cos(heading);
+        state.y += ds * sin(heading);
+        const double end_s = (i + 1) * ds;
+        state.z = from.z + from_k * end_s + (to_k - from_k) * end_s * end_s / (2 * length);
+        state.k = from_k + (to_k - from_k) * end_s / length;
+        if (checker && (i + 1) % steps_per_sample == 0 && !checker->isSingleStateCollisionFreeImproved(state)) {
+            is_free = false;
+        }
+    }
+    if (to) *to = state;
+    return is_free;
+}
+
+class ContinuousCollisionCheckTest : public ::testing::Test {
+ protected:
+    ContinuousCollisionCheckTest() {
+        std::mt19937 random_engine(7);
+        std::uniform_real_distribution<double> coordinate(-15, 15);
+        for (int i = 0; i != 40; ++i) obstacles_.emplace_back(coordinate(random_engine), coordinate(random_engine));
+        map_ = obstacleMap(obstacles_);
+    }
+    ~ContinuousCollisionCheckTest() override {
+        FLAGS_continuous_collision_check_max_depth = max_depth_;
+    }
+
+    // Check random straights and arcs of up to length against dense sampling. Returns the number of
+    // motions the continuous check found collision free.
+    int checkRandomMotions(double length, int motion_num) {
+        PathOptimizationNS::CollisionChecker checker(map_);
+        std::mt19937 random_engine(11);
+        std::uniform_real_distribution<double> coordinate(-12, 12);
+        std::uniform_real_distribution<double> heading(-M_PI, M_PI);
+        std::uniform_real_distribution<double> curvature(-0.25, 0.25);
+        std::uniform_real_distribution<double> motion_length(0.1, length);
+        int free_num = 0;
+        for (int i = 0; i != motion_num; ++i) {
+            const State from(coordinate(random_engine), coordinate(random_engine), heading(random_engine));
+            const double k = i % 4 == 0 ? 0 : curvature(random_engine);
+            const double s = motion_length(random_engine);
+            if (!checker.isSingleStateCollisionFree(from)) continue;
+            if (!checker.isMotionCollisionFree(from, moveAlongArc(from, k, s))) continue;
+            ++free_num;
+            EXPECT_TRUE(isDenselyCollisionFree(&checker, from, k, s))
+                << "from (" << from.x << ", " << from.y << ", " << from.z << "), k " << k << ", length " << s;
+        }
+        return free_num;
+    }
+
+    const int max_depth_{FLAGS_continuous_collision_check_max_depth};
+    std::vector<grid_map::Position> obstacles_;
+    grid_map::GridMap map_;
+};
+
+TEST_F(ContinuousCollisionCheckTest, ConservativeOnShortMotions) {
+    EXPECT_GT(checkRandomMotions(1.0, 2000), 100);
+}
+
+TEST_F(ContinuousCollisionCheckTest, ConservativeOnLongMotions) {
+    EXPECT_GT(checkRandomMotions(6.0, 2000), 50);
+}
+
+// Output states are joined by spline segments, whose curvature changes along the motion.
+TEST_F(ContinuousCollisionCheckTest, ConservativeOnClothoids) {
+    PathOptimizationNS::CollisionChecker checker(map_);
+    std::mt19937 random_engine(13);
+    std::uniform_real_distribution<double> coordinate(-12, 12);
+    std::uniform_real_distribution<double> heading(-M_PI, M_PI);
+    std::uniform_real_distribution<double> curvature(-0.25, 0.25);
+    std::uniform_real_distribution<double> motion_length(0.1, 3.0);
+    int free_num = 0;
+    for (int i = 0; i != 2000; ++i) {
+        const double x = coordinate(random_engine), y = coordinate(random_engine), z = heading(random_engine);
+        // Every fourth one an S-curve, which ends with the heading it started with.
+        const double from_k = curvature(random_engine);
+        const double to_k = i % 4 == 0 ? -from_k : curvature(random_engine);
+        const State from(x, y, z, from_k);
+        const double s = motion_length(random_engine);
+        if (!checker.isSingleStateCollisionFree(from)) continue;
+        State to;
+        isDenselyCollisionFree(nullptr, from, from_k, to_k, s, &to);
+        if (!checker.isMotionCollisionFree(from, to)) continue;
+        ++free_num;
+        EXPECT_TRUE(isDenselyCollisionFree(&checker, from, from_k, to_k, s))
+            << "from (" << from.x << ", " << from.y << ", " << from.z << "), k " << from_k << " to " << to_k
+            << ", length " << s;
+    }
+    EXPECT_GT(free_num, 100);
+}
+
+// A motion that can't be proven free within the depth limit is reported as collision, and a lower
+// limit only proves fewer motions free.
+TEST_F(ContinuousCollisionCheckTest, ConservativeAtEveryMaxDepth) {
+    int previous_free_num = -1;
+    for (int max_depth = 0; max_depth <= 6; max_depth += 2) {
+        FLAGS_continuous_collision_check_max_depth = max_depth;
+        const int free_num = checkRandomMotions(3.0, 1000);
+        EXPECT_GE(free_num, previous_free_num) << "max depth " << max_depth;
+        previous_free_num = free_num;
+    }
+}
+
+// An obstacle thinner than the gap between two free states is found.
+TEST_F(ContinuousCollisionCheckTest, ThinObstacleBetweenSamples) {
+    const auto map = obstacleMap({grid_map::Position(0, 0)});
+    PathOptimizationNS::CollisionChecker checker(map);
+    const State from(-8, 0, 0), to(4, 0, 0);
+    ASSERT_TRUE(checker.isSingleStateCollisionFree(from));
+    ASSERT_TRUE(checker.isSingleStateCollisionFree(to));
+    EXPECT_FALSE(isDenselyCollisionFree(&checker, from, 0, 12));
+    EXPECT_FALSE(checker.isMotionCollisionFree(from, to));
+    // Passing at a safe distance.
+    const State side_from(-8, 3, 0), side_to(4, 3, 0);
+    EXPECT_TRUE(checker.isMotionCollisionFree(side_from, side_to));
+}
+
+// Cutting a spline leaves the rest of the curve, including the extrapolation to the right.
+TEST(SplineTest, TrimLeftKeepsCurve) {
+    std::mt19937 random_engine(3);
+    std::uniform_real_distribution<double> value(-5, 5);
+    std::vector<double> x_list, y_list;
+    for (int i = 0; i != 20; ++i) {
+        x_list.emplace_back(i * 1.5);
+        y_list.emplace_back(value(random_engine));
+    }
+    PathOptimizationNS::tk::spline spline;
+    spline.set_points(x_list, y_list);
+    // Inside an interval and on a knot.
+    for (double x0 : {4.2, 6.0}) {
+        auto trimmed = spline;
+        trimmed.trim_left(x0);
+        for (double x = x0; x < x_list.back() + 2; x += 0.05) {
+            EXPECT_NEAR(trimmed(x - x0), spline(x), 1e-9) << "x0 " << x0 << ", x " << x;
+            EXPECT_NEAR(trimmed.deriv(1, x - x0), spline.deriv(1, x), 1e-9) << "x0 " << x0 << ", x " << x;
+            EXPECT_NEAR(trimmed.deriv(2, x - x0), spline.deriv(2, x), 1e-9) << "x0 " << x0 << ", x " << x;
+        }
+    }
+}
+
+// A reference path along an arc of curvature k from a state, fitted to points 1 m apart.
+void setArcPath(const State &from, double k, double length, PathOptimizationNS::ReferencePath *path) {
+    std::vector<double> s_list, x_list, y_list;
+    for (double s = 0; s <= length; s += 1.0) {
+        const auto state = moveAlongArc(from, k, s);
+        s_list.emplace_back(s);
+        x_list.emplace_back(state.x);
+        y_list.emplace_back(state.y);
+    }
+    PathOptimizationNS::tk::spline x_spline, y_spline;
+    x_spline.set_points(s_list, x_list);
+    y_spline.set_points(s_list, y_list);
+    path->setSpline(std::move(x_spline), std::move(y_spline), s_list.back());
+}
+
+double getCurvature(const PathOptimizationNS::ReferencePath &path, double s) {
+    const double dx = path.getXS().deriv(1, s), dy = path.getYS().deriv(1, s);
+    const double ddx = path.getXS().deriv(2, s), ddy = path.getYS().deriv(2, s);
+    return (dx * ddy - dy * ddx) / pow(dx * dx + dy * dy, 1.5);
+}
+
+// Curvature is continuous across the seam and stays close to the two paths'.
+TEST(IncrementalSmootherTest, StitchKeepsCurvatureContinuous) {
+    const double kept_k = 0.02, window_k = 0.025, begin_s = 3.3, seam_s = 40;
+    const State kept_start(10, -5, 0.3);
+    PathOptimizationNS::ReferencePath kept_path, window_path, stitched_path;
+    setArcPath(kept_start, kept_k, 80, &kept_path);
+    setArcPath(moveAlongArc(kept_start, kept_k, seam_s), window_k, 40, &window_path);
+    ASSERT_TRUE(PathOptimizationNS::IncrementalSmoother::stitch(kept_path, begin_s, seam_s, window_path,
+                                                                &stitched_path));
+
+    const auto begin_state = moveAlongArc(kept_start, kept_k, begin_s);
+    EXPECT_NEAR(stitched_path.getXS(0), begin_state.x, 1e-3);
+    EXPECT_NEAR(stitched_path.getYS(0), begin_state.y, 1e-3);
+    EXPECT_NEAR(stitched_path.getLength(), seam_s - begin_s + window_path.getLength(), 0.1);
+    // The natural spline ends have no curvature, so they are left out.
+    const double step = 0.1;
+    double previous_k = getCurvature(stitched_path, 3.0);
+    for (double s = 3.0 + step; s < stitched_path.getLength() - 3.0; s += step) {
+        const double k = getCurvature(stitched_path, s);
+        EXPECT_GT(k, kept_k - 0.01) << "s " << s;
+        EXPECT_LT(k, window_k + 0.01) << "s " << s;
+        EXPECT_LT(fabs(k - previous_k), 0.002) << "s " << s;
+        previous_k = k;
+    }
+}
+
+// Paths curving apart can only be blended with a curvature spike, the stitch is refused.
+TEST(IncrementalSmootherTest, StitchRefusesCurvatureSpike) {
+    const State kept_start(10, -5, 0.3);
+    PathOptimizationNS::ReferencePath kept_path, window_path, stitched_path;
+    setArcPath(kept_start, 0.02, 80, &kept_path);
+    setArcPath(moveAlongArc(kept_start, 0.02, 40), -0.03, 40, &window_path);
+    EXPECT_FALSE(PathOptimizationNS::IncrementalSmoother::stitch(kept_path, 3.3, 40, window_path, &stitched_path));
+}
+
+// Cells hold the map distance at their position, and a changed map isn't read from the kept cells.
+TEST(ClearanceRasterTest, FollowsMapChanges) {
+    const auto free_grid_map = obstacleMap({grid_map::Position(-18, 18)});
+    const auto blocked_grid_map = obstacleMap({grid_map::Position(0, 0)});
+    PathOptimizationNS::Map map(free_grid_map);
+    PathOptimizationNS::ReferencePath path;
+    setArcPath(State(-12, -8, 0.5), 0.1, 30, &path);
+    const auto &line = path.getReferenceLine();
+    const auto expect_map_distances = [&](const PathOptimizationNS::ClearanceRaster &raster) {
+        for (int row = 0; row < static_cast<int>(raster.getRowNum()); row += 7) {
+            const double s = raster.getRowS(row), heading = line.getHeading(s);
+            for (double l = -5; l <= 5; l += 0.5) {
+                const Eigen::Vector2d position(line.getX(s) - l * sin(heading), line.getY(s) + l * cos(heading));
+                EXPECT_NEAR(raster.getDistance(row, l), map.getObstacleDistance(position), 1e-4)
+                    << "s " << s << ", l " << l;
+            }
+        }
+    };
+    const auto &raster = path.getClearanceRaster(map, 0, line.getLength(), 7);
+    expect_map_distances(raster);
+    EXPECT_TRUE(raster.matches(map, 0, line.getLength(), 7, FLAGS_clearance_raster_ds, FLAGS_clearance_raster_dl));
+    map.setGridMap(blocked_grid_map);
+    EXPECT_FALSE(raster.matches(map, 0, line.getLength(), 7, FLAGS_clearance_raster_ds, FLAGS_clearance_raster_dl));
+    expect_map_distances(path.getClearanceRaster(map, 0, line.getLength(), 7));
+}
+
+// Projections match the closest of densely sampled points on a winding line.
+TEST(ProjectionIndexTest, MatchesBruteForce) {
+    std::vector<double> s_list, x_list, y_list;
+    for (double s = 0; s <= 60; s += 1.0) {
+        s_list.emplace_back(s);
+        x_list.emplace_back(s);
+        y_list.emplace_back(3 * sin(s * 2 * M_PI / 30));
+    }
+    PathOptimizationNS::tk::spline x_spline, y_spline;
+    x_spline.set_points(s_list, x_list);
+    y_spline.set_points(s_list, y_list);
+    PathOptimizationNS::ReferencePath path;
+    path.setSpline(std::move(x_spline), std::move(y_spline), s_list.back());
+    const auto &line = path.getReferenceLine();
+    const auto &index = path.getProjectionIndex();
+    ASSERT_FALSE(index.empty());
+
+    std::mt19937 random_engine(5);
+    std::uniform_real_distribution<double> s_value(2, line.getLength() - 2), l_value(-2.5, 2.5);
+    for (int i = 0; i != 200; ++i) {
+        const double query_s = s_value(random_engine), heading = line.getHeading(query_s), l = l_value(random_engine);
+        const double x = line.getX(query_s) - l * sin(heading), y = line.getY(query_s) + l * cos(heading);
+        double closest_s = 0, closest_distance = DBL_MAX;
+        for (double s = 0; s <= line.getLength(); s += 0.005) {
+            const double distance = hypot(line.getX(s) - x, line.getY(s) - y);
+            if (distance < closest_distance) {
+                closest_distance = distance;
+                closest_s = s;
+            }
+        }
+        const auto projection = index.getProjection(x, y);
+        EXPECT_NEAR(projection.s, closest_s, 0.02) << "x " << x << ", y " << y;
+        EXPECT_NEAR(hypot(projection.x - x, projection.y - y), closest_distance, 1e-3) << "x " << x << ", y " << y;
+    }
+}
+
+// An iterate the budget stopped OSQP at is only used if it nearly satisfies the constraints.
+TEST(OsqpSolverTest, EarlyStopNeedsSmallPrimalResidual) {
+    using PathOptimizationNS::OsqpSolver;
+    const Eigen::VectorXd iterate = Eigen::VectorXd::Ones(4);
+    const double tolerance = FLAGS_qp_early_stop_max_primal_residual;
+    EXPECT_TRUE(OsqpSolver::isUsableEarlyStop(OSQP_MAX_ITER_REACHED, 0.5 * tolerance, iterate));
+    EXPECT_TRUE(OsqpSolver::isUsableEarlyStop(OSQP_TIME_LIMIT_REACHED, 0.5 * tolerance, iterate));
+    EXPECT_FALSE(OsqpSolver::isUsableEarlyStop(OSQP_MAX_ITER_REACHED, 2 * tolerance, iterate));
+    EXPECT_FALSE(OsqpSolver::isUsableEarlyStop(OSQP_TIME_LIMIT_REACHED, 100 * tolerance, iterate));
+    EXPECT_FALSE(OsqpSolver::isUsableEarlyStop(OSQP_PRIMAL_INFEASIBLE, 0, iterate));
+    Eigen::VectorXd nan_iterate = iterate;
+    nan_iterate(2) = NAN;
+    EXPECT_FALSE(OsqpSolver::isUsableEarlyStop(OSQP_MAX_ITER_REACHED, 0, nan_iterate));
+}
+
+// The SQP on OSQP and IPOPT minimize the same angle diff cost, so they should agree on the offsets
+// of a noisy curve.
+TEST(AngleDiffSmootherTest, SqpAgreesWithIpopt) {
+    std::vector<double> x_list, y_list, angle_list;
+    for (int i = 0; i != 41; ++i) {
+        x_list.emplace_back(i);
+        y_list.emplace_back(3 * sin(i / 7.0) + (i % 2 ? 0.3 : -0.2));
+        angle_list.emplace_back(atan2(3 / 7.0 * cos(i / 7.0), 1.0));
+    }
+    std::vector<double> lower_bound(x_list.size(), -DBL_MAX), upper_bound(x_list.size(), DBL_MAX);
+    lower_bound.front() = upper_bound.front() = 0;
+    lower_bound.back() = upper_bound.back() = 0;
+    Ipopt::SmartPtr<PathOptimizationNS::AngleDiffSmoothingNlp> nlp =
+        new PathOptimizationNS::AngleDiffSmoothingNlp(x_list, y_list, angle_list, lower_bound, upper_bound,
+                                                      FLAGS_frenet_angle_diff_weight,
+                                                      FLAGS_frenet_angle_diff_diff_weight,
+                                                      FLAGS_frenet_deviation_weight);
+    PathOptimizationNS::solveFrenetOffsetNlp(nlp, 1.0, false, nullptr);
+    ASSERT_EQ(nlp->getStatus(), Ipopt::SUCCESS);
+    std::vector<double> sqp_offsets;
+    ASSERT_TRUE(PathOptimizationNS::solveAngleDiffSqp(*nlp, lower_bound, upper_bound,
+                                                      std::numeric_limits<double>::infinity(), nullptr,
+                                                      &sqp_offsets));
+    const auto &ipopt_offsets = nlp->getSolution();
+    ASSERT_EQ(sqp_offsets.size(), ipopt_offsets.size());
+    for (size_t i = 0; i != sqp_offsets.size(); ++i) {
+        EXPECT_NEAR(sqp_offsets[i], ipopt_offsets[i], 0.01) << "at point " << i;
+    }
+}
+
+class ResultCacheTest : public ::testing::Test {
+ protected:
+    void SetUp() override {
+        FLAGS_result_cache_capacity = 4;
+        setArcPath(State(0, 0, 0.2), 0.05, 20, &reference_path_);
+        for (int i = 0; i != 5; ++i) reference_points_.emplace_back(moveAlongArc(State(0, 0, 0.2), 0.05, i * 5.0));
+    }
+    // Key the cache with the reference points, a start at (start_x, 0) and the map's version.
+    void setInput(double start_x, const PathOptimizationNS::Map &map) {
+        cache_.setInput(reference_points_, State(start_x, 0, 0.2), State(15, 5, 1), map.getVersion());
+    }
+    bool findReference() {
+        PathOptimizationNS::ReferencePath reference_path;
+        return cache_.findReference(&reference_path);
+    }
+
+    // Restores the flags changed by the tests.
+    google::FlagSaver flag_saver_;
+    PathOptimizationNS::ResultCache cache_;
+    PathOptimizationNS::ReferencePath reference_path_;
+    std::vector<State> reference_points_;
+};
+
+// The same input finds the kept reference, the input after the map changed doesn't.
+TEST_F(ResultCacheTest, HitUntilMapChanges) {
+    PathOptimizationNS::Map map(obstacleMap({grid_map::Position(10, 10)}));
+    setInput(0, map);
+    EXPECT_FALSE(findReference());
+    cache_.putReference(reference_path_);
+    setInput(0, map);
+    PathOptimizationNS::ReferencePath found_path;
+    ASSERT_TRUE(cache_.findReference(&found_path));
+    EXPECT_DOUBLE_EQ(found_path.getLength(), reference_path_.getLength());
+    EXPECT_EQ(found_path.getXS()(7.5), reference_path_.getXS()(7.5));
+    EXPECT_EQ(cache_.getReferenceHits(), 1u);
+
+    map.setGridMap(obstacleMap({grid_map::Position(-10, 10)}));
+    setInput(0, map);
+    EXPECT_FALSE(findReference());
+    EXPECT_EQ(cache_.getLookups(), 3u);
+}
+
+// Starts within half a position resolution of the kept one share its result.
+TEST_F(ResultCacheTest, QuantizesStart) {
+    FLAGS_result_cache_position_resolution = 0.1;
+    const PathOptimizationNS::Map map(obstacleMap({}));
+    setInput(1.0, map);
+    cache_.putReference(reference_path_);
+    setInput(1.04, map);
+    EXPECT_TRUE(findReference());
+    setInput(0.96, map);
+    EXPECT_TRUE(findReference());
+    setInput(1.06, map);
+    EXPECT_FALSE(findReference());
+}
+
+// A full cache drops the least recently used reference.
+TEST_F(ResultCacheTest, EvictsLeastRecentlyUsed) {
+    FLAGS_result_cache_capacity = 2;
+    const PathOptimizationNS::Map map(obstacleMap({}));
+    for (const double start_x : {1.0, 2.0}) {
+        setInput(start_x, map);
+        cache_.putReference(reference_path_);
+    }
+    // 1 is used after 2, so 2 is dropped for 3.
+    setInput(1.0, map);
+    EXPECT_TRUE(findReference());
+    setInput(3.0, map);
+    cache_.putReference(reference_path_);
+    setInput(2.0, map);
+    EXPECT_FALSE(findReference());
+    for (const double start_x : {1.0, 3.0}) {
+        setInput(start_x, map);
+        EXPECT_TRUE(findReference()) << "start " << start_x;
+    }
+}
+
+// Changing any flag of planning_flags.cpp keys other results, except for the flags listed here,
+// which the results don't depend on.
+TEST_F(ResultCacheTest, KeyedByEveryPlanningFlag) {
+    const std::vector<std::string> unkeyed_flags{
+        "enable_computation_time_output", "planning_stats_file", "candidate_thread_num", "race_thread_num",
+        "result_cache_capacity", "result_cache_position_resolution", "result_cache_angle_resolution",
+        "result_cache_curvature_resolution"};
+    const PathOptimizationNS::Map map(obstacleMap({}));
+    std::vector<google::CommandLineFlagInfo> flags;
+    google::GetAllFlags(&flags);
+    int planning_flag_num = 0;
+    for (const auto &flag : flags) {
+        if (flag.filename.find("planning_flags.cpp") == std::string::npos) continue;
+        ++planning_flag_num;
+        if (std::find(unkeyed_flags.begin(), unkeyed_flags.end(), flag.name) != unkeyed_flags.end()) continue;
+        cache_.clear();
+        setInput(0, map);
+        cache_.putReference(reference_path_);
+        ASSERT_TRUE(findReference()) << flag.name;
+        // Set the flag through its pointer so the validators don't get in the way.
+        void *value = const_cast<void *>(flag.flag_ptr);
+        if (flag.type == "bool") {
+            *static_cast<bool *>(value) = !*static_cast<bool *>(value);
+        } else if (flag.type == "int32") {
+            *static_cast<int32_t *>(value) += 1;
+        } else if (flag.type == "double") {
+            *static_cast<double *>(value) += 1;
+        } else {
+            ASSERT_EQ(flag.type, "string") << flag.name;
+            *static_cast<std::string *>(value) += "_changed";
+        }
+        setInput(0, map);
+        EXPECT_FALSE(findReference()) << "FLAGS_" << flag.name << " isn't keyed.";
+    }
+    EXPECT_GT(planning_flag_num, 0);
+}
+}
@@ -3,25 +3,32 @@
 //
 #include <glog/logging.h>
 #include "path_optimizer/tools/Map.hpp"
+#include "path_optimizer/tools/instrumentation.hpp"
 
 namespace PathOptimizationNS {
 
-Map::Map(const grid_map::GridMap &grid_map) :
-    maps(grid_map) {
+Map::Map(const grid_map::GridMap &grid_map) {
+    setGridMap(grid_map);
+}
+
+void Map::setGridMap(const grid_map::GridMap &grid_map) {
+    maps = &grid_map;
+    ++version_;
     if (!grid_map.exists("distance")) {
         LOG(ERROR) << "grid map must contain 'distance' layer";
     }
 }
 
 double Map::getObstacleDistance(const Eigen::Vector2d &pos) const {
-    if (maps.isInside(pos)) {
-        return this->maps.atPosition("distance", pos, grid_map::InterpolationMethods::INTER_LINEAR);
+    PATH_OPTIMIZER_COUNT(kObstacleDistance);
+    if (maps->isInside(pos)) {
+        return maps->atPosition("distance", pos, grid_map::InterpolationMethods::INTER_LINEAR);
     } else {
         return 0.0;
     }
 }
 
 bool Map::isInside(const Eigen::Vector2d &pos) const {
-    return maps.isInside(pos);
+    return maps->isInside(pos);
 }
 }
\ No newline at end of file
@@ -0,0 +1,107 @@
+#include "path_optimizer/tools/allocation_tracker.hpp"
+
+#ifdef PATH_OPTIMIZER_ENABLE_ALLOCATION_TRACKING
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace PathOptimizationNS {
+namespace allocation_tracker {
+
+namespace {
+// Zero initialized and trivially destructible, so it's usable from operator new at any time,
+// including thread start and exit. Slot 0 is for no tag.
+struct ThreadCounts {
+    int tag_slot;
+    uint64_t calls[kTagNum + 1];
+    uint64_t bytes[kTagNum + 1];
+};
+thread_local ThreadCounts thread_counts;
+std::atomic<uint64_t> total_calls{0};
+std::atomic<uint64_t> total_bytes{0};
+
+inline void record(std::size_t size) {
+    auto &counts = thread_counts;
+    ++counts.calls[counts.tag_slot];
+    counts.bytes[counts.tag_slot] += size;
+    total_calls.fetch_add(1, std::memory_order_relaxed);
+    total_bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+void *allocate(std::size_t size) {
+    record(size);
+    if (size == 0) size = 1;
+    while (true) {
+        if (void *p = std::malloc(size)) return p;
+        auto handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+}
+
+int setTag(int tag) {
+    const int previous = thread_counts.tag_slot - 1;
+    thread_counts.tag_slot = tag >= 0 && tag < kTagNum ? tag + 1 : 0;
+    return previous;
+}
+
+AllocationCount getThreadCount(int tag) {
+    const int slot = tag >= 0 && tag < kTagNum ? tag + 1 : 0;
+    AllocationCount count;
+    count.calls = thread_counts.calls[slot];
+    count.bytes = thread_counts.bytes[slot];
+    return count;
+}
+
+AllocationCount getTotalCount() {
+    AllocationCount count;
+    count.calls = total_calls.load(std::memory_order_relaxed);
+    count.bytes = total_bytes.load(std::memory_order_relaxed);
+    return count;
+}
+
+}
+}
+
+void *operator new(std::size_t size) {
+    return PathOptimizationNS::allocation_tracker::allocate(size);
+}
+
+void *operator new[](std::size_t size) {
+    return PathOptimizationNS::allocation_tracker::allocate(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    try {
+        return PathOptimizationNS::allocation_tracker::allocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+    try {
+        return PathOptimizationNS::allocation_tracker::allocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+    std::free(p);
+}
+
+#endif
@@ -0,0 +1,124 @@
+#include <cmath>
+#include <algorithm>
+#include <glog/logging.h>
+#include "path_optimizer/tools/b_spline.hpp"
+#include "path_optimizer/data_struct/data_struct.hpp"
+
+namespace PathOptimizationNS {
+
+constexpr int ClampedBSpline::kMaxDegree;
+
+ClampedBSpline::ClampedBSpline(const std::vector<State> &control_points, int degree) {
+    CHECK_GE(control_points.size(), 2);
+    CHECK_GE(degree, 1);
+    CHECK_LE(degree, kMaxDegree);
+    const auto n = control_points.size();
+    degree_ = std::min<int>(degree, n - 1);
+    ctrl_x_.reserve(n);
+    ctrl_y_.reserve(n);
+    for (const auto &point : control_points) {
+        ctrl_x_.emplace_back(point.x);
+        ctrl_y_.emplace_back(point.y);
+    }
+    // degree + 1 zeros, n - degree - 1 uniform interior knots, degree + 1 ones.
+    knots_.assign(n + degree_ + 1, 0.0);
+    const double interior_num = n - degree_;
+    for (std::size_t i = degree_ + 1; i != knots_.size(); ++i) {
+        knots_[i] = std::min((i - degree_) / interior_num, 1.0);
+    }
+}
+
+std::size_t ClampedBSpline::findSpan(double t, std::size_t hint) const {
+    // Valid spans are [degree, n - 1], t = 1 belongs to the last one.
+    const std::size_t last = ctrl_x_.size() - 1;
+    auto span = std::max<std::size_t>(hint, degree_);
+    while (span < last && t >= knots_[span + 1]) ++span;
+    return span;
+}
+
+void ClampedBSpline::evaluate(double t, double *x, double *y, double *dx, double *dy) const {
+    t = std::max(0.0, std::min(t, 1.0));
+    evaluateInSpan(findSpan(t, 0), t, x, y, dx, dy);
+}
+
+void ClampedBSpline::evaluateInSpan(std::size_t span, double t, double *x, double *y, double *dx, double *dy) const {
+    const int p = degree_;
+    double px[kMaxDegree + 1], py[kMaxDegree + 1];
+    for (int j = 0; j <= p; ++j) {
+        px[j] = ctrl_x_[span - p + j];
+        py[j] = ctrl_y_[span - p + j];
+    }
+    // Points of the second to last level of the de Boor triangle give the derivative.
+    double pre_x0{}, pre_y0{}, pre_x1{}, pre_y1{};
+    for (int r = 1; r <= p; ++r) {
+        if (r == p) {
+            pre_x0 = px[p - 1];
+            pre_y0 = py[p - 1];
+            pre_x1 = px[p];
+            pre_y1 = py[p];
+        }
+        for (int j = p; j >= r; --j) {
+            const double left = knots_[span - p + j];
+            const double alpha = (t - left) / (knots_[span + 1 + j - r] - left);
+            px[j] = (1 - alpha) * px[j - 1] + alpha * px[j];
+            py[j] = (1 - alpha) * py[j - 1] + alpha * py[j];
+        }
+    }
+    if (x) *x = px[p];
+    if (y) *y = py[p];
+    const double factor = p / (knots_[span + 1] - knots_[span]);
+    if (dx) *dx = factor * (pre_x1 - pre_x0);
+    if (dy) *dy = factor * (pre_y1 - pre_y0);
+}
+
+namespace {
+inline double stepByArcLength(double ds, double dx, double dy, double max_dt) {
+    const double speed = sqrt(dx * dx + dy * dy);
+    return speed > ds / max_dt ? ds / speed : max_dt;
+}
+}
+
+void ClampedBSpline::sampleByArcLength(double ds,
+                                       std::vector<double> *x_list,
+                                       std::vector<double> *y_list,
+                                       std::vector<double> *s_list) const {
+    CHECK_GT(ds, 0);
+    x_list->clear();
+    y_list->clear();
+    s_list->clear();
+    // Never step over the support of a whole basis function, even where the curve almost stops.
+    const double max_dt = (degree_ + 1.0) / (ctrl_x_.size() - degree_);
+    std::size_t span = degree_;
+    double t = 0;
+    double x, y, dx, dy;
+    while (t < 1) {
+        span = findSpan(t, span);
+        evaluateInSpan(span, t, &x, &y, &dx, &dy);
+        if (s_list->empty()) {
+            s_list->emplace_back(0);
+        } else {
+            s_list->emplace_back(s_list->back() + sqrt(pow(x - x_list->back(), 2) + pow(y - y_list->back(), 2)));
+        }
+        x_list->emplace_back(x);
+        y_list->emplace_back(y);
+        // Midpoint rule: take the speed halfway through the first-order step.
+        double dt = stepByArcLength(ds, dx, dy, max_dt);
+        const double mid_t = std::min(t + 0.5 * dt, 1.0);
+        evaluateInSpan(findSpan(mid_t, span), mid_t, nullptr, nullptr, &dx, &dy);
+        dt = stepByArcLength(ds, dx, dy, max_dt);
+        t += dt;
+    }
+    evaluateInSpan(ctrl_x_.size() - 1, 1.0, &x, &y, nullptr, nullptr);
+    // Replace the last sample instead of adding a near duplicate of it.
+    if (x_list->size() > 1
+        && sqrt(pow(x - x_list->back(), 2) + pow(y - y_list->back(), 2)) < 0.5 * ds) {
+        x_list->pop_back();
+        y_list->pop_back();
+        s_list->pop_back();
+    }
+    s_list->emplace_back(s_list->back() + sqrt(pow(x - x_list->back(), 2) + pow(y - y_list->back(), 2)));
+    x_list->emplace_back(x);
+    y_list->emplace_back(y);
+}
+
+}
@@ -0,0 +1,90 @@
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <glog/logging.h>
+#include "path_optimizer/tools/clearance_raster.hpp"
+#include "path_optimizer/tools/Map.hpp"
+#include "path_optimizer/data_struct/reference_line.hpp"
+
+namespace PathOptimizationNS {
+
+void ClearanceRaster::build(const ReferenceLine &reference_line,
+                            const Map &map,
+                            double s_begin,
+                            double s_end,
+                            double max_l,
+                            double ds,
+                            double dl) {
+    CHECK_GT(ds, 0);
+    CHECK_GT(dl, 0);
+    clear();
+    map_ = &map;
+    map_version_ = map.getVersion();
+    s_begin_ = s_begin;
+    s_end_ = std::max(s_begin, s_end);
+    max_l_ = max_l;
+    ds_ = ds;
+    dl_ = dl;
+    column_num_ = static_cast<int>(2 * max_l / dl + 1e-6) + 1;
+    for (int i = 0;; ++i) {
+        double s = s_begin_ + i * ds_;
+        // The last row is exactly at s_end.
+        if (s > s_end_ - 1e-6) s = s_end_;
+        const double heading = reference_line.getHeading(s);
+        row_s_.emplace_back(s);
+        row_x_.emplace_back(reference_line.getX(s));
+        row_y_.emplace_back(reference_line.getY(s));
+        row_cos_.emplace_back(cos(heading));
+        row_sin_.emplace_back(sin(heading));
+        if (s == s_end_) break;
+    }
+    cells_.assign(row_s_.size() * column_num_, std::numeric_limits<float>::quiet_NaN());
+}
+
+void ClearanceRaster::clear() {
+    map_ = nullptr;
+    row_s_.clear();
+    row_x_.clear();
+    row_y_.clear();
+    row_cos_.clear();
+    row_sin_.clear();
+    cells_.clear();
+}
+
+bool ClearanceRaster::matches(const Map &map,
+                              double s_begin,
+                              double s_end,
+                              double max_l,
+                              double ds,
+                              double dl) const {
+    return !empty() && map_ == &map && map_version_ == map.getVersion() && s_begin_ == s_begin
+        && s_end_ == std::max(s_begin, s_end) && max_l_ == max_l && ds_ == ds && dl_ == dl;
+}
+
+int ClearanceRaster::getRow(double s) const {
+    const int last = static_cast<int>(row_s_.size()) - 1;
+    auto row = static_cast<int>(lround((s - s_begin_) / ds_));
+    row = std::max(0, std::min(row, last));
+    // The last row may be closer than a regular spacing.
+    if (row < last && fabs(s - row_s_[last]) < fabs(s - row_s_[row])) row = last;
+    return row;
+}
+
+double ClearanceRaster::getDistance(int row, double l) const {
+    const auto column = static_cast<int>(lround((l + max_l_) / dl_));
+    if (column < 0 || column >= column_num_) return sample(row, l);
+    return getCell(row, column);
+}
+
+double ClearanceRaster::getCell(int row, int column) const {
+    auto &cell = cells_[row * column_num_ + column];
+    if (std::isnan(cell)) cell = static_cast<float>(sample(row, -max_l_ + column * dl_));
+    return cell;
+}
+
+double ClearanceRaster::sample(int row, double l) const {
+    const Eigen::Vector2d position(row_x_[row] - l * row_sin_[row], row_y_[row] + l * row_cos_[row]);
+    return map_->getObstacleDistance(position);
+}
+
+}
@@ -2,7 +2,9 @@
 // Created by yangt on 19-5-8.
 //
 #include "path_optimizer/tools/collosion_checker.hpp"
+#include "path_optimizer/tools/tools.hpp"
 #include "path_optimizer/config/planning_flags.hpp"
+#include "path_optimizer/tools/instrumentation.hpp"
 
 namespace PathOptimizationNS {
 
@@ -14,12 +16,17 @@ CollisionChecker::CollisionChecker(const grid_map::GridMap &in_gm)
 {
 }
 
+void CollisionChecker::setMap(const grid_map::GridMap &in_gm) {
+    map_.setGridMap(in_gm);
+}
+
 bool CollisionChecker::isSingleStateCollisionFree(const State &current) {
     // get the footprint circles based on current vehicle state in global frame
     std::vector<Circle> footprint =
         this->car_.getCircles(current);
     // footprint checking
     for (auto &circle_itr : footprint) {
+        PATH_OPTIMIZER_COUNT(kCollisionCircle);
         grid_map::Position pos(circle_itr.x,
                                circle_itr.y);
         // complete collision checking
@@ -41,6 +48,7 @@ bool CollisionChecker::isSingleStateCollisionFree(const State &current) {
 bool CollisionChecker::isSingleStateCollisionFreeImproved(const State &current) {
     // get the bounding circle position in global frame
     Circle bounding_circle = this->car_.getBoundingCircle(current);
+    PATH_OPTIMIZER_COUNT(kCollisionCircle);
 
     grid_map::Position pos(bounding_circle.x,
                            bounding_circle.y);
@@ -58,4 +66,74 @@ bool CollisionChecker::isSingleStateCollisionFreeImproved(const State &current)
     }
 }
 
+bool CollisionChecker::isMotionCollisionFree(const State &from, const State &to) {
+    if (!isSingleStateCollisionFreeImproved(to)) return false;
+    const double chord = distance(from, to);
+    const double heading_change = fabs(constraintAngle(to.z - from.z));
+    if (isEqual(chord, 0) && isEqual(heading_change, 0)) return true;
+    // Upper bounds of the rear axle's path length and of its total turning. A curve of length L
+    // whose curvature stays within max_k and which turns by less than pi is at least as long as
+    // the chord of the arc of length L and curvature max_k (Schur's comparison theorem), so
+    // chord >= 2 * sin(max_k * L / 2) / max_k. max_k includes the curvature of the arc joining
+    // the states, so it's never below what the heading change needs.
+    double path_length = chord;
+    double turning = heading_change;
+    if (!isEqual(chord, 0)) {
+        const double max_k = std::max(std::max(fabs(from.k), fabs(to.k)), heading_change / chord);
+        const double half_turning_sin = max_k * chord / 2.0;
+        if (half_turning_sin >= 1) return false;
+        if (!isEqual(max_k, 0)) path_length = 2.0 * asin(half_turning_sin) / max_k;
+        turning = max_k * path_length;
+    }
+    // A point at distance d from the rear axle travels at most L + d * turning, so its path never
+    // leaves the ellipse with its start and end as foci and that as major axis.
+    auto is_swept_circle_free = [&](const Circle &c_from, const Circle &c_to) {
+        const double arm = sqrt(pow(c_from.x - from.x, 2) + pow(c_from.y - from.y, 2));
+        const double length = path_length + arm * turning;
+        return isEllipseCollisionFree(grid_map::Position(c_from.x, c_from.y),
+                                      grid_map::Position(c_to.x, c_to.y),
+                                      length, -length / 2.0, length / 2.0, c_from.r, 0);
+    };
+    // Try the bounding circle first, then the covering circles.
+    if (is_swept_circle_free(car_.getBoundingCircle(from), car_.getBoundingCircle(to))) return true;
+    const auto circles_from = car_.getCircles(from);
+    const auto circles_to = car_.getCircles(to);
+    for (size_t i = 0; i != circles_from.size(); ++i) {
+        if (!is_swept_circle_free(circles_from[i], circles_to[i])) return false;
+    }
+    return true;
+}
+
+bool CollisionChecker::isEllipseCollisionFree(const grid_map::Position &from,
+                                              const grid_map::Position &to,
+                                              double length,
+                                              double u0,
+                                              double u1,
+                                              double r,
+                                              int depth) {
+    PATH_OPTIMIZER_COUNT(kCollisionCircle);
+    const grid_map::Position focus_offset = to - from;
+    const double focus_distance = focus_offset.norm();
+    const double semi_major = std::max(length, focus_distance) / 2.0;
+    const double semi_minor = sqrt(std::max(pow(semi_major, 2) - pow(focus_distance / 2.0, 2), 0.0));
+    const grid_map::Position axis =
+        isEqual(focus_distance, 0) ? grid_map::Position(1, 0) : grid_map::Position(focus_offset / focus_distance);
+    // The part lies in the rectangle over [u0, u1] as wide as the ellipse where it's widest in the
+    // part, which lies in the disc around the rectangle's center through its corners.
+    const double closest_u = u0 <= 0 && u1 >= 0 ? 0 : std::min(fabs(u0), fabs(u1));
+    const double half_width = semi_minor * sqrt(std::max(1 - pow(closest_u / semi_major, 2), 0.0));
+    const double radius = sqrt(pow((u1 - u0) / 2.0, 2) + pow(half_width, 2));
+    const grid_map::Position center = (from + to) / 2.0 + axis * (u0 + u1) / 2.0;
+    if (map_.isInside(center) && map_.getObstacleDistance(center) >= r + radius) return true;
+    // Not able to prove it's collision free; check the two halves. If the part gets too short,
+    // report collision to stay conservative.
+    if (u1 - u0 < FLAGS_continuous_collision_check_min_length
+        || depth >= FLAGS_continuous_collision_check_max_depth) {
+        return false;
+    }
+    const double u_mid = (u0 + u1) / 2.0;
+    return isEllipseCollisionFree(from, to, length, u0, u_mid, r, depth + 1)
+        && isEllipseCollisionFree(from, to, length, u_mid, u1, r, depth + 1);
+}
+
 }
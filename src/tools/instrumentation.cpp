@@ -0,0 +1,154 @@
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <glog/logging.h>
+#include "path_optimizer/tools/instrumentation.hpp"
+
+namespace PathOptimizationNS {
+namespace instrumentation {
+
+const char *counterName(Counter counter) {
+    switch (counter) {
+        case kObstacleDistance: return "obstacle_distance";
+        case kSplineEvaluation: return "spline_evaluation";
+        case kSearchEdge: return "search_edge";
+        case kCollisionCircle: return "collision_circle";
+        default: return "unknown";
+    }
+}
+
+#ifdef PATH_OPTIMIZER_ENABLE_INSTRUMENTATION
+
+namespace {
+// Events beyond this are dropped, so a long running process doesn't grow without bound.
+const std::size_t kMaxTraceEventNum = 1 << 20;
+
+struct TraceEvent {
+    const char *name;
+    int thread_index;
+    double begin_us, duration_us;
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadRecord>> threads;
+    std::vector<TraceEvent> events;
+    std::size_t dropped_event_num{0};
+    // Trace timestamps are relative to this.
+    const std::chrono::steady_clock::time_point epoch{std::chrono::steady_clock::now()};
+};
+
+// Never destroyed, threads may still count during static destruction.
+Registry &registry() {
+    static auto *registry = new Registry;
+    return *registry;
+}
+
+double toUs(const std::chrono::steady_clock::duration &duration) {
+    return std::chrono::duration<double, std::micro>(duration).count();
+}
+}
+
+ThreadRecord::ThreadRecord() : thread_index(0) {
+    for (auto &counter : counters) counter.store(0, std::memory_order_relaxed);
+}
+
+ThreadRecord *registerThread() {
+    auto &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.threads.emplace_back(new ThreadRecord);
+    r.threads.back()->thread_index = static_cast<int>(r.threads.size());
+    return r.threads.back().get();
+}
+
+void addTraceEvent(const char *name,
+                   const std::chrono::steady_clock::time_point &begin,
+                   const std::chrono::steady_clock::time_point &end) {
+    const int thread_index = threadRecord().thread_index;
+    auto &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    if (r.events.size() >= kMaxTraceEventNum) {
+        ++r.dropped_event_num;
+        return;
+    }
+    r.events.push_back(TraceEvent{name, thread_index, toUs(begin - r.epoch), toUs(end - begin)});
+}
+
+Counters getCounters() {
+    Counters sum{};
+    auto &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (const auto &thread : r.threads) {
+        for (int i = 0; i != kCounterNum; ++i) sum[i] += thread->counters[i].load(std::memory_order_relaxed);
+    }
+    return sum;
+}
+
+void resetCounters() {
+    auto &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (const auto &thread : r.threads) {
+        for (auto &counter : thread->counters) counter.store(0, std::memory_order_relaxed);
+    }
+}
+
+bool writeChromeTrace(const std::string &file_name) {
+    std::ofstream file(file_name);
+    if (!file) {
+        LOG(WARNING) << "Failed to open " << file_name << " for the trace.";
+        return false;
+    }
+    auto &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    if (r.dropped_event_num > 0) LOG(WARNING) << r.dropped_event_num << " trace events were dropped.";
+    const double now_us = toUs(std::chrono::steady_clock::now() - r.epoch);
+    file << "{\"traceEvents\":[";
+    bool first = true;
+    for (const auto &event : r.events) {
+        file << (first ? "" : ",") << "\n{\"name\":\"" << event.name
+             << "\",\"cat\":\"path_optimizer\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread_index
+             << ",\"ts\":" << event.begin_us << ",\"dur\":" << event.duration_us << "}";
+        first = false;
+    }
+    // Counter totals of each thread, at the time of writing.
+    for (const auto &thread : r.threads) {
+        file << (first ? "" : ",") << "\n{\"name\":\"counters\",\"ph\":\"C\",\"pid\":1,\"tid\":"
+             << thread->thread_index << ",\"ts\":" << now_us << ",\"args\":{";
+        for (int i = 0; i != kCounterNum; ++i) {
+            file << (i == 0 ? "" : ",") << "\"" << counterName(static_cast<Counter>(i)) << "\":"
+                 << thread->counters[i].load(std::memory_order_relaxed);
+        }
+        file << "}}";
+        first = false;
+    }
+    file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return static_cast<bool>(file);
+}
+
+void clearTrace() {
+    auto &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.events.clear();
+    r.dropped_event_num = 0;
+}
+
+#else
+
+Counters getCounters() {
+    return Counters{};
+}
+
+void resetCounters() {}
+
+bool writeChromeTrace(const std::string &file_name) {
+    LOG(WARNING) << "Instrumentation is disabled, build with PATH_OPTIMIZER_ENABLE_INSTRUMENTATION to write "
+                 << file_name << ".";
+    return false;
+}
+
+void clearTrace() {}
+
+#endif
+}
+}
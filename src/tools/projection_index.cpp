@@ -0,0 +1,204 @@
+#include <cmath>
+#include <cfloat>
+#include <cstdlib>
+#include <algorithm>
+#include <glog/logging.h>
+#include "path_optimizer/tools/projection_index.hpp"
+#include "path_optimizer/data_struct/reference_line.hpp"
+#include "path_optimizer/data_struct/data_struct.hpp"
+
+namespace PathOptimizationNS {
+
+namespace {
+// Chords checked on each side of the hint.
+const int kHintChords = 2;
+}
+
+void ProjectionIndex::build(const ReferenceLine &reference_line, double sample_spacing, double cell_size) {
+    CHECK_GT(sample_spacing, 0);
+    CHECK_GT(cell_size, 0);
+    clear();
+    if (reference_line.empty()) return;
+    reference_line_ = &reference_line;
+    cell_size_ = cell_size;
+    const double length = reference_line.getLength();
+    for (int i = 0;; ++i) {
+        const double s = std::min(i * sample_spacing, length);
+        sample_s_.emplace_back(s);
+        sample_x_.emplace_back(reference_line.getX(s));
+        sample_y_.emplace_back(reference_line.getY(s));
+        if (s == length) break;
+    }
+    min_x_ = *std::min_element(sample_x_.begin(), sample_x_.end());
+    min_y_ = *std::min_element(sample_y_.begin(), sample_y_.end());
+    column_num_ = static_cast<int>((*std::max_element(sample_x_.begin(), sample_x_.end()) - min_x_) / cell_size_) + 1;
+    row_num_ = static_cast<int>((*std::max_element(sample_y_.begin(), sample_y_.end()) - min_y_) / cell_size_) + 1;
+
+    // Chords are stored per cell, counted first and then filled.
+    const int chord_num = std::max(static_cast<int>(sample_s_.size()) - 1, 1);
+    std::vector<int> chord_cells;
+    cell_begin_.assign(column_num_ * row_num_ + 1, 0);
+    for (int chord = 0; chord != chord_num; ++chord) {
+        getChordCells(chord, &chord_cells);
+        for (const auto cell : chord_cells) ++cell_begin_[cell + 1];
+    }
+    for (size_t i = 1; i != cell_begin_.size(); ++i) {
+        cell_begin_[i] += cell_begin_[i - 1];
+    }
+    cell_chords_.resize(cell_begin_.back());
+    std::vector<int> fill(cell_begin_.begin(), cell_begin_.end() - 1);
+    for (int chord = 0; chord != chord_num; ++chord) {
+        getChordCells(chord, &chord_cells);
+        for (const auto cell : chord_cells) cell_chords_[fill[cell]++] = chord;
+    }
+}
+
+void ProjectionIndex::getChordCells(int chord, std::vector<int> *cells) const {
+    cells->clear();
+    const int next = std::min(chord + 1, static_cast<int>(sample_s_.size()) - 1);
+    const auto column_begin = static_cast<int>((std::min(sample_x_[chord], sample_x_[next]) - min_x_) / cell_size_);
+    const auto column_end = static_cast<int>((std::max(sample_x_[chord], sample_x_[next]) - min_x_) / cell_size_);
+    const auto row_begin = static_cast<int>((std::min(sample_y_[chord], sample_y_[next]) - min_y_) / cell_size_);
+    const auto row_end = static_cast<int>((std::max(sample_y_[chord], sample_y_[next]) - min_y_) / cell_size_);
+    for (int row = row_begin; row <= std::min(row_end, row_num_ - 1); ++row) {
+        for (int column = column_begin; column <= std::min(column_end, column_num_ - 1); ++column) {
+            cells->emplace_back(row * column_num_ + column);
+        }
+    }
+}
+
+void ProjectionIndex::clear() {
+    reference_line_ = nullptr;
+    sample_s_.clear();
+    sample_x_.clear();
+    sample_y_.clear();
+    cell_begin_.clear();
+    cell_chords_.clear();
+    column_num_ = 0;
+    row_num_ = 0;
+}
+
+double ProjectionIndex::chordDistance(int chord, double x, double y, double *s) const {
+    const int next = std::min(chord + 1, static_cast<int>(sample_s_.size()) - 1);
+    const double dx = sample_x_[next] - sample_x_[chord], dy = sample_y_[next] - sample_y_[chord];
+    const double length_sq = dx * dx + dy * dy;
+    double t = 0;
+    if (length_sq > 0) {
+        t = std::max(0.0, std::min(1.0, ((x - sample_x_[chord]) * dx + (y - sample_y_[chord]) * dy) / length_sq));
+    }
+    *s = sample_s_[chord] + t * (sample_s_[next] - sample_s_[chord]);
+    return pow(sample_x_[chord] + t * dx - x, 2) + pow(sample_y_[chord] + t * dy - y, 2);
+}
+
+double ProjectionIndex::refine(double x, double y, double s) const {
+    // Newton's method on the squared distance, ignoring coeff 2 in J and H.
+    const double length = reference_line_->getLength();
+    double cur_s = s;
+    for (int i = 0; i < 20; ++i) {
+        const double path_x = reference_line_->getX(cur_s);
+        const double path_y = reference_line_->getY(cur_s);
+        double dx, dy, ddx, ddy;
+        reference_line_->getDerivatives(cur_s, &dx, &dy, &ddx, &ddy);
+        const double j = (path_x - x) * dx + (path_y - y) * dy;
+        const double h = dx * dx + (path_x - x) * ddx + dy * dy + (path_y - y) * ddy;
+        if (h <= 1e-9) break;
+        const double next_s = std::max(0.0, std::min(length, cur_s - j / h));
+        if (fabs(next_s - cur_s) < 1e-5) {
+            cur_s = next_s;
+            break;
+        }
+        cur_s = next_s;
+    }
+    // Newton may leave the chord's neighbourhood on sharp turns, keep the chord result then.
+    auto distance_sq_at = [&](double query_s) {
+        return pow(reference_line_->getX(query_s) - x, 2) + pow(reference_line_->getY(query_s) - y, 2);
+    };
+    return distance_sq_at(cur_s) <= distance_sq_at(s) ? cur_s : s;
+}
+
+State ProjectionIndex::getProjection(double x, double y, double hint_s) const {
+    CHECK(!empty()) << "Projection index is not built!";
+    auto best_distance_sq = DBL_MAX;
+    double best_s = 0;
+    auto check_chord = [&](int chord) {
+        double s;
+        const double distance_sq = chordDistance(chord, x, y, &s);
+        if (distance_sq < best_distance_sq) {
+            best_distance_sq = distance_sq;
+            best_s = s;
+        }
+    };
+    const int chord_num = std::max(static_cast<int>(sample_s_.size()) - 1, 1);
+    if (hint_s >= 0) {
+        const auto hint_chord = static_cast<int>(
+            std::upper_bound(sample_s_.begin(), sample_s_.end(), hint_s) - sample_s_.begin()) - 1;
+        for (int chord = std::max(hint_chord - kHintChords, 0);
+             chord <= std::min(hint_chord + kHintChords, chord_num - 1); ++chord) {
+            check_chord(chord);
+        }
+    }
+    // Rings of cells around the query. Cells in ring r are at least (r - 1) cells away.
+    const auto column = static_cast<int>(std::floor((x - min_x_) / cell_size_));
+    const auto row = static_cast<int>(std::floor((y - min_y_) / cell_size_));
+    const int max_ring = std::max({column, column_num_ - 1 - column, row, row_num_ - 1 - row});
+    auto check_cell = [&](int cell_column, int cell_row) {
+        if (cell_column < 0 || cell_column >= column_num_) return;
+        const int cell = cell_row * column_num_ + cell_column;
+        for (int i = cell_begin_[cell]; i != cell_begin_[cell + 1]; ++i) check_chord(cell_chords_[i]);
+    };
+    for (int ring = 0; ring <= max_ring; ++ring) {
+        if (ring > 0 && pow((ring - 1) * cell_size_, 2) > best_distance_sq) break;
+        for (int cell_row = std::max(row - ring, 0); cell_row <= std::min(row + ring, row_num_ - 1); ++cell_row) {
+            if (std::abs(cell_row - row) == ring) {
+                for (int cell_column = std::max(column - ring, 0);
+                     cell_column <= std::min(column + ring, column_num_ - 1); ++cell_column) {
+                    check_cell(cell_column, cell_row);
+                }
+            } else {
+                check_cell(column - ring, cell_row);
+                check_cell(column + ring, cell_row);
+            }
+        }
+    }
+    return reference_line_->getState(refine(x, y, best_s));
+}
+
+void ProjectionIndex::cartesianToFrenet(double x, double y, double *s, double *l, double hint_s) const {
+    const auto projection = getProjection(x, y, hint_s);
+    *s = projection.s;
+    double nx, ny;
+    reference_line_->getNormal(projection.s, &nx, &ny);
+    *l = (x - projection.x) * nx + (y - projection.y) * ny;
+}
+
+void ProjectionIndex::cartesianToFrenet(const std::vector<double> &x_list,
+                                        const std::vector<double> &y_list,
+                                        std::vector<double> *s_list,
+                                        std::vector<double> *l_list) const {
+    CHECK_EQ(x_list.size(), y_list.size());
+    s_list->resize(x_list.size());
+    l_list->resize(x_list.size());
+    double hint_s = -1;
+    for (size_t i = 0; i != x_list.size(); ++i) {
+        cartesianToFrenet(x_list[i], y_list[i], &(*s_list)[i], &(*l_list)[i], hint_s);
+        hint_s = (*s_list)[i];
+    }
+}
+
+void ProjectionIndex::frenetToCartesian(const std::vector<double> &s_list,
+                                        const std::vector<double> &l_list,
+                                        std::vector<double> *x_list,
+                                        std::vector<double> *y_list) const {
+    CHECK_EQ(s_list.size(), l_list.size());
+    CHECK(!empty()) << "Projection index is not built!";
+    x_list->resize(s_list.size());
+    y_list->resize(s_list.size());
+    for (size_t i = 0; i != s_list.size(); ++i) {
+        double nx, ny;
+        reference_line_->getNormal(s_list[i], &nx, &ny);
+        (*x_list)[i] = reference_line_->getX(s_list[i]) + l_list[i] * nx;
+        (*y_list)[i] = reference_line_->getY(s_list[i]) + l_list[i] * ny;
+    }
+}
+
+}
@@ -0,0 +1,203 @@
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <iterator>
+#include <algorithm>
+#include <gflags/gflags.h>
+#include <glog/logging.h>
+#include "path_optimizer/tools/result_cache.hpp"
+#include "path_optimizer/tools/spline.h"
+#include "path_optimizer/data_struct/reference_path.hpp"
+#include "path_optimizer/config/planning_flags.hpp"
+
+namespace PathOptimizationNS {
+
+namespace {
+uint64_t combine(uint64_t hash, uint64_t value) {
+    return hash ^ (value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2));
+}
+
+uint64_t combine(uint64_t hash, double value) {
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return combine(hash, bits);
+}
+
+uint64_t combine(uint64_t hash, const std::string &value) {
+    return combine(hash, static_cast<uint64_t>(std::hash<std::string>()(value)));
+}
+
+// Exact values with a non-positive resolution.
+int64_t quantize(double value, double resolution) {
+    return resolution > 0 ? static_cast<int64_t>(std::llround(value / resolution)) : combine(0, value);
+}
+
+// Flags of planning_flags.cpp the results don't depend on: output on screen or to file, thread
+// counts and this cache.
+const char *const kUnkeyedFlags[] = {
+    "enable_computation_time_output", "planning_stats_file", "candidate_thread_num", "race_thread_num",
+    "result_cache_capacity", "result_cache_position_resolution", "result_cache_angle_resolution",
+    "result_cache_curvature_resolution"};
+
+struct ConfigFlag {
+    enum Type { kBool, kInt32, kInt64, kUint32, kUint64, kDouble, kString };
+    Type type;
+    const void *value;
+};
+
+// Every other flag of planning_flags.cpp, as registered with gflags, so a new flag is keyed
+// without being listed here. Made on first use.
+const std::vector<ConfigFlag> &configFlags() {
+    static const std::vector<ConfigFlag> config_flags = [] {
+        static const std::string kFlagFile = "planning_flags.cpp";
+        std::vector<google::CommandLineFlagInfo> all_flags;
+        google::GetAllFlags(&all_flags);
+        std::vector<ConfigFlag> flags;
+        for (const auto &flag : all_flags) {
+            if (flag.filename.size() < kFlagFile.size()
+                || flag.filename.compare(flag.filename.size() - kFlagFile.size(), kFlagFile.size(), kFlagFile) != 0
+                || std::find(std::begin(kUnkeyedFlags), std::end(kUnkeyedFlags), flag.name) != std::end(kUnkeyedFlags)) {
+                continue;
+            }
+            ConfigFlag config_flag;
+            config_flag.value = flag.flag_ptr;
+            if (flag.type == "bool") {
+                config_flag.type = ConfigFlag::kBool;
+            } else if (flag.type == "int32") {
+                config_flag.type = ConfigFlag::kInt32;
+            } else if (flag.type == "int64") {
+                config_flag.type = ConfigFlag::kInt64;
+            } else if (flag.type == "uint32") {
+                config_flag.type = ConfigFlag::kUint32;
+            } else if (flag.type == "uint64") {
+                config_flag.type = ConfigFlag::kUint64;
+            } else if (flag.type == "double") {
+                config_flag.type = ConfigFlag::kDouble;
+            } else {
+                CHECK_EQ(flag.type, "string") << "flag " << flag.name;
+                config_flag.type = ConfigFlag::kString;
+            }
+            flags.emplace_back(config_flag);
+        }
+        CHECK(!flags.empty()) << "No planning flag is registered with gflags.";
+        return flags;
+    }();
+    return config_flags;
+}
+
+// The flags the results depend on, read through their pointers so that keying a solve doesn't
+// allocate.
+uint64_t configHash() {
+    uint64_t hash = 0;
+    for (const auto &flag : configFlags()) {
+        switch (flag.type) {
+            case ConfigFlag::kBool:
+                hash = combine(hash, static_cast<uint64_t>(*static_cast<const bool *>(flag.value)));
+                break;
+            case ConfigFlag::kInt32:
+                hash = combine(hash, static_cast<uint64_t>(*static_cast<const int32_t *>(flag.value)));
+                break;
+            case ConfigFlag::kInt64:
+                hash = combine(hash, static_cast<uint64_t>(*static_cast<const int64_t *>(flag.value)));
+                break;
+            case ConfigFlag::kUint32:
+                hash = combine(hash, static_cast<uint64_t>(*static_cast<const uint32_t *>(flag.value)));
+                break;
+            case ConfigFlag::kUint64:
+                hash = combine(hash, *static_cast<const uint64_t *>(flag.value));
+                break;
+            case ConfigFlag::kDouble:
+                hash = combine(hash, *static_cast<const double *>(flag.value));
+                break;
+            case ConfigFlag::kString:
+                hash = combine(hash, *static_cast<const std::string *>(flag.value));
+                break;
+        }
+    }
+    return hash;
+}
+}
+
+bool ResultCache::Key::operator==(const Key &key) const {
+    return reference_hash == key.reference_hash && config_hash == key.config_hash
+        && map_version == key.map_version && start == key.start && goal == key.goal;
+}
+
+std::size_t ResultCache::KeyHash::operator()(const Key &key) const {
+    uint64_t hash = combine(combine(key.reference_hash, key.config_hash), key.map_version);
+    for (const auto value : key.start) hash = combine(hash, static_cast<uint64_t>(value));
+    for (const auto value : key.goal) hash = combine(hash, static_cast<uint64_t>(value));
+    return static_cast<std::size_t>(hash);
+}
+
+bool ResultCache::enabled() const {
+    return FLAGS_result_cache_capacity > 0;
+}
+
+void ResultCache::setInput(const std::vector<State> &reference_points,
+                           const State &start_state,
+                           const State &end_state,
+                           uint64_t map_version) {
+    has_input_ = enabled();
+    if (!has_input_) return;
+    ++lookups_;
+    const double position_resolution = FLAGS_result_cache_position_resolution;
+    const double angle_resolution = FLAGS_result_cache_angle_resolution;
+    const double curvature_resolution = FLAGS_result_cache_curvature_resolution;
+    reference_key_ = Key();
+    for (const auto &point : reference_points) {
+        for (const double value : {point.x, point.y, point.z, point.k, point.s, point.v, point.a}) {
+            reference_key_.reference_hash = combine(reference_key_.reference_hash, value);
+        }
+    }
+    reference_key_.config_hash = configHash();
+    reference_key_.map_version = map_version;
+    reference_key_.start = {{quantize(start_state.x, position_resolution),
+                             quantize(start_state.y, position_resolution),
+                             quantize(start_state.z, angle_resolution),
+                             quantize(start_state.k, curvature_resolution)}};
+    path_key_ = reference_key_;
+    path_key_.goal = {{quantize(end_state.x, position_resolution),
+                       quantize(end_state.y, position_resolution),
+                       quantize(end_state.z, angle_resolution)}};
+}
+
+bool ResultCache::findReference(ReferencePath *reference_path) {
+    if (!has_input_) return false;
+    const auto reference = references_.get(reference_key_);
+    if (!reference) return false;
+    reference_path->setSpline(reference->x_s, reference->y_s, reference->length);
+    ++reference_hits_;
+    return true;
+}
+
+void ResultCache::putReference(const ReferencePath &reference_path) {
+    if (!has_input_) return;
+    CachedReference reference;
+    reference.x_s = reference_path.getSharedXS();
+    reference.y_s = reference_path.getSharedYS();
+    reference.length = reference_path.getLength();
+    references_.put(reference_key_, std::move(reference), static_cast<std::size_t>(FLAGS_result_cache_capacity));
+}
+
+bool ResultCache::findPath(std::vector<State> *path) {
+    if (!has_input_) return false;
+    const auto cached_path = paths_.get(path_key_);
+    if (!cached_path) return false;
+    *path = *cached_path;
+    ++path_hits_;
+    return true;
+}
+
+void ResultCache::putPath(const std::vector<State> &path) {
+    if (!has_input_) return;
+    paths_.put(path_key_, path, static_cast<std::size_t>(FLAGS_result_cache_capacity));
+}
+
+void ResultCache::clear() {
+    has_input_ = false;
+    references_.clear();
+    paths_.clear();
+}
+
+}
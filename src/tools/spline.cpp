@@ -6,151 +6,19 @@
 // implementation part, which could be separated into a cpp file
 // ---------------------------------------------------------------------
 
-
-// band_matrix implementation
-// -------------------------
 #include "path_optimizer/tools/spline.h"
+#include "path_optimizer/tools/instrumentation.hpp"
 
 namespace PathOptimizationNS {
 namespace tk {
 
-band_matrix::band_matrix(int dim, int n_u, int n_l) {
-    resize(dim, n_u, n_l);
-}
-void band_matrix::resize(int dim, int n_u, int n_l) {
-    assert(dim > 0);
-    assert(n_u >= 0);
-    assert(n_l >= 0);
-    m_upper.resize(n_u + 1);
-    m_lower.resize(n_l + 1);
-    for (size_t i = 0; i < m_upper.size(); i++) {
-        m_upper[i].resize(dim);
-    }
-    for (size_t i = 0; i < m_lower.size(); i++) {
-        m_lower[i].resize(dim);
-    }
-}
-int band_matrix::dim() const {
-    if (m_upper.size() > 0) {
-        return m_upper[0].size();
-    } else {
-        return 0;
-    }
-}
-
-// defines the new operator (), so that we can access the elements
-// by A(i,j), index going from i=0,...,dim()-1
-double &band_matrix::operator()(int i, int j) {
-    int k = j - i;       // what band is the entry
-    assert((i >= 0) && (i < dim()) && (j >= 0) && (j < dim()));
-    assert((-num_lower() <= k) && (k <= num_upper()));
-    // k=0 -> diogonal, k<0 lower left part, k>0 upper right part
-    if (k >= 0) return m_upper[k][i];
-    else return m_lower[-k][i];
-}
-double band_matrix::operator()(int i, int j) const {
-    int k = j - i;       // what band is the entry
-    assert((i >= 0) && (i < dim()) && (j >= 0) && (j < dim()));
-    assert((-num_lower() <= k) && (k <= num_upper()));
-    // k=0 -> diogonal, k<0 lower left part, k>0 upper right part
-    if (k >= 0) return m_upper[k][i];
-    else return m_lower[-k][i];
-}
-// second diag (used in LU decomposition), saved in m_lower
-double band_matrix::saved_diag(int i) const {
-    assert((i >= 0) && (i < dim()));
-    return m_lower[0][i];
-}
-double &band_matrix::saved_diag(int i) {
-    assert((i >= 0) && (i < dim()));
-    return m_lower[0][i];
-}
-
-// LR-Decomposition of a band matrix
-void band_matrix::lu_decompose() {
-    int i_max, j_max;
-    int j_min;
-    double x;
-
-    // preconditioning
-    // normalize column i so that a_ii=1
-    for (int i = 0; i < this->dim(); i++) {
-        assert(this->operator()(i, i) != 0.0);
-        this->saved_diag(i) = 1.0 / this->operator()(i, i);
-        j_min = std::max(0, i - this->num_lower());
-        j_max = std::min(this->dim() - 1, i + this->num_upper());
-        for (int j = j_min; j <= j_max; j++) {
-            this->operator()(i, j) *= this->saved_diag(i);
-        }
-        this->operator()(i, i) = 1.0;          // prevents rounding errors
-    }
-
-    // Gauss LR-Decomposition
-    for (int k = 0; k < this->dim(); k++) {
-        i_max = std::min(this->dim() - 1, k + this->num_lower());  // num_lower not a mistake!
-        for (int i = k + 1; i <= i_max; i++) {
-            assert(this->operator()(k, k) != 0.0);
-            x = -this->operator()(i, k) / this->operator()(k, k);
-            this->operator()(i, k) = -x;                         // assembly part of L
-            j_max = std::min(this->dim() - 1, k + this->num_upper());
-            for (int j = k + 1; j <= j_max; j++) {
-                // assembly part of R
-                this->operator()(i, j) = this->operator()(i, j) + x * this->operator()(k, j);
-            }
-        }
-    }
-}
-// solves Ly=b
-std::vector<double> band_matrix::l_solve(const std::vector<double> &b) const {
-    assert(this->dim() == (int) b.size());
-    std::vector<double> x(this->dim());
-    int j_start;
-    double sum;
-    for (int i = 0; i < this->dim(); i++) {
-        sum = 0;
-        j_start = std::max(0, i - this->num_lower());
-        for (int j = j_start; j < i; j++) sum += this->operator()(i, j) * x[j];
-        x[i] = (b[i] * this->saved_diag(i)) - sum;
-    }
-    return x;
-}
-// solves Rx=y
-std::vector<double> band_matrix::r_solve(const std::vector<double> &b) const {
-    assert(this->dim() == (int) b.size());
-    std::vector<double> x(this->dim());
-    int j_stop;
-    double sum;
-    for (int i = this->dim() - 1; i >= 0; i--) {
-        sum = 0;
-        j_stop = std::min(this->dim() - 1, i + this->num_upper());
-        for (int j = i + 1; j <= j_stop; j++) sum += this->operator()(i, j) * x[j];
-        x[i] = (b[i] - sum) / this->operator()(i, i);
-    }
-    return x;
-}
-
-std::vector<double> band_matrix::lu_solve(const std::vector<double> &b,
-                                          bool is_lu_decomposed) {
-    assert(this->dim() == (int) b.size());
-    std::vector<double> x, y;
-    if (is_lu_decomposed == false) {
-        this->lu_decompose();
-    }
-    y = this->l_solve(b);
-    x = this->r_solve(y);
-    return x;
-}
-
-
-
-
 // spline implementation
 // -----------------------
 
 void spline::set_boundary(spline::bd_type left, double left_value,
                           spline::bd_type right, double right_value,
                           bool force_linear_extrapolation) {
-    assert(m_x.size() == 0);          // set_points() must not have happened yet
+    assert(m_n == 0);          // set_points() must not have happened yet
     m_left = left;
     m_right = right;
     m_left_value = left_value;
@@ -162,74 +30,86 @@ void spline::set_points(const std::vector<double> &x,
                         const std::vector<double> &y, bool cubic_spline) {
     assert(x.size() == y.size());
     assert(x.size() > 2);
-    m_x = x;
-    m_y = y;
     int n = x.size();
+    // resize() keeps the capacity, so refitting a spline of the same or
+    // smaller size doesn't allocate
+    m_n = n;
+    m_coef.resize(5 * n);
+    double *m_x = px(), *m_y = py(), *m_a = pa(), *m_b = pb(), *m_c = pc();
+    std::copy(x.begin(), x.end(), m_x);
+    std::copy(y.begin(), y.end(), m_y);
     // TODO: maybe sort x and y, rather than returning an error
     for (int i = 0; i < n - 1; i++) {
         assert(m_x[i] < m_x[i + 1]);
     }
 
     if (cubic_spline == true) { // cubic spline interpolation
-        // setting up the matrix and right hand side of the equation system
-        // for the parameters b[]
-        band_matrix A(n, 1, 1);
-        std::vector<double> rhs(n);
-        for (int i = 1; i < n - 1; i++) {
-            A(i, i - 1) = 1.0 / 3.0 * (x[i] - x[i - 1]);
-            A(i, i) = 2.0 / 3.0 * (x[i + 1] - x[i - 1]);
-            A(i, i + 1) = 1.0 / 3.0 * (x[i + 1] - x[i]);
-            rhs[i] = (y[i + 1] - y[i]) / (x[i + 1] - x[i]) - (y[i] - y[i - 1]) / (x[i] - x[i - 1]);
-        }
+        // the equation system for the parameters b[] is tridiagonal:
+        // A(i,i-1) = 1/3 (x[i]-x[i-1]), A(i,i) = 2/3 (x[i+1]-x[i-1]),
+        // A(i,i+1) = 1/3 (x[i+1]-x[i]), plus one boundary condition per end.
+        // solve it with the Thomas algorithm, m_a[] holds the modified upper
+        // diagonal and m_b[] the modified right hand side until back substitution
+        double diag, upper, lower, rhs;
         // boundary conditions
         if (m_left == spline::second_deriv) {
             // 2*b[0] = f''
-            A(0, 0) = 2.0;
-            A(0, 1) = 0.0;
-            rhs[0] = m_left_value;
+            diag = 2.0;
+            upper = 0.0;
+            rhs = m_left_value;
         } else if (m_left == spline::first_deriv) {
             // c[0] = f', needs to be re-expressed in terms of b:
             // (2b[0]+b[1])(x[1]-x[0]) = 3 ((y[1]-y[0])/(x[1]-x[0]) - f')
-            A(0, 0) = 2.0 * (x[1] - x[0]);
-            A(0, 1) = 1.0 * (x[1] - x[0]);
-            rhs[0] = 3.0 * ((y[1] - y[0]) / (x[1] - x[0]) - m_left_value);
+            diag = 2.0 * (x[1] - x[0]);
+            upper = 1.0 * (x[1] - x[0]);
+            rhs = 3.0 * ((y[1] - y[0]) / (x[1] - x[0]) - m_left_value);
         } else {
             assert(false);
         }
+        m_a[0] = upper / diag;
+        m_b[0] = rhs / diag;
+        for (int i = 1; i < n - 1; i++) {
+            lower = 1.0 / 3.0 * (x[i] - x[i - 1]);
+            diag = 2.0 / 3.0 * (x[i + 1] - x[i - 1]);
+            upper = 1.0 / 3.0 * (x[i + 1] - x[i]);
+            rhs = (y[i + 1] - y[i]) / (x[i + 1] - x[i]) - (y[i] - y[i - 1]) / (x[i] - x[i - 1]);
+            double m = diag - lower * m_a[i - 1];
+            m_a[i] = upper / m;
+            m_b[i] = (rhs - lower * m_b[i - 1]) / m;
+        }
         if (m_right == spline::second_deriv) {
             // 2*b[n-1] = f''
-            A(n - 1, n - 1) = 2.0;
-            A(n - 1, n - 2) = 0.0;
-            rhs[n - 1] = m_right_value;
+            diag = 2.0;
+            lower = 0.0;
+            rhs = m_right_value;
         } else if (m_right == spline::first_deriv) {
             // c[n-1] = f', needs to be re-expressed in terms of b:
             // (b[n-2]+2b[n-1])(x[n-1]-x[n-2])
             // = 3 (f' - (y[n-1]-y[n-2])/(x[n-1]-x[n-2]))
-            A(n - 1, n - 1) = 2.0 * (x[n - 1] - x[n - 2]);
-            A(n - 1, n - 2) = 1.0 * (x[n - 1] - x[n - 2]);
-            rhs[n - 1] = 3.0 * (m_right_value - (y[n - 1] - y[n - 2]) / (x[n - 1] - x[n - 2]));
+            diag = 2.0 * (x[n - 1] - x[n - 2]);
+            lower = 1.0 * (x[n - 1] - x[n - 2]);
+            rhs = 3.0 * (m_right_value - (y[n - 1] - y[n - 2]) / (x[n - 1] - x[n - 2]));
         } else {
             assert(false);
         }
-
-        // solve the equation system to obtain the parameters b[]
-        m_b = A.lu_solve(rhs);
+        m_b[n - 1] = (rhs - lower * m_b[n - 2]) / (diag - lower * m_a[n - 2]);
+        // back substitution
+        for (int i = n - 2; i >= 0; i--) {
+            m_b[i] -= m_a[i] * m_b[i + 1];
+        }
 
         // calculate parameters a[] and c[] based on b[]
-        m_a.resize(n);
-        m_c.resize(n);
         for (int i = 0; i < n - 1; i++) {
             m_a[i] = 1.0 / 3.0 * (m_b[i + 1] - m_b[i]) / (x[i + 1] - x[i]);
             m_c[i] = (y[i + 1] - y[i]) / (x[i + 1] - x[i])
                 - 1.0 / 3.0 * (2.0 * m_b[i] + m_b[i + 1]) * (x[i + 1] - x[i]);
         }
     } else { // linear interpolation
-        m_a.resize(n);
-        m_b.resize(n);
-        m_c.resize(n);
-        for (int i = 0; i < n - 1; i++) {
+        for (int i = 0; i < n; i++) {
             m_a[i] = 0.0;
             m_b[i] = 0.0;
+            m_c[i] = 0.0;
+        }
+        for (int i = 0; i < n - 1; i++) {
             m_c[i] = (m_y[i + 1] - m_y[i]) / (m_x[i + 1] - m_x[i]);
         }
     }
@@ -248,73 +128,107 @@ void spline::set_points(const std::vector<double> &x,
         m_b[n - 1] = 0.0;
 }
 
-double spline::operator()(double x) const {
-    size_t n = m_x.size();
-    // find the closest point m_x[idx] < x, idx=0 even if x<m_x[0]
-    std::vector<double>::const_iterator it;
-    it = std::lower_bound(m_x.begin(), m_x.end(), x);
-    int idx = std::max(int(it - m_x.begin()) - 1, 0);
-
-    double h = x - m_x[idx];
-    double interpol;
-    if (x < m_x[0]) {
-        // extrapolation to the left
-        interpol = (m_b0 * h + m_c0) * h + m_y[0];
-    } else if (x > m_x[n - 1]) {
-        // extrapolation to the right
-        interpol = (m_b[n - 1] * h + m_c[n - 1]) * h + m_y[n - 1];
-    } else {
-        // interpolation
-        interpol = ((m_a[idx] * h + m_b[idx]) * h + m_c[idx]) * h + m_y[idx];
+void spline::trim_left(double x0) {
+    assert(m_n > 1);
+    size_t n = m_n;
+    double *m_x = px(), *m_y = py(), *m_a = pa(), *m_b = pb(), *m_c = pc();
+    assert(x0 >= m_x[0] && x0 < m_x[n - 1]);
+    // m_x[idx] <= x0 < m_x[idx+1]
+    size_t idx = std::upper_bound(m_x, m_x + n, x0) - m_x - 1;
+    // the polynomial of interval idx re-expanded around x0
+    double h = x0 - m_x[idx];
+    double a = m_a[idx], b = m_b[idx], c = m_c[idx];
+    m_y[idx] = ((a * h + b) * h + c) * h + m_y[idx];
+    m_c[idx] = (3.0 * a * h + 2.0 * b) * h + c;
+    m_b[idx] = 3.0 * a * h + b;
+    m_x[idx] = x0;
+    // keep the points from idx on. each block moves towards the front and
+    // ends before the next block's kept part begins, so nothing is overwritten
+    size_t new_n = n - idx;
+    for (size_t k = 0; k < 5; k++) {
+        std::copy(m_coef.begin() + k * n + idx, m_coef.begin() + (k + 1) * n,
+                  m_coef.begin() + k * new_n);
     }
-    return interpol;
+    m_n = new_n;
+    m_coef.resize(5 * new_n);
+    for (size_t i = 0; i < new_n; i++) {
+        px()[i] -= x0;
+    }
+    m_b0 = (m_force_linear_extrapolation == false) ? pb()[0] : 0.0;
+    m_c0 = pc()[0];
+}
+
+double spline::operator()(double x) const {
+    double value;
+    evaluate(x, &value, nullptr, nullptr);
+    return value;
 }
 
 double spline::deriv(int order, double x) const {
     assert(order > 0);
+    if (order > 3) return 0.0;
+    size_t idx = find_interval(x);
+    double value, d1, d2;
+    evaluate_at(idx, x, &value, &d1, &d2);
+    switch (order) {
+        case 1:return d1;
+        case 2:return d2;
+        default:
+            // only non-zero for interpolation
+            return (x < px()[0] || x > px()[m_n - 1]) ? 0.0 : 6.0 * pa()[idx];
+    }
+}
 
-    size_t n = m_x.size();
-    // find the closest point m_x[idx] < x, idx=0 even if x<m_x[0]
-    std::vector<double>::const_iterator it;
-    it = std::lower_bound(m_x.begin(), m_x.end(), x);
-    int idx = std::max(int(it - m_x.begin()) - 1, 0);
+size_t spline::find_interval(double x) const {
+    const double *m_x = px();
+    return std::max(int(std::lower_bound(m_x, m_x + m_n, x) - m_x) - 1, 0);
+}
 
+void spline::evaluate_at(size_t idx, double x, double *value, double *d1, double *d2) const {
+    PATH_OPTIMIZER_COUNT(kSplineEvaluation);
+    const double *m_x = px(), *m_y = py(), *m_a = pa(), *m_b = pb(), *m_c = pc();
+    size_t n = m_n;
     double h = x - m_x[idx];
-    double interpol;
     if (x < m_x[0]) {
         // extrapolation to the left
-        switch (order) {
-            case 1:interpol = 2.0 * m_b0 * h + m_c0;
-                break;
-            case 2:interpol = 2.0 * m_b0 * h;
-                break;
-            default:interpol = 0.0;
-                break;
-        }
+        *value = (m_b0 * h + m_c0) * h + m_y[0];
+        if (d1) *d1 = 2.0 * m_b0 * h + m_c0;
+        if (d2) *d2 = 2.0 * m_b0 * h;
     } else if (x > m_x[n - 1]) {
         // extrapolation to the right
-        switch (order) {
-            case 1:interpol = 2.0 * m_b[n - 1] * h + m_c[n - 1];
-                break;
-            case 2:interpol = 2.0 * m_b[n - 1];
-                break;
-            default:interpol = 0.0;
-                break;
-        }
+        *value = (m_b[n - 1] * h + m_c[n - 1]) * h + m_y[n - 1];
+        if (d1) *d1 = 2.0 * m_b[n - 1] * h + m_c[n - 1];
+        if (d2) *d2 = 2.0 * m_b[n - 1];
     } else {
         // interpolation
-        switch (order) {
-            case 1:interpol = (3.0 * m_a[idx] * h + 2.0 * m_b[idx]) * h + m_c[idx];
-                break;
-            case 2:interpol = 6.0 * m_a[idx] * h + 2.0 * m_b[idx];
-                break;
-            case 3:interpol = 6.0 * m_a[idx];
-                break;
-            default:interpol = 0.0;
-                break;
-        }
+        *value = ((m_a[idx] * h + m_b[idx]) * h + m_c[idx]) * h + m_y[idx];
+        if (d1) *d1 = (3.0 * m_a[idx] * h + 2.0 * m_b[idx]) * h + m_c[idx];
+        if (d2) *d2 = 6.0 * m_a[idx] * h + 2.0 * m_b[idx];
     }
-    return interpol;
 }
+
+void spline::evaluate(double x, double *value, double *d1, double *d2) const {
+    evaluate_at(find_interval(x), x, value, d1, d2);
+}
+
+void spline::evaluate(const std::vector<double> &x, std::vector<double> *value,
+                      std::vector<double> *d1, std::vector<double> *d2) const {
+    size_t m = x.size();
+    value->resize(m);
+    if (d1) d1->resize(m);
+    if (d2) d2->resize(m);
+    if (m == 0) return;
+    const double *m_x = px();
+    size_t n = m_n;
+    // the cursor satisfies the same invariant as find_interval():
+    // m_x[idx] < x unless idx == 0, and x <= m_x[idx + 1]
+    size_t idx = find_interval(x[0]);
+    for (size_t i = 0; i < m; i++) {
+        assert(i == 0 || x[i - 1] <= x[i]);
+        while (idx + 1 < n && m_x[idx + 1] < x[i]) idx++;
+        evaluate_at(idx, x[i], &(*value)[i], d1 ? &(*d1)[i] : nullptr, d2 ? &(*d2)[i] : nullptr);
+    }
+}
+
 }
 }
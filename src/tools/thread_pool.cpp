@@ -0,0 +1,45 @@
+#include <glog/logging.h>
+#include "path_optimizer/tools/thread_pool.hpp"
+
+namespace PathOptimizationNS {
+
+ThreadPool::ThreadPool(std::size_t thread_num) {
+    CHECK_GT(thread_num, 0);
+    workers_.reserve(thread_num);
+    for (std::size_t i = 0; i != thread_num; ++i) {
+        workers_.emplace_back(&ThreadPool::run, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    condition_.notify_all();
+    for (auto &worker : workers_) {
+        worker.join();
+    }
+}
+
+void ThreadPool::run() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            condition_.wait(lock, [this] { return stop_ || !tasks_.empty(); });
+            if (tasks_.empty()) return;
+            task = std::move(tasks_.front());
+            tasks_.pop();
+        }
+        task();
+    }
+}
+
+std::shared_ptr<ThreadPool> ResizableThreadPool::get(std::size_t thread_num) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!pool_ || pool_->size() != thread_num) pool_ = std::make_shared<ThreadPool>(thread_num);
+    return pool_;
+}
+
+}
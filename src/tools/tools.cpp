@@ -1,7 +1,6 @@
 //
 // Created by ljn on 20-1-26.
 //
-#include <cfloat>
 #include "path_optimizer/tools/tools.hpp"
 #include "path_optimizer/tools/spline.h"
 #include "path_optimizer/data_struct/data_struct.hpp"
@@ -30,19 +29,55 @@ bool isEqual(double a, double b) {
 }
 
 double getHeading(const tk::spline &xs, const tk::spline &ys, double s) {
-    double x_d1 = xs.deriv(1, s);
-    double y_d1 = ys.deriv(1, s);
+    double x, y, x_d1, y_d1;
+    xs.evaluate(s, &x, &x_d1, nullptr);
+    ys.evaluate(s, &y, &y_d1, nullptr);
     return atan2(y_d1, x_d1);
 }
 
 double getCurvature(const tk::spline &xs, const tk::spline &ys, double tmp_s) {
-    double x_d1 = xs.deriv(1, tmp_s);
-    double y_d1 = ys.deriv(1, tmp_s);
-    double x_d2 = xs.deriv(2, tmp_s);
-    double y_d2 = ys.deriv(2, tmp_s);
+    double x, y, x_d1, y_d1, x_d2, y_d2;
+    xs.evaluate(tmp_s, &x, &x_d1, &x_d2);
+    ys.evaluate(tmp_s, &y, &y_d1, &y_d2);
     return (x_d1 * y_d2 - y_d1 * x_d2) / pow(pow(x_d1, 2) + pow(y_d1, 2), 1.5);
 }
 
+void evaluateSplines(const tk::spline &xs,
+                     const tk::spline &ys,
+                     const std::vector<double> &s_list,
+                     std::vector<double> *x_list,
+                     std::vector<double> *y_list,
+                     std::vector<double> *heading_list,
+                     std::vector<double> *k_list,
+                     SplineDerivatives *derivatives) {
+    if (!heading_list && !k_list) {
+        xs.evaluate(s_list, x_list, nullptr, nullptr);
+        ys.evaluate(s_list, y_list, nullptr, nullptr);
+        return;
+    }
+    SplineDerivatives local_derivatives;
+    if (!derivatives) derivatives = &local_derivatives;
+    auto &x_d1 = derivatives->x_d1;
+    auto &y_d1 = derivatives->y_d1;
+    auto &x_d2 = derivatives->x_d2;
+    auto &y_d2 = derivatives->y_d2;
+    xs.evaluate(s_list, x_list, &x_d1, k_list ? &x_d2 : nullptr);
+    ys.evaluate(s_list, y_list, &y_d1, k_list ? &y_d2 : nullptr);
+    const size_t size = s_list.size();
+    if (heading_list) {
+        heading_list->resize(size);
+        for (size_t i = 0; i != size; ++i) {
+            (*heading_list)[i] = atan2(y_d1[i], x_d1[i]);
+        }
+    }
+    if (k_list) {
+        k_list->resize(size);
+        for (size_t i = 0; i != size; ++i) {
+            (*k_list)[i] = (x_d1[i] * y_d2[i] - y_d1[i] * x_d2[i]) / pow(pow(x_d1[i], 2) + pow(y_d1[i], 2), 1.5);
+        }
+    }
+}
+
 double distance(const State &p1, const State &p2) {
     return sqrt(pow(p1.x - p2.x, 2) + pow(p1.y - p2.y, 2));
 }
@@ -63,50 +98,4 @@ State global2Local(const State &reference, const State &target) {
     return {x, y, z, target.k, 0};
 }
 
-State findClosestPoint(const tk::spline &xs,
-                       const tk::spline &ys,
-                       double x,
-                       double y,
-                       double max_s,
-                       double start_s) {
-    if (max_s <= start_s) {
-        return State{xs(start_s), ys(start_s)};
-    }
-    static const double grid = 0.5;
-    double tmp_s = start_s, min_dis_s = start_s;
-    auto min_dis = DBL_MAX;
-    State target_state{x, y};
-    while (tmp_s <= max_s) {
-        State state_on_spline{xs(tmp_s), ys(tmp_s)};
-        double tmp_dis = distance(state_on_spline, target_state);
-        if (tmp_dis < min_dis) {
-            min_dis = tmp_dis;
-            min_dis_s = tmp_s;
-        }
-        tmp_s += grid;
-    }
-    // Newton's method
-    double cur_s = min_dis_s;
-    double prev_s = min_dis_s;
-    for (int i = 0; i < 20; ++i) {
-        double path_x = xs(cur_s);
-        double path_y = ys(cur_s);
-        double dx = xs.deriv(1, cur_s);
-        double dy = ys.deriv(1, cur_s);
-        double ddx = xs.deriv(2, cur_s);
-        double ddy = ys.deriv(2, cur_s);
-        // Ignore coeff 2 in J and H.
-        double j = (path_x - x) * dx + (path_y - y) * dy;
-        double h = dx * dx + (path_x - x) * ddx + dy * dy + (path_y - y) * ddy;
-        cur_s -= j / h;
-        if (fabs(cur_s - prev_s) < 1e-5) break;
-        prev_s = cur_s;
-    }
-    
-    cur_s = std::min(cur_s, max_s);
-    State ret{xs(cur_s), ys(cur_s)};
-    ret.s = cur_s;
-    return ret;
-}
-
 }